@@ -0,0 +1,96 @@
+#ifndef __PARALLEL_FOR_HEADER_FILE__
+#define __PARALLEL_FOR_HEADER_FILE__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+#include "CThreadPool.h"
+
+namespace threadpool
+{
+    // Параллельный цикл поверх пула потоков: fn(id, index) вызывается для каждого index из [0, count),
+    // где id - индекс потока, в котором выполняется итерация.
+    //
+    // Вызывающий поток (callerId - его индекс в пуле) сам разбирает итерации вместе с помощниками,
+    // поэтому вызов из задачи, уже выполняющейся в пуле, не приводит к взаимной блокировке:
+    // помощник, не успевший получить итерацию, просто завершается.
+    // Функция возвращает управление, когда выполнены все итерации. Если fn выбросила исключение,
+    // оставшиеся итерации не выполняются, а первое исключение перебрасывается в вызывающем потоке
+    // (уже после того, как помощники закончили с fn).
+    template<typename F>
+    void parallelFor(CThreadPool &pool, size_t count, int callerId, F &&fn)
+    {
+        if(count == 0)
+            return;
+
+        struct SharedState
+        {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            std::atomic<bool> failed{false};
+            std::exception_ptr error;
+            std::mutex mutex;
+            std::condition_variable cv;
+        };
+
+        auto state = std::make_shared<SharedState>();
+        auto *body = &fn;
+
+        // итерации берутся по одной; помощник обращается к fn только получив итерацию,
+        // а значит до возврата из parallelFor
+        auto worker = [state, count, body](int id)
+        {
+            size_t index;
+            while ((index = state->next.fetch_add(1)) < count)
+            {
+                // после исключения итерации только засчитываются выполненными
+                if(!state->failed.load())
+                {
+                    try
+                    {
+                        (*body)(id, index);
+                    }
+                    catch(...)
+                    {
+                        std::unique_lock<std::mutex> lock(state->mutex);
+
+                        if(!state->error)
+                            state->error = std::current_exception();
+
+                        state->failed.store(true);
+                    }
+                }
+
+                if(state->done.fetch_add(1) + 1 == count)
+                {
+                    std::unique_lock<std::mutex> lock(state->mutex);
+                    state->cv.notify_all();
+                }
+            }
+        };
+
+        size_t threads = static_cast<size_t>(std::max(pool.size(), 1));
+        size_t helpers = std::min(threads, count) - 1;
+
+        for (size_t i = 0; i < helpers; ++i)
+            pool.push(worker);
+
+        worker(callerId);
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cv.wait(lock, [&state, count]()
+        {
+            return state->done.load() == count;
+        });
+
+        if(state->error)
+            std::rethrow_exception(state->error);
+    }
+}
+
+#endif // __PARALLEL_FOR_HEADER_FILE__
@@ -6,15 +6,17 @@
 //#define PORTABLE_DEVICE		/* Should be defined for handhelds*/
 //#define SLOW_DEVICE 			/* Should be defined for handhelds*/
 
-#define DIST_RANGE 4000			/* Maximum distance in ballistic table, aliquot of TABLE_STEP (!) */
-#define TABLE_STEP 25			/* Ballistic table step in meters 25, 50, 100 */
-#define WIND_GRANULARITY		5	/* Quantity of wind measurement points */
+#define DIST_RANGE 4000			/* Default maximum distance (Options.Range == 0), aliquot of TABLE_STEP (!) */
+#define TABLE_STEP 25			/* Default ballistic table step in meters (Options.TableStep == 0) */
+#define MAX_DIST_RANGE 10000	/* Upper limit of Options.Range */
+#define WIND_GRANULARITY		5	/* Quantity of wind measurement points (Meteo.windSegments == 0) */
+#define MAX_WIND_SEGMENTS		32	/* Capacity of windDataArray, upper limit of Meteo.windSegments */
 #define CMD_GRANULARITY			31	/* Quantity of custom drag-function points (0.5 - 3.5 Mach) */
 #define MBC_GRANULARITY			26  /* Quantity of custom multiBC points (0.5 - 3.0 Mach) */
 #define USELESS_DATA			0
 #define USELESS_COMPLEX_DATA	NULL
 
-#define BALLISTIC_TABLE_SIZE DIST_RANGE/TABLE_STEP
+#define BALLISTIC_TABLE_SIZE DIST_RANGE/TABLE_STEP	/* Default table size, see rangecardSize() */
 #define OUT
 
 // #if defined SLOW_DEVICE
@@ -76,6 +78,18 @@ enum reticlePatterns {
     MIL_DOT = 1,
 };
 
+enum integratorType {
+
+	FIXED_STEP = 0,		/* Heun method, 1 meter step */
+	ADAPTIVE_STEP = 1,	/* Bogacki-Shampine 3(2) with error control and dense output */
+};
+
+enum precisionType {
+
+	PRECISION_DOUBLE = 0,	/* reference */
+	PRECISION_FLOAT = 1,	/* float32 fixed-step integration for slow devices, see accuracy_report.cpp */
+};
+
 enum WindType {
 
     SIMPLE_CASE = 0, 	/* Equal wind on whole distance */
@@ -100,7 +114,7 @@ typedef struct ComplexWind {
 	uint16_t windDir;
 	double terrainDir;
 
-} windDataArray[WIND_GRANULARITY];
+} windDataArray[MAX_WIND_SEGMENTS];
 
 struct Meteo {
 
@@ -117,9 +131,10 @@ struct Meteo {
 	int8_t WindType;
 
 	/* Random wind case - here is array of complex 
-	wind data (dist, velocity, direction) with 
-	dimension equal to WIND_GRANULARITY */
+	wind data (dist, velocity, direction) sorted by 
+	distance, windSegments entries of it are used */
 	windDataArray* windData;
+	uint8_t windSegments;	/* 0 - WIND_GRANULARITY, up to MAX_WIND_SEGMENTS */
 };
 
 /* Usage of windData field:
@@ -240,6 +255,36 @@ struct Options {
 	uint8_t BallisticTable; 
 	uint8_t ThermalCorrection;
 	uint8_t AeroJump;
+	uint8_t Integrator;	/* see integratorType */
+	uint8_t EarlyExit;		/* OPTION_YES - stop once shot, zero and range-card distances are reached */
+	uint8_t MachDistances;	/* OPTION_YES - with EarlyExit also go on until all Mach-threshold distances are passed */
+	uint16_t RangecardFrom;	/* range-card window in meters, RangecardTo == 0 - up to Range */
+	uint16_t RangecardTo;
+	uint16_t Range;			/* maximum distance in meters, 0 - DIST_RANGE, up to MAX_DIST_RANGE */
+	uint16_t TableStep;		/* range-card step in meters, 0 - TABLE_STEP */
+	uint8_t Precision;		/* see precisionType, fixed-step integrator only */
+	uint8_t WindInterpolation;	/* OPTION_YES - complex wind changes linearly between segment distances */
+	uint8_t Sensitivities;	/* OPTION_YES - also Results.sens, integrated in fixed step and double whatever Integrator and Precision are */
+};
+
+enum sensitivityInputs {
+
+	SENS_V0 = 0,		/* per m/s of Bullet.V0 */
+	SENS_BC = 1,		/* per 1% of the ballistic coefficient (every BC of multiBC, the custom drag function scaled alike) */
+	SENS_WIND = 2,		/* per m/s of horizontal crosswind from 90 degrees added on the whole distance */
+	SENS_RANGE = 3,		/* per meter of Inputs.shotDistance */
+	SENS_INPUTS = 4,
+};
+
+struct Sensitivities {
+
+	/* Partial derivatives of the shot solution by sensitivityInputs, from the same integration 
+	(forward-mode, see trajectory_sensitivity.h). Corrections are in scope units as vertAngleUnits, 
+	horizAngleUnits and derivAngleUnits, time in seconds */
+	double vertAngleUnits[SENS_INPUTS];
+	double horizAngleUnits[SENS_INPUTS];
+	double derivAngleUnits[SENS_INPUTS];
+	double flightTime[SENS_INPUTS];
 };
 
 struct BallisticTable {
@@ -247,10 +292,15 @@ struct BallisticTable {
 	struct Meteo meteo;
 	struct Bullet bullet;
 	struct Rifle rifle;
-	double Vert[BALLISTIC_TABLE_SIZE + 1][2];
-	double Horiz[BALLISTIC_TABLE_SIZE + 1][2];
-	double Deriv[BALLISTIC_TABLE_SIZE + 1][2];
-	double Time[BALLISTIC_TABLE_SIZE + 1];
+
+	/* Rows 0 ... size, row i is at i * step meters. Rows are kept in buffers of the solver 
+	context and stay valid until it solves again, NULL without range card */
+	uint16_t step;
+	uint16_t size;
+	double (*Vert)[2];
+	double (*Horiz)[2];
+	double (*Deriv)[2];
+	double* Time;
 } ;
 
 struct Results {
@@ -286,6 +336,7 @@ struct Results {
 	uint16_t deepSubsonic_0_7M;     //0.7
 
 	struct BallisticTable table;
+	struct Sensitivities sens;		/* Options.Sensitivities only */
 };
 
 #endif /* __TRAJECTORY_SOLVER_API_H__ */
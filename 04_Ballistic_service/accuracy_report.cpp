@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "trajectory_solver.h"
+#include "trajectory_solver_lockstep.h"
+#include "drag_tables.h"
+#include "dispersion_solver.h"
+
+/********************************************************************************************
+*
+*	Accuracy budget of Options.Precision == PRECISION_FLOAT against the double reference.
+*
+*	First the drag tables: DragCoefficientTabled() is scanned against DragCoefficient() on
+*	DRAG_SCAN_STEP Mach steps over the grid of G1/G7/Gs. Errors inside the grid cells of the
+*	approximation breakpoints (where the table smooths the step) are reported apart from
+*	the rest, the rest is checked against DRAG_TABLE_BUDGET.
+*
+*	Then a V0-only dispersion: V0 is an integer in the API, so every sample impact has to be
+*	one of the impacts of scalar shots re-zeroed with V0 +- DISPERSION_CHECK_V0 and then fired
+*	from the bore of the nominal zero, within DISPERSION_CHECK_BUDGET.
+*
+*	Every profile of the corpus (drag model x atmosphere x wind) is solved with a full range
+*	card in both modes, deviations of the vertical and horizontal angles (MRAD) and of the
+*	flight time are collected per distance band and checked against the budget below. Then
+*	both modes are timed on a typical handheld request (one shot, early exit, no range card).
+*	Where double is native (x86-64) the rates stay within a few percent: float32 is meant for
+*	FPUs without double and is not a speed option elsewhere.
+*
+*	usage: ballistic_daemon_accuracy [range, m]	(default 2000, step 25 m)
+*	exit code 1 - a budget exceeded
+*
+********************************************************************************************/
+
+struct accuracyBand {
+
+	uint16_t upTo;			/* meters */
+	double angleBudget;		/* MRAD */
+	double maxVert;
+	double maxHoriz;
+	double maxTime;			/* seconds */
+	uint16_t worstDist;
+	int worstProfile;
+};
+
+static std::vector<accuracyBand> bands {
+
+	{500, 0.005}, {1000, 0.01}, {1500, 0.02}, {2000, 0.05}, {3000, 0.1}, {MAX_DIST_RANGE, 0.2},
+};
+
+#define DRAG_SCAN_STEP 1e-6
+#define DRAG_TABLE_BUDGET 5e-5		/* absolute Cd, the tables give 2.1e-5 at most (G7) */
+
+struct dragModel {
+
+	const char* name;
+	uint8_t dragFunction;
+	std::vector<double> breakpoints;	/* Mach, as in DragCoefficient() */
+};
+
+static const std::vector<dragModel> dragModels {
+
+	{"G1", G1, {0.499, 0.999, 1.499, 2.499}},
+	{"G7", G7, {0.749, 0.949, 0.9749, 1.049, 2.049}},
+	{"Gs", Gs, {0.55, 1.15, 1.3, 1.6}},
+};
+
+static bool reportDragTables() {
+
+	printf("drag tables vs DragCoefficient(), Mach 0 .. %.1f, step %g\n\n", DRAG_TABLE_MAX_MACH, DRAG_SCAN_STEP);
+	printf("%-6s %14s %10s %16s %10s\n", "model", "off breakpts", "at Mach", "breakpt cells", "at Mach");
+
+	bool failed = false;
+
+	for (const auto& model : dragModels) {
+
+		if (!dragTableFor(model.dragFunction)) {
+
+			printf("%-6s no table (SLOW_DEVICE)\n", model.name);
+			continue;
+		}
+
+		double maxOff = 0, machOff = 0, maxAt = 0, machAt = 0;
+		const long points = lround(DRAG_TABLE_MAX_MACH / DRAG_SCAN_STEP);
+
+		for (long i = 0; i < points; i++) {
+
+			const double Mach = i * DRAG_SCAN_STEP;
+			const double error = fabs(DragCoefficientTabled(model.dragFunction, Mach) - DragCoefficient(model.dragFunction, Mach));
+			const long cell = (long)(Mach / DRAG_TABLE_STEP);
+
+			bool breakpointCell = false;
+
+			for (double breakpoint : model.breakpoints) {
+				breakpointCell = breakpointCell || (long)(breakpoint / DRAG_TABLE_STEP + 1e-9) == cell;
+			}
+
+			if (breakpointCell && error > maxAt) {
+
+				maxAt = error;
+				machAt = Mach;
+			}
+			else if (!breakpointCell && error > maxOff) {
+
+				maxOff = error;
+				machOff = Mach;
+			}
+		}
+
+		const bool over = maxOff > DRAG_TABLE_BUDGET;
+		failed = failed || over;
+
+		printf("%-6s %14.2e %10.6f %16.2e %10.6f%s\n", model.name, maxOff, machOff, maxAt, machAt, over ? "  OVER BUDGET" : "");
+	}
+
+	printf("\n");
+	return failed;
+}
+
+#define DISPERSION_CHECK_V0 60			/* m/s around the nominal V0 */
+#define DISPERSION_CHECK_BUDGET 0.01	/* cm */
+
+/* The G7 profile of the golden corpus at 800 m */
+static const char* const dispersionRequest = R"({"Token": "dispersion",
+	"Bullet": {"BC": 0.448, "CCF_0.9": 1, "CCF_1.0": 1, "CCF_1.1": 1, "CDM": {}, "DF": "G7", "MBC": {}, "V0": 830,
+		"V0temp": 15, "diam.": 8.585, "lenght": 47.65, "therm": 0, "weight": 300},
+	"Rifle": {"POI_horiz": 0, "POI_vert": 0, "roll": 0, "scope_height": 4.9, "twist": 228, "twist.dir": "R", "zero": 100,
+		"zero.atm": "not_here", "zero.press": 995, "zero.temp": 22},
+	"Scope": {"horiz.click": 0.1, "units": "MRAD", "vert.click": 0.1},
+	"Meteo": {"humid.": 0, "press.": 1013, "temp.": 15, "wind": "simple", "windage": [{"dir.": 37, "dist.": 800, "incl.": 0, "speed": 2}]},
+	"Options": {"aerojump": true, "koriolis": true, "rangecard": false, "therm.corr": false},
+	"Inputs": {"dist.": 800, "latitude": 0, "targ.speed": 0, "target_azimuth": 0, "terrain_angle": 0},
+	"Dispersion": {"samples": 256, "seed": 7, "V0.sd": 10, "points": true}})";
+
+static bool reportDispersion() {
+
+	auto bodyJson = nlohmann::json::parse(dispersionRequest);
+
+	static struct SolverContext ctxs[LOCKSTEP_MAX_LANES];
+	struct SolverContext* lanes[LOCKSTEP_MAX_LANES];
+
+	for (size_t l = 0; l < LOCKSTEP_MAX_LANES; l++) {
+		lanes[l] = &ctxs[l];
+	}
+
+	s2::dispersionsolver dispersion(bodyJson);
+	dispersion.solveNominal(ctxs[0]);
+
+	const size_t width = lockstepLanes();
+
+	for (size_t first = 0; first < dispersion.size(); first += width) {
+		dispersion.solveSamples(first, std::min(width, dispersion.size() - first), lanes);
+	}
+
+	std::string reply;
+	dispersion.serializeResults(reply);
+
+	const auto points = nlohmann::json::parse(reply)["Dispersion"]["points"]["vert."];
+
+	/* Scalar shots with the options of the samples */
+	s2::datapreparator dp;
+
+	struct Bullet bullet = dp.parseForBulletData(bodyJson);
+	const struct Rifle rifle = dp.parseForRifleData(bodyJson);
+	const struct Scope scope = dp.parseForScopeData(bodyJson);
+	const struct Meteo meteo = dp.parseForMeteoData(bodyJson);
+	const struct Inputs inputs = dp.parseForInputs(bodyJson);
+	struct Options options = dp.parseForOptions(bodyJson);
+
+	options.EarlyExit = OPTION_YES;
+	options.MachDistances = OPTION_NO;
+	options.BallisticTable = OPTION_NO;
+
+	const double dist = inputs.shotDistance;
+	const uint16_t V0 = bullet.V0;
+	struct Results results;
+
+	trajectorySolver(&ctxs[0], &meteo, &bullet, &rifle, &scope, &inputs, &options, OUT &results);
+
+	const double vertNominal = results.vertAngleUnits;
+	const double throwNominal = ctxs[0].throwAngle;
+
+	/* Dialed minus needed correction (MRAD to cm), the nominal bore is lower than the
+	sample's own zero by the difference of the throwing angles (radians times cm) */
+	std::vector<double> expected;
+
+	for (int dV0 = -DISPERSION_CHECK_V0; dV0 <= DISPERSION_CHECK_V0; dV0++) {
+
+		bullet.V0 = (uint16_t)(V0 + dV0);
+		trajectorySolver(&ctxs[0], &meteo, &bullet, &rifle, &scope, &inputs, &options, OUT &results);
+
+		expected.push_back((vertNominal - results.vertAngleUnits) * dist / 10 - (ctxs[0].throwAngle - throwNominal) * dist * 100);
+	}
+
+	double worst = 0;
+
+	for (const auto& point : points) {
+
+		double miss = std::numeric_limits<double>::max();
+
+		for (double e : expected) {
+			miss = std::min(miss, fabs(point.get<double>() - e));
+		}
+
+		worst = std::max(worst, miss);
+	}
+
+	const bool over = points.size() != dispersion.size() || worst > DISPERSION_CHECK_BUDGET;
+
+	printf("dispersion, V0.sd 10 m/s at %.0f m vs re-zeroed scalar shots: %zu samples, worst miss %.2e cm (budget %g)%s\n\n",
+		dist, points.size(), worst, DISPERSION_CHECK_BUDGET, over ? "  OVER BUDGET" : "");
+
+	return over;
+}
+
+struct corpusBullet {
+
+	const char* name;
+	uint16_t range;			/* meters, where the reference is still meaningful */
+	struct Bullet bullet;
+};
+
+static CDMDataArray cdmData;
+static MBCDataArray mbcData;
+
+static windDataArray complexWind = {{0, 3.0, 90, 0}, {300, 5.0, 120, 0}, {600, 2.0, 45, 0}, {900, 6.0, 270, 0}, {1200, 4.0, 300, 0}};
+
+static std::vector<corpusBullet> makeBullets() {
+
+	/* 6.5 mm 140 gr, i7 ~ 0.91 */
+	for (int i = 0; i < CMD_GRANULARITY; i++) {
+
+		double Mach = 0.5 + i * 0.1;
+		cdmData[i] = {Mach, 0.91 * DragCoefficient(G7, Mach)};
+	}
+
+	/* 6.5 mm 140 gr, BC falls off in the transonic region */
+	for (int i = 0; i < MBC_GRANULARITY; i++) {
+
+		double Mach = 0.5 + i * 0.1;
+		mbcData[i] = {Mach, Mach < 1.2 ? 0.300 + 0.012 * (1.2 - Mach) : 0.300 + 0.008 * (Mach - 1.2)};
+	}
+
+	return {
+		{".308 175gr G1", MAX_DIST_RANGE, {"*", G1, 0.505, 1, 1, 1, 790, 31.2, 175, 7.82, 15, 0, USELESS_COMPLEX_DATA, USELESS_COMPLEX_DATA}},
+		{".308 175gr G7", MAX_DIST_RANGE, {"*", G7, 0.243, 1, 1, 1, 790, 31.2, 175, 7.82, 15, 0, USELESS_COMPLEX_DATA, USELESS_COMPLEX_DATA}},
+		{".338 300gr G7", MAX_DIST_RANGE, {"*", G7, 0.448, 1, 1, 1, 830, 47.65, 300, 8.585, 15, 0, USELESS_COMPLEX_DATA, USELESS_COMPLEX_DATA}},
+		{".224 77gr G1", MAX_DIST_RANGE, {"*", G1, 0.372, 1, 1, 1, 840, 25.0, 77, 5.7, 15, 0, USELESS_COMPLEX_DATA, USELESS_COMPLEX_DATA}},
+		{"ball 7.6mm Gs", 200, {"*", Gs, 0.060, 1, 1, 1, 420, 7.6, 60, 7.6, 15, 0, USELESS_COMPLEX_DATA, USELESS_COMPLEX_DATA}},
+		{"6.5 140gr CDM", MAX_DIST_RANGE, {"*", CDM, 0.315, 1, 1, 1, 830, 35.1, 140, 6.71, 15, 0, &cdmData, USELESS_COMPLEX_DATA}},
+		{"6.5 140gr MBCG7", MAX_DIST_RANGE, {"*", MBCG7, 0.300, 1, 1, 1, 830, 35.1, 140, 6.71, 15, 0, USELESS_COMPLEX_DATA, &mbcData}},
+	};
+}
+
+struct corpusProfile {
+
+	int bullet;
+	struct Meteo meteo;
+};
+
+static std::vector<corpusProfile> makeProfiles(size_t bulletsCount) {
+
+	std::vector<corpusProfile> profiles;
+
+	for (size_t b = 0; b < bulletsCount; b++) {
+		for (int8_t T : {-20, 15, 35}) {
+			for (uint16_t P : {1000, 850}) {
+
+				profiles.push_back({(int)b, {T, P, 50, 0, 0, 0, SIMPLE_CASE, USELESS_COMPLEX_DATA}});
+				profiles.push_back({(int)b, {T, P, 50, 5.0, 90, 0, SIMPLE_CASE, USELESS_COMPLEX_DATA}});
+				profiles.push_back({(int)b, {T, P, 50, USELESS_DATA, USELESS_DATA, 0, COMPLEX_CASE, &complexWind}});
+			}
+		}
+	}
+
+	return profiles;
+}
+
+static const struct Rifle rifle {"*", 100, 5.0, 254, RIGHT_TWIST, NOT_HERE, 15, 1000, 0, POI_UP, 0, POI_RIGHT, 0};
+static const struct Scope scope {"*", MRAD_UNITS, 0.1, 0.1, MIL_DOT};
+
+static void solve(struct SolverContext* ctx, const struct corpusProfile* const profile, const std::vector<corpusBullet>& bullets,
+	uint16_t shotDistance, const struct Options* const options, struct Results* OUT results) {
+
+	const struct Inputs inputs {shotDistance, 0, 0, 90, 55, 0};
+	trajectorySolver(ctx, &profile->meteo, &bullets[profile->bullet].bullet, &rifle, &scope, &inputs, options, OUT results);
+}
+
+static double solveRate(struct SolverContext* ctx, const std::vector<corpusProfile>& profiles, const std::vector<corpusBullet>& bullets,
+	uint8_t precision) {
+
+	const struct Options options {OPTION_YES, OPTION_NO, OPTION_NO, OPTION_YES, FIXED_STEP, OPTION_YES, OPTION_NO, 0, 0, 0, 0, precision};
+	const int repeats = 20;
+	struct Results results;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int r = 0; r < repeats; r++) {
+		for (const auto& profile : profiles) {
+			solve(ctx, &profile, bullets, std::min<uint16_t>(1000, bullets[profile.bullet].range), &options, &results);
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return seconds * 1e9 / (repeats * profiles.size());
+}
+
+int main (int argc, char** argv) {
+
+	const uint16_t range = argc > 1 ? (uint16_t)atoi(argv[1]) : 2000;
+	const bool dragFailed = reportDragTables();
+	const bool dispersionFailed = reportDispersion();
+
+	const auto bullets = makeBullets();
+	const auto profiles = makeProfiles(bullets.size());
+
+	static struct SolverContext refCtx, testCtx;
+	struct Results ref, test;
+
+	struct Options options {OPTION_YES, OPTION_YES, OPTION_NO, OPTION_YES, FIXED_STEP, OPTION_NO, OPTION_NO, 0, 0, range, 0, PRECISION_DOUBLE};
+	uint16_t step = 0;
+
+	for (size_t p = 0; p < profiles.size(); p++) {
+
+		options.Range = std::min(range, bullets[profiles[p].bullet].range);
+
+		options.Precision = PRECISION_DOUBLE;
+		solve(&refCtx, &profiles[p], bullets, 100, &options, &ref);
+
+		options.Precision = PRECISION_FLOAT;
+		solve(&testCtx, &profiles[p], bullets, 100, &options, &test);
+
+		step = ref.table.step;
+
+		for (uint16_t i = 1; i <= ref.table.size; i++) {
+
+			uint16_t dist = i * ref.table.step;
+			auto band = bands.begin();
+
+			while (band->upTo < dist) {
+				band++;
+			}
+
+			double dVert = fabs(test.table.Vert[i][1] - ref.table.Vert[i][1]);
+			double dHoriz = fabs(test.table.Horiz[i][1] - ref.table.Horiz[i][1]);
+			double dTime = fabs(test.table.Time[i] - ref.table.Time[i]);
+
+			if (dVert > band->maxVert) {
+
+				band->maxVert = dVert;
+				band->worstDist = dist;
+				band->worstProfile = (int)p;
+			}
+
+			band->maxHoriz = std::max(band->maxHoriz, dHoriz);
+			band->maxTime = std::max(band->maxTime, dTime);
+		}
+	}
+
+	printf("float32 vs double, %zu profiles, range %u m, step %u m\n\n", profiles.size(), range, step);
+	printf("%-10s %12s %12s %12s %12s %10s  %s\n", "band, m", "budget MRAD", "vert MRAD", "horiz MRAD", "time ms", "worst, m", "worst profile");
+
+	bool failed = false;
+	uint16_t from = 0;
+
+	for (const auto& band : bands) {
+
+		if (from >= range) {
+			break;
+		}
+
+		bool over = band.maxVert > band.angleBudget || band.maxHoriz > band.angleBudget;
+		failed = failed || over;
+
+		const auto& worst = profiles[band.worstProfile];
+
+		printf("%4u-%-5u %12.4f %12.6f %12.6f %12.4f %10u  %s T=%d P=%u wind=%s%s\n", from, std::min(band.upTo, range), band.angleBudget,
+			band.maxVert, band.maxHoriz, band.maxTime * 1000, band.worstDist, bullets[worst.bullet].name, worst.meteo.T, worst.meteo.P,
+			worst.meteo.WindType == COMPLEX_CASE ? "complex" : (worst.meteo.windSpeed > 0 ? "simple" : "none"), over ? "  OVER BUDGET" : "");
+
+		from = band.upTo;
+	}
+
+	double refRate = solveRate(&refCtx, profiles, bullets, PRECISION_DOUBLE);
+	double testRate = solveRate(&testCtx, profiles, bullets, PRECISION_FLOAT);
+
+	printf("\nshot at 1000 m, early exit: double %.0f ns/solve, float32 %.0f ns/solve (x%.2f)\n", refRate, testRate, refRate / testRate);
+	printf("%s\n", failed || dragFailed || dispersionFailed ? "accuracy budget EXCEEDED" : "accuracy budget met");
+
+	return failed || dragFailed || dispersionFailed ? 1 : 0;
+}
@@ -0,0 +1,768 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "json_working_stuff.h"
+#include "drag_tables.h"
+#include "CThreadPool.h"
+
+/********************************************************************************************
+*
+*	Solver benchmark and golden results.
+*
+*	1. One drag coefficient lookup per model: DragCoefficient() vs DragCoefficientTabled()
+*	2. trajectorySolver() per drag model and shot distance (early exit, Gs at 1/10 of the distance)
+*	3. Specialized fixed-step loop of trajectorySolver() vs the generic per-step phases (drag model, wind
+*	   and range card resolved every metre, as the lockstep integrator does) per drag model, with the
+*	   replies of both compared
+*	4. trajectorySolver() per option set (G7, 1000 m)
+*	5. JSON stages of one request: parse, prepare, solve, serialize, end-to-end
+*	6. Golden corpus: every request of bench_golden.jsonl is solved and its reply compared
+*	   with the stored one (numbers within the relative tolerance, "Version" is ignored)
+*	7. Parallel stress: the corpus is repeated --rounds times in shuffled order, solved on a
+*	   CThreadPool of --threads threads (a SolverContext per thread, as in the daemon) and
+*	   every reply is compared byte for byte with a serial run of the same requests
+*
+*	Times are ns per operation, allocations are operator new calls per operation, both
+*	measured after one warm-up run (solver buffers are sized by then).
+*
+*	usage: ballistic_daemon_bench [--golden BENCH_GOLDEN] [--tolerance 1e-6] [--update] [--golden-only]
+*		[--threads 4] [--rounds 30]
+*	--update - rewrite the replies of the corpus with the current results
+*	exit code 1 - a reply differs from the golden one or a parallel reply from the serial one
+*
+********************************************************************************************/
+
+#ifndef BENCH_GOLDEN
+#define BENCH_GOLDEN "bench_golden.jsonl"
+#endif
+
+/* The thread pool and the logger allocate from their own threads */
+static std::atomic<size_t> allocations{0};
+
+/* Out of line, so the compiler never pairs an inlined free() with a new expression */
+__attribute__((noinline)) static void* countedAlloc(size_t size, size_t alignment) {
+
+	allocations++;
+
+	if(alignment <= alignof(std::max_align_t)) {
+		return malloc(size ? size : 1);
+	}
+
+	/* aligned_alloc() wants a multiple of the alignment */
+	return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+__attribute__((noinline)) static void countedFree(void* p) {
+
+	free(p);
+}
+
+void* operator new(size_t size) {
+
+	if(void* p = countedAlloc(size, 0)) {
+		return p;
+	}
+
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+
+	if(void* p = countedAlloc(size, (size_t)alignment)) {
+		return p;
+	}
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAlloc(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAlloc(size, (size_t)alignment); }
+
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t) noexcept { countedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { countedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { countedFree(p); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char* baseRequest = R"boot({
+	"Bullet": {"DF": "G7", "BC": 0.448, "CDM": {}, "MBC": {}, "V0": 830, "lenght": 47.65, "weight": 300, "diam.": 8.585,
+		"CCF_0.9": 1, "CCF_1.0": 1, "CCF_1.1": 1, "V0temp": 15, "therm": 0},
+	"Rifle": {"zero": 100, "scope_height": 4.9, "twist": 228, "twist.dir": "R", "zero.atm": "not_here", "zero.temp": 22,
+		"zero.press": 995, "POI_vert": 0, "POI_horiz": 0, "roll": 0},
+	"Scope": {"units": "MRAD", "vert.click": 0.1, "horiz.click": 0.1},
+	"Inputs": {"dist.": 1000, "terrain_angle": 0, "target_azimuth": 0, "latitude": 55, "targ.speed": 0},
+	"Options": {"koriolis": true, "rangecard": false, "therm.corr": false, "aerojump": true},
+	"Meteo": {"temp.": 15, "press.": 1013, "humid.": 50, "wind": "simple", "windage": [{"dist.": 0, "speed": 3, "dir.": 90, "incl.": 0}]},
+	"Token": "bench"
+})boot";
+
+struct benchResult {
+
+	double ns;
+	double allocs;
+};
+
+template<typename F>
+static benchResult measure(F&& body) {
+
+	const double minSeconds = 0.2;
+
+	body();
+
+	const size_t allocationsBefore = allocations;
+	const auto start = std::chrono::steady_clock::now();
+	size_t runs = 0;
+	double seconds = 0;
+
+	do {
+
+		body();
+		runs++;
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	} while(seconds < minSeconds);
+
+	return {seconds * 1e9 / runs, (double)(allocations - allocationsBefore) / runs};
+}
+
+static void setDragModel(nlohmann::json& body, const std::string& model) {
+
+	body["Bullet"]["DF"] = model;
+
+	if(model == "CDM") {
+
+		/* 6.5 mm 140 gr like drag curve, Mach 0.5 ... 3.5 */
+		body["Bullet"]["CDM"] = nlohmann::json::array();
+
+		for(int i = 0; i < CMD_GRANULARITY; i++) {
+
+			double Mach = 0.5 + i * 0.1;
+			body["Bullet"]["CDM"][i] = Mach < 1.0 ? 0.145 + 0.01 * Mach * Mach : (Mach < 1.2 ? 0.38 : 0.38 - 0.045 * (Mach - 1.2));
+		}
+	}
+	else if(model == "MBCG1" || model == "MBCG7") {
+
+		const double BC = model == "MBCG1" ? 0.505 : 0.243;
+		body["Bullet"]["MBC"] = nlohmann::json::array();
+
+		for(int i = 0; i < MBC_GRANULARITY; i++) {
+			body["Bullet"]["MBC"][i] = BC * (1.0 - 0.01 * i);
+		}
+	}
+	else if(model == "G1") {
+		body["Bullet"]["BC"] = 0.768;
+	}
+	else if(model == "Gs") {
+
+		body["Bullet"]["BC"] = 0.05;
+		body["Bullet"]["V0"] = 300;
+	}
+}
+
+static void benchDragLookups() {
+
+	/* Mach of a flight, transonic included, in a shuffled order so branches are not predicted */
+	std::vector<double> machs(4096);
+	std::mt19937 rng(54321);
+	std::uniform_real_distribution<double> mach(0.5, 3.0);
+
+	for(auto& M : machs) {
+		M = mach(rng);
+	}
+
+	struct dragModel {
+
+		const char* name;
+		uint8_t dragFunction;
+	};
+
+	const std::vector<dragModel> models {{"G1", G1}, {"G7", G7}, {"Gs", Gs}};
+	volatile double sink = 0;
+
+	printf("drag coefficient lookup, Mach 0.5 ... 3.0\n%-8s %18s %18s\n", "model", "polynomial, ns", "table, ns");
+
+	for(const auto& model : models) {
+
+		const auto polynomial = measure([&]() {
+
+			double sum = 0;
+
+			for(double M : machs) {
+				sum += DragCoefficient(model.dragFunction, M);
+			}
+			sink = sum;
+		});
+
+		const auto tabled = measure([&]() {
+
+			double sum = 0;
+
+			for(double M : machs) {
+				sum += DragCoefficientTabled(model.dragFunction, M);
+			}
+			sink = sum;
+		});
+
+		printf("%-8s %18.1f %18.1f\n", model.name, polynomial.ns / machs.size(), tabled.ns / machs.size());
+	}
+
+	(void)sink;
+	printf("\n");
+}
+
+/* Solver alone, request structures prepared once */
+static benchResult measureSolver(const nlohmann::json& body, SolverContext& ctx) {
+
+	s2::datapreparator dp;
+
+	const auto bullet = dp.parseForBulletData(body);
+	const auto rifle = dp.parseForRifleData(body);
+	const auto scope = dp.parseForScopeData(body);
+	const auto meteo = dp.parseForMeteoData(body);
+	const auto options = dp.parseForOptions(body);
+	const auto inputs = dp.parseForInputs(body);
+
+	Results results;
+
+	return measure([&]() {
+		trajectorySolver(&ctx, &meteo, &bullet, &rifle, &scope, &inputs, &options, OUT &results);
+	});
+}
+
+static void benchDragModels(SolverContext& ctx) {
+
+	const std::vector<std::string> models {"G1", "G7", "Gs", "CDM", "MBCG1", "MBCG7"};
+	const std::vector<uint16_t> distances {100, 300, 600, 1000, 1500};
+
+	printf("trajectorySolver(), early exit, ns/solve (allocs/solve)\n%-8s", "model");
+
+	for(auto dist : distances) {
+		printf("%16u m", dist);
+	}
+	printf("\n");
+
+	for(const auto& model : models) {
+
+		printf("%-8s", model.c_str());
+
+		for(auto dist : distances) {
+
+			auto body = nlohmann::json::parse(baseRequest);
+			setDragModel(body, model);
+			body["Inputs"]["dist."] = model == "Gs" ? dist / 10 : dist;
+			body["Options"]["early.exit"] = true;
+
+			const auto r = measureSolver(body, ctx);
+			printf("%12.0f (%3.0f)", r.ns, r.allocs);
+		}
+		printf("\n");
+	}
+	printf("\n");
+}
+
+static void complexWind(nlohmann::json& body, int segments) {
+
+	body["Meteo"]["wind"] = "complex";
+
+	for(int i = 0; i < segments; i++) {
+		body["Meteo"]["windage"][i] = {{"dist.", i * 1250 / segments}, {"speed", 2 + i % 5}, {"dir.", (45 + 60 * i) % 360}, {"incl.", 0}};
+	}
+}
+
+/* trajectorySolver() through the public solver phases, one generic loop for every drag model and option */
+static void genericSolver(SolverContext* ctx, const SolverRequest* const req) {
+
+	trajectoryState state;
+	prepareSolver(ctx, req, &state);
+
+	const double G_f = ctx->setup.G_f;
+	const double A0_f = ctx->setup.A0_f;
+
+	for(uint16_t i = 0; i <= ctx->setup.range; i++) {
+
+		prepareSolverStep(ctx, req, i, state.M);
+
+		const double K = ctx->dragInfo.CD * ctx->dragInfo.C3;
+		const double Wx = ctx->windComps.Wx;
+		const double Wy = ctx->windComps.Wy;
+		const double Wz = ctx->windComps.Wz;
+
+		const double Vx1 = state.Vx, Vy1 = state.Vy, Vz1 = state.Vz, V_1 = state.V;
+
+		const double C4 = (K * V_1) / Vx1;
+		const double A1_ = C4 * (Vx1 - Wx);
+		const double A2_ = (C4 * (Vy1 - Wy)) - (G_f / Vx1);
+		const double A3_ = C4 * (Vz1 - Wz);
+
+		const double Vx2 = Vx1 + A1_ * STEP_f;
+		const double Vy2 = Vy1 + A2_ * STEP_f;
+		const double Vz2 = Vz1 + A3_ * STEP_f;
+		const double V_2 = sqrt(Vx2 * Vx2 + Vy2 * Vy2 + Vz2 * Vz2);
+
+		const double C5 = (K * V_2) / Vx2;
+		const double A4_ = C5 * (Vx2 - Wx);
+		const double A5_ = (C5 * (Vy2 - Wy)) - (G_f / Vx2);
+		const double A6_ = C5 * (Vz2 - Wz);
+
+		const double Vx3 = Vx1 + (0.5 * (A1_ + A4_)) * STEP_f;
+		const double Vy3 = Vy1 + (0.5 * (A2_ + A5_)) * STEP_f;
+		const double Vz3 = Vz1 + (0.5 * (A3_ + A6_)) * STEP_f;
+		const double V_3 = sqrt(Vx3 * Vx3 + Vy3 * Vy3 + Vz3 * Vz3);
+
+		state.H2 = state.H2 + ((Vy1 + Vy3) / (Vx1 + Vx3)) * STEP_f;
+		state.W2 = state.W2 + ((Vz1 + Vz3) / (Vx1 + Vx3)) * STEP_f;
+		state.Time = state.Time + ((2 * STEP_f) / (Vx2 + Vx3));
+		state.Vx = Vx3; state.Vy = Vy3; state.Vz = Vz3; state.V = V_3;
+		state.M = V_3 * A0_f;
+
+		recordSolverStep(ctx, req, i, &state, V_1);
+
+		if(solverReachedEnd(ctx, req, i, state.M)) {
+			break;
+		}
+	}
+
+	finalizeSolver(ctx, req);
+}
+
+static void benchSpecializedLoop(SolverContext& ctx) {
+
+	const std::vector<std::string> models {"G1", "G7", "Gs", "CDM", "MBCG1", "MBCG7"};
+
+	struct loopCase {
+
+		const char* name;
+		void (*apply)(nlohmann::json& body);
+	};
+
+	const std::vector<loopCase> cases {
+		{"shot, early exit", [](nlohmann::json& b) { b["Options"]["early.exit"] = true; }},
+		{"range card", [](nlohmann::json& b) { b["Options"]["rangecard"] = true; }},
+		{"complex wind", [](nlohmann::json& b) { complexWind(b, WIND_GRANULARITY); }},
+	};
+
+	printf("fixed-step loop, 1000 m (Gs 100 m), ns/solve\n%-8s %-18s %14s %14s %8s %10s\n", "model", "options", "specialized", "generic", "gain", "replies");
+
+	for(const auto& model : models) {
+		for(const auto& c : cases) {
+
+			auto body = nlohmann::json::parse(baseRequest);
+			setDragModel(body, model);
+			body["Inputs"]["dist."] = model == "Gs" ? 100 : 1000;
+			c.apply(body);
+
+			s2::datapreparator dp;
+
+			const auto bullet = dp.parseForBulletData(body);
+			const auto rifle = dp.parseForRifleData(body);
+			const auto scope = dp.parseForScopeData(body);
+			const auto meteo = dp.parseForMeteoData(body);
+			const auto options = dp.parseForOptions(body);
+			const auto inputs = dp.parseForInputs(body);
+
+			Results specializedResults, genericResults;
+			const SolverRequest req {&meteo, &bullet, &rifle, &scope, &inputs, &options, &genericResults};
+
+			const auto specialized = measure([&]() {
+				trajectorySolver(&ctx, &meteo, &bullet, &rifle, &scope, &inputs, &options, OUT &specializedResults);
+			});
+
+			std::string specializedReply, genericReply;
+			dp.serializeResult(specializedResults, specializedReply);
+
+			const auto generic = measure([&]() {
+				genericSolver(&ctx, &req);
+			});
+
+			dp.serializeResult(genericResults, genericReply);
+
+			printf("%-8s %-18s %14.0f %14.0f %7.0f%% %10s\n", model.c_str(), c.name, specialized.ns, generic.ns,
+				100.0 * (generic.ns - specialized.ns) / generic.ns, specializedReply == genericReply ? "same" : "DIFFER");
+		}
+	}
+	printf("\n");
+}
+
+static void benchOptionSets(SolverContext& ctx) {
+
+	struct optionSet {
+
+		const char* name;
+		void (*apply)(nlohmann::json& body);
+	};
+
+	const std::vector<optionSet> sets {
+		{"default (full range)", [](nlohmann::json&) {}},
+		{"early exit", [](nlohmann::json& b) { b["Options"]["early.exit"] = true; }},
+		{"early exit + mach dists", [](nlohmann::json& b) { b["Options"]["early.exit"] = true; b["Options"]["mach.dists"] = true; }},
+		{"range card", [](nlohmann::json& b) { b["Options"]["rangecard"] = true; }},
+		{"range card 1500 / 10 m", [](nlohmann::json& b) {
+			b["Options"]["rangecard"] = true; b["Options"]["range"] = 1500; b["Options"]["table.step"] = 10; }},
+		{"complex wind", [](nlohmann::json& b) { complexWind(b, WIND_GRANULARITY); }},
+		{"complex wind, 20 segments", [](nlohmann::json& b) { complexWind(b, 20); }},
+		{"complex wind, 20 interp.", [](nlohmann::json& b) { complexWind(b, 20); b["Options"]["wind.interp"] = true; }},
+		{"roll 7, therm. corr.", [](nlohmann::json& b) {
+			b["Rifle"]["roll"] = 7; b["Options"]["therm.corr"] = true; b["Bullet"]["therm"] = 1.6; b["Bullet"]["V0temp"] = 25; }},
+		{"no koriolis, no aerojump", [](nlohmann::json& b) { b["Options"]["koriolis"] = false; b["Options"]["aerojump"] = false; }},
+		{"adaptive", [](nlohmann::json& b) { b["Options"]["integrator"] = "adaptive"; }},
+		{"adaptive, early exit", [](nlohmann::json& b) { b["Options"]["integrator"] = "adaptive"; b["Options"]["early.exit"] = true; }},
+		{"float", [](nlohmann::json& b) { b["Options"]["precision"] = "float"; }},
+		{"float, early exit", [](nlohmann::json& b) { b["Options"]["precision"] = "float"; b["Options"]["early.exit"] = true; }},
+	};
+
+	printf("trajectorySolver(), G7, 1000 m\n%-28s %14s %14s\n", "options", "ns/solve", "allocs/solve");
+
+	for(const auto& set : sets) {
+
+		auto body = nlohmann::json::parse(baseRequest);
+		set.apply(body);
+
+		const auto r = measureSolver(body, ctx);
+		printf("%-28s %14.0f %14.1f\n", set.name, r.ns, r.allocs);
+	}
+	printf("\n");
+}
+
+static void benchJsonStages(SolverContext& ctx) {
+
+	auto body = nlohmann::json::parse(baseRequest);
+	body["Options"]["rangecard"] = true;
+
+	const std::string request = body.dump();
+	std::string workBuffer;
+
+	s2::datapreparator dp;
+	dp.getToken(body);
+
+	Bullet bullet = dp.parseForBulletData(body);
+	Rifle rifle = dp.parseForRifleData(body);
+	Scope scope = dp.parseForScopeData(body);
+	Meteo meteo = dp.parseForMeteoData(body);
+	Options options = dp.parseForOptions(body);
+	Inputs inputs = dp.parseForInputs(body);
+	Results results;
+
+	struct stage {
+
+		const char* name;
+		benchResult result;
+	};
+
+	const std::vector<stage> stages {
+		{"parse", measure([&]() {
+			auto parsed = nlohmann::json::parse(request);
+		})},
+		{"prepare", measure([&]() {
+			dp.getToken(body);
+			bullet = dp.parseForBulletData(body);
+			rifle = dp.parseForRifleData(body);
+			scope = dp.parseForScopeData(body);
+			meteo = dp.parseForMeteoData(body);
+			options = dp.parseForOptions(body);
+			inputs = dp.parseForInputs(body);
+		})},
+		{"solve", measure([&]() {
+			trajectorySolver(&ctx, &meteo, &bullet, &rifle, &scope, &inputs, &options, OUT &results);
+		})},
+		{"serialize", measure([&]() {
+			dp.serializeResult(results, workBuffer);
+		})},
+		{"end-to-end", measure([&]() {
+			s2::solveBallistics(nlohmann::json::parse(request), workBuffer, ctx);
+		})},
+	};
+
+	printf("JSON request, G7, 1000 m, range card (%zu bytes in, %zu bytes out)\n%-28s %14s %14s\n",
+		request.size(), workBuffer.size(), "stage", "ns/request", "allocs/request");
+
+	for(const auto& s : stages) {
+		printf("%-28s %14.0f %14.1f\n", s.name, s.result.ns, s.result.allocs);
+	}
+	printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool sameReply(const nlohmann::json& got, const nlohmann::json& golden, double tolerance, const std::string& path,
+	std::string& OUT where) {
+
+	if(got.is_number() && golden.is_number()) {
+
+		const double a = got.get<double>();
+		const double b = golden.get<double>();
+
+		if(fabs(a - b) > tolerance * std::max(1.0, fabs(b))) {
+
+			where = path + ": " + got.dump() + " != " + golden.dump();
+			return false;
+		}
+		return true;
+	}
+
+	if(got.type() != golden.type() || got.size() != golden.size()) {
+
+		where = path + ": " + (got.size() > 8 ? "size " + std::to_string(got.size()) : got.dump()) + " != " +
+			(golden.size() > 8 ? "size " + std::to_string(golden.size()) : golden.dump());
+		return false;
+	}
+
+	if(got.is_object()) {
+
+		for(auto it = golden.begin(); it != golden.end(); ++it) {
+
+			if(it.key() == "Version") {
+				continue;
+			}
+
+			if(!got.contains(it.key())) {
+
+				where = path + "." + it.key() + ": missing";
+				return false;
+			}
+
+			if(!sameReply(got[it.key()], it.value(), tolerance, path + "." + it.key(), where)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	if(got.is_array()) {
+
+		for(size_t i = 0; i < got.size(); i++) {
+
+			if(!sameReply(got[i], golden[i], tolerance, path + "[" + std::to_string(i) + "]", where)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	if(got != golden) {
+
+		where = path + ": " + got.dump() + " != " + golden.dump();
+		return false;
+	}
+	return true;
+}
+
+/* Corpus line: {"request": {...}, "reply": {...}}, the reply is null until --update */
+static bool loadCorpus(const std::string& path, std::vector<nlohmann::json>& OUT corpus) {
+
+	std::ifstream in(path);
+
+	if(!in) {
+
+		printf("golden corpus %s not found\n", path.c_str());
+		return false;
+	}
+
+	std::string line;
+
+	while(std::getline(in, line)) {
+
+		if(!line.empty()) {
+			corpus.push_back(nlohmann::json::parse(line));
+		}
+	}
+
+	return true;
+}
+
+static int checkGolden(const std::string& path, double tolerance, bool update, SolverContext& ctx) {
+
+	std::vector<nlohmann::json> corpus;
+
+	if(!loadCorpus(path, OUT corpus)) {
+		return 1;
+	}
+
+	std::string workBuffer;
+	size_t failed = 0;
+
+	for(size_t i = 0; i < corpus.size(); i++) {
+
+		s2::solveBallistics(corpus[i]["request"], workBuffer, ctx);
+		auto reply = nlohmann::json::parse(workBuffer);
+
+		if(update) {
+
+			corpus[i]["reply"] = reply;
+			continue;
+		}
+
+		std::string where;
+
+		if(!sameReply(reply, corpus[i]["reply"], tolerance, "", where)) {
+
+			printf("golden #%zu (%s) differs at %s\n", i, corpus[i]["request"]["Token"].get<std::string>().c_str(), where.c_str());
+			failed++;
+		}
+	}
+
+	if(update) {
+
+		std::ofstream out(path, std::ios::trunc);
+
+		for(const auto& entry : corpus) {
+			out << entry.dump() << "\n";
+		}
+
+		printf("golden corpus %s: %zu replies updated\n", path.c_str(), corpus.size());
+		return 0;
+	}
+
+	printf("golden corpus %s: %zu of %zu replies match (tolerance %g)\n", path.c_str(), corpus.size() - failed, corpus.size(), tolerance);
+	return failed ? 1 : 0;
+}
+
+/* The same requests from the pool threads must give the same bytes as one after another */
+static int checkParallel(const std::string& path, int threads, size_t rounds, SolverContext& ctx) {
+
+	std::vector<nlohmann::json> corpus;
+
+	if(!loadCorpus(path, OUT corpus) || corpus.empty()) {
+		return 1;
+	}
+
+	std::vector<std::string> requests;
+
+	for(size_t round = 0; round < rounds; round++) {
+		for(const auto& entry : corpus) {
+			requests.push_back(entry["request"].dump());
+		}
+	}
+
+	/* Drag models, options and early exits interleave on every thread */
+	std::mt19937 rng(12345);
+	std::shuffle(requests.begin(), requests.end(), rng);
+
+	std::vector<std::string> serial(requests.size());
+
+	const auto serialStart = std::chrono::steady_clock::now();
+
+	for(size_t i = 0; i < requests.size(); i++) {
+		s2::solveBallistics(requests[i], serial[i], ctx);
+	}
+
+	const double serialSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - serialStart).count();
+
+	std::vector<std::string> parallel(requests.size());
+	std::vector<SolverContext> contexts(threads);
+	std::vector<std::future<void>> done;
+
+	const auto parallelStart = std::chrono::steady_clock::now();
+
+	{
+		threadpool::CThreadPool pool(threads);
+
+		for(size_t i = 0; i < requests.size(); i++) {
+
+			done.push_back(pool.push([&, i](int id) {
+				s2::solveBallistics(requests[i], parallel[i], contexts[id]);
+			}));
+		}
+
+		for(auto& f : done) {
+			f.get();
+		}
+	}
+
+	const double parallelSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parallelStart).count();
+
+	size_t failed = 0;
+
+	for(size_t i = 0; i < requests.size(); i++) {
+
+		if(parallel[i].size() != serial[i].size() || memcmp(parallel[i].data(), serial[i].data(), serial[i].size())) {
+
+			if(failed++ < 10) {
+				printf("parallel #%zu (%s) differs from the serial reply\n", i,
+					nlohmann::json::parse(requests[i])["Token"].get<std::string>().c_str());
+			}
+		}
+	}
+
+	printf("parallel stress: %zu of %zu replies on %d threads match the serial ones (serial %.2f s, parallel %.2f s)\n",
+		requests.size() - failed, requests.size(), threads, serialSeconds, parallelSeconds);
+
+	return failed ? 1 : 0;
+}
+
+int main (int argc, char** argv) {
+
+	std::string goldenPath = BENCH_GOLDEN;
+	double tolerance = 1e-6;
+	bool update = false;
+	bool goldenOnly = false;
+	int threads = std::max(2u, std::thread::hardware_concurrency());
+	size_t rounds = 30;
+
+	for(int i = 1; i < argc; i++) {
+
+		if(!strcmp(argv[i], "--golden") && i + 1 < argc) {
+			goldenPath = argv[++i];
+		}
+		else if(!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+			tolerance = atof(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "--update")) {
+			update = true;
+		}
+		else if(!strcmp(argv[i], "--golden-only")) {
+			goldenOnly = true;
+		}
+		else if(!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			threads = std::max(1, atoi(argv[++i]));
+		}
+		else if(!strcmp(argv[i], "--rounds") && i + 1 < argc) {
+			rounds = strtoul(argv[++i], nullptr, 10);
+		}
+	}
+
+	static SolverContext ctx;
+
+	if(!goldenOnly && !update) {
+
+		benchDragLookups();
+		benchDragModels(ctx);
+		benchSpecializedLoop(ctx);
+		benchOptionSets(ctx);
+		benchJsonStages(ctx);
+	}
+
+	const int golden = checkGolden(goldenPath, tolerance, update, ctx);
+
+	if(update || !rounds) {
+		return golden;
+	}
+
+	return checkParallel(goldenPath, threads, rounds, ctx) | golden;
+}
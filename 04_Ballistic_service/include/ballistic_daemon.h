@@ -4,11 +4,28 @@
 #include "base_daemon.h"
 #include "zhelpers.h"
 #include "simple_lockfree_queue.h"
+#include "trajectory_solver.h"
+#include "zeroing_cache.h"
+#include "result_cache.h"
+#include "trajectory_trace.h"
+#include "dispersion_solver.h"
+#include "inverse_solver.h"
+#include "truing_solver.h"
+#include "wind_estimator.h"
+#include "sweep_solver.h"
+#include "trajectory_spline.h"
+#include "profile_registry.h"
+#include "response_surface.h"
+#include "sharded_lru.h"
+#include "nlohmann.h"
 
 ///////////////////////////////////////////////////////////////////////////////////
 
+#include <atomic>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////////
 
@@ -23,10 +40,64 @@ private:
 	
 	SimpleLockFreeQueue<std::string> m_resultsQueue;
 
+	/* Solver scratch state, one per pool thread (indexed by thread id) */
+	std::vector<SolverContext> m_solverContexts;
+
+	/* Контексты для выборок Монте-Карло, по LOCKSTEP_MAX_LANES на поток, без кэшей */
+	std::vector<SolverContext> m_sampleContexts;
+
+	/* Кэш углов бросания для пристрелки в другой атмосфере, общий для всех контекстов (nullptr - отключен) */
+	std::unique_ptr<zeroingCache> m_zeroingCache{nullptr};
+
+	/* Трассы последних траекторий по профилю и атмосфере для пересчета только бокового сноса (nullptr - отключен) */
+	std::unique_ptr<trajectoryTraceCache> m_traceCache{nullptr};
+
+	/* Кэш готовых ответов по квантованным входным данным (nullptr - отключен) */
+	std::unique_ptr<s2::resultcache> m_resultCache{nullptr};
+
+	/* Сплайны траекторий для запросов Spline (nullptr - отключен, каждый запрос строит свой) */
+	std::unique_ptr<s2::splineCache> m_splineCache{nullptr};
+
+	/* Поверхности отклика по температуре, давлению и влажности для активных запросов (nullptr - отключены) */
+	std::unique_ptr<s2::surfaceCache> m_surfaceCache{nullptr};
+
+	/* Зарегистрированные профили (пуля, винтовка, прицел) по идентификатору "Profile" (nullptr - регистрация отключена) */
+	std::unique_ptr<s2::profileregistry> m_profiles{nullptr};
+
+	/* Самый новый запрос каждого Token и вида (пакет, разброс, одиночный выстрел и т.д.) в очереди или в расчете 
+	(номер по приходу), запросы того же вида с тем же Token старше него не считаются или не отправляются 
+	(m_supersede == false - отвечаются все) */
+	bool m_supersede{false};
+	uint64_t m_arrivals{0};
+	std::unordered_map<std::string, uint64_t> m_freshest;
+	std::mutex m_freshestMutex;
+	std::atomic<uint64_t> m_skipped{0};
+	std::atomic<uint64_t> m_dropped{0};
+
+	/* Последние оценки ветра по Token для "wind": "estimated", давно не использованные вытесняются 
+	(nullptr - оценки не запоминаются) */
+	std::unique_ptr<shardedLRU<std::string, nlohmann::json>> m_windEstimates{nullptr};
+
 private:
 
 	bool initZMQworkers();
+	void initSolverContexts();
 	void initQueueThread();
+	void solveRequest(int threadId, const std::string& data, nlohmann::json& bodyJson, std::string& workingBuffer);
+	void solveBatch(int threadId, const nlohmann::json& bodyJson, const s2::profile* registered, std::string& workingBuffer);
+	void solveDispersion(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer);
+	void solveInverse(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer);
+	void solveTruing(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer);
+	void solveWindEstimate(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer);
+	void solveSweep(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer);
+	void solveSpline(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer);
+	bool solveFromSurface(const nlohmann::json& bodyJson, const std::shared_ptr<const s2::profile>& registered, 
+		std::string& workingBuffer);
+	void solveRegister(const nlohmann::json& bodyJson, std::string& workingBuffer);
+	void applyWindEstimate(nlohmann::json& bodyJson);
+	void solveCommand(const nlohmann::json& bodyJson, std::string& workingBuffer);
+	bool isSuperseded(const std::string& key, uint64_t arrival);
+	bool finishRequest(const std::string& key, uint64_t arrival);
 	void sendResultsToQueue(std::string&& workingBuffer);
 	void sendResultsToSubscribers();
 	void stopZMQ();
@@ -0,0 +1,132 @@
+#ifndef _DISPERSION_SOLVER_H_
+#define _DISPERSION_SOLVER_H_
+
+#include "trajectory_solver_API.h"
+#include "trajectory_solver.h"
+#include "json_working_stuff.h"
+#include "nlohmann.h"
+
+#include <string>
+#include <vector>
+
+/*******************************************************************************************
+
+Monte-Carlo dispersion: the usual single-shot sections plus
+
+"Dispersion": {"samples": 1000, "seed": 1, "V0.sd": 3, "therm.sd": 0.1, "BC.sd": 0.01,
+	"wind.speed.sd": 0.7, "wind.dir.sd": 15, "dist.sd": 5, "POI.sd": [0.5, 0.5], "precision.sd": 0.15,
+	"target": {"width": 45, "height": 45}, "points": false}
+
+	V0.sd - m/s, therm.sd - same units as Bullet.therm, BC.sd - relative (0.01 - 1 %, scales
+	MBC/CDM points too), wind.speed.sd - m/s, wind.dir.sd - degrees (every complex wind segment
+	independently), dist.sd - error of the measured distance in meters, POI.sd - cm at zero
+	distance (vertical, horizontal), precision.sd - MRAD (rifle and ammo group), target - cm,
+	rectangle centered at the point of aim ("diam." instead of width/height - circle),
+	points - also reply every impact. All fields are optional, sd defaults to 0.
+
+The shooter dials the nominal solution for the measured distance, every sample is the shot
+at the true distance with perturbed inputs and the bore angle of the nominal zero (the rifle
+is zeroed once, shot-to-shot MV/BC changes do not re-zero it). Impact offsets are dialed
+minus needed correction at the true distance, in cm, positive in the direction of a positive
+correction.
+
+Sample i draws its inputs from its own random stream (seed, i), so results do not depend
+on how samples are spread over threads and lockstep lanes. Samples are solved without
+allocations, V0 and wind direction are integers in the API and are rounded stochastically.
+
+Reply: {"Version": "...", "Token": "...", "Dispersion": {"samples": 1000, "hit.prob": 0.93,
+	"vert.": [mean, sd], "horiz.": [mean, sd], "corr": 0.1, "radius": [r50, r90],
+	"points": {"vert.": [...], "horiz.": [...]}}}
+
+*******************************************************************************************/
+
+#define DISPERSION_DEFAULT_SAMPLES 1000
+#define DISPERSION_MAX_SAMPLES 20000
+
+namespace s2 {
+
+	bool isDispersionRequest(const nlohmann::json& bodyJson);
+
+	struct dispersionSpread {
+
+		uint32_t samples{DISPERSION_DEFAULT_SAMPLES};
+		uint64_t seed{1};
+
+		double V0{0};
+		double therm{0};
+		double BC{0};
+		double windSpeed{0};
+		double windDir{0};
+		double dist{0};
+		double POIvert{0};
+		double POIhoriz{0};
+		double precision{0};
+
+		double targetWidth{0};
+		double targetHeight{0};
+		double targetDiameter{0};		/* > 0 - round target */
+		bool points{false};
+	};
+
+	struct impactPoint { /* cm at the true distance */
+
+		double vert;
+		double horiz;
+	};
+
+	class dispersionsolver {
+
+		private:
+
+			datapreparator m_dp;
+
+			Bullet m_bullet{};
+			Rifle m_rifle{};
+			Scope m_scope{};
+			Meteo m_meteo{};
+			Options m_options{};
+			Inputs m_inputs{};
+
+			dispersionSpread m_spread;
+
+			/* Nominal solution: corrections at the true distance, MRAD, and range-card
+			rows (1 m) around it for the dialed correction at the measured distance */
+			double m_vertNominal{0};
+			double m_horizNominal{0};
+			double m_throwNominal{0};		/* radians */
+			uint16_t m_rowsFrom{0};
+			std::vector<double> m_rowsVert;
+			std::vector<double> m_rowsHoriz;
+
+			std::vector<impactPoint> m_impacts;
+
+			struct sample {
+
+				Bullet bullet;
+				Meteo meteo;
+				Results results;
+				windDataArray wind;
+				CDMDataArray cdm;
+				MBCDataArray mbc;
+
+				double measuredDist;
+				double vertNoise;		/* MRAD */
+				double horizNoise;
+			};
+
+			Options sampleOptions(bool nominal) const;
+			void perturb(size_t index, sample& OUT s) const;
+			double dialedRow(const std::vector<double>& rows, double dist) const;
+			impactPoint impact(const sample& s, const SolverContext& ctx) const;
+
+		public:
+			explicit dispersionsolver(const nlohmann::json& bodyJson);
+
+			size_t size() const;
+			void solveNominal(SolverContext& ctx);
+			void solveSamples(size_t first, size_t count, SolverContext* const ctxs[]);
+			void serializeResults(std::string& workBuffer) const;
+	};
+}
+
+#endif /* _DISPERSION_SOLVER_H_ */
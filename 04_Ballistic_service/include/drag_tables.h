@@ -0,0 +1,49 @@
+#ifndef __DRAG_TABLES_H__
+#define __DRAG_TABLES_H__
+
+#include <stdint.h>
+#include "trajectory_solver_API.h"
+
+/****************************************************************
+*
+*	G1/G7/Gs drag functions sampled on a uniform Mach grid
+*	(DRAG_TABLE_STEP, 0 .. DRAG_TABLE_MAX_MACH), tables are
+*	generated at compile time from the precise approximations
+*	of DragCoefficient(). Lookup is an index computation plus
+*	linear interpolation, outside the grid (and for SLOW_DEVICE
+*	builds) DragCoefficient() is called as before.
+*
+*	Accuracy vs DragCoefficient(): within 2.1e-5 absolute off the
+*	approximation breakpoints, inside one grid cell around a
+*	breakpoint the step of the piecewise approximation is smoothed
+*	(see ballistic_daemon_accuracy).
+*
+****************************************************************/
+
+#define DRAG_TABLE_STEP 0.001
+#define DRAG_TABLE_MAX_MACH 4.0
+#define DRAG_TABLE_SIZE 4001	/* DRAG_TABLE_MAX_MACH / DRAG_TABLE_STEP + 1 */
+
+double DragCoefficientTabled (uint8_t DragFunction, double M);
+
+/* Grid of G1/G7/Gs (NULL - no table), for loops that pick it once per request */
+const double* dragTableFor (uint8_t DragFunction);
+
+double DragCoefficient (uint8_t DragFunction, double M);
+
+static inline double DragCoefficientFromTable (const double* table, uint8_t DragFunction, double M) {
+
+	const double X = M * (1.0 / DRAG_TABLE_STEP);
+
+	if (table && X >= 0.0 && X < (DRAG_TABLE_SIZE - 1)) {
+
+		const int i = (int)X;
+		const double Cd1 = table[i];
+
+		return Cd1 + (table[i + 1] - Cd1) * (X - i);
+	}
+
+	return DragCoefficient (DragFunction, M);
+}
+
+#endif /* __DRAG_TABLES_H__ */
@@ -0,0 +1,76 @@
+#ifndef _INVERSE_SOLVER_H_
+#define _INVERSE_SOLVER_H_
+
+#include "trajectory_solver_API.h"
+#include "trajectory_solver.h"
+#include "json_working_stuff.h"
+#include "nlohmann.h"
+
+#include <string>
+#include <vector>
+
+/*******************************************************************************************
+
+Inverse queries: the usual single-shot sections (Inputs.dist. only picks the aerojump wind
+segment) plus
+
+"Inverse": [{"vert.": 5.2}, {"clicks": 52}, {"drop": 150}, {"clicks": 52, "dist.": 900}, {"mpbr": 20}]
+
+	vert. - correction in scope units, clicks - vertical clicks: distances needing it
+	drop - cm below the line of sight (negative - above): distances where the bullet is there
+	clicks + dist. - impact in cm (positive - high) at that distance with the clicks dialed
+	mpbr - target height in cm: point-blank range, the first stretch where the bullet stays
+	within +-mpbr/2 of the line of sight, with the current zero ("near", "far", "peak") and
+	with the best zero for that target ("opt.": "near", "far", "peak", "zero")
+
+The trajectory is integrated once with 1 m range-card rows up to Options.range (early exit
+at its end), every query is answered from the rows by a scan and linear interpolation, so a
+request costs one range-card solve whatever the number of queries. Distances are in meters
+with a fraction, a query with no answer in the range gets an empty list / no field.
+
+Corrections near the line of sight are signed here (negative - dial down), the forward
+replies give their magnitude only.
+
+Reply: {"Version": "...", "Token": "...", "Inverse": [{"vert.": 5.2, "dist.": [1012.4]}, ...]}
+
+*******************************************************************************************/
+
+namespace s2 {
+
+	bool isInverseRequest(const nlohmann::json& bodyJson);
+
+	class inversesolver {
+
+		private:
+
+			datapreparator m_dp;
+			nlohmann::json m_queries;
+
+			Bullet m_bullet{};
+			Rifle m_rifle{};
+			Scope m_scope{};
+			Meteo m_meteo{};
+			Options m_options{};
+			Inputs m_inputs{};
+
+			/* Row i is at i meters, row 0 is the muzzle (no correction there) */
+			std::vector<double> m_corrections;		/* signed, scope units */
+			std::vector<double> m_heights;			/* sm above the line of sight */
+
+			nlohmann::json m_answers;
+
+			std::vector<double> crossings(const std::vector<double>& rows, size_t first, double value) const;
+			double interpolate(const std::vector<double>& rows, double dist) const;
+			double smPerUnit(double dist) const;
+			nlohmann::json pointBlank(double target, double slope) const;
+			nlohmann::json answer(const nlohmann::json& query) const;
+
+		public:
+			explicit inversesolver(const nlohmann::json& bodyJson);
+
+			void solve(SolverContext& ctx);
+			void serializeResults(std::string& workBuffer) const;
+	};
+}
+
+#endif /* _INVERSE_SOLVER_H_ */
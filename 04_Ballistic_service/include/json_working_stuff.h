@@ -3,12 +3,31 @@
 
 #include "trajectory_solver_API.h"
 #include "trajectory_solver.h"
+#include "trajectory_solver_lockstep.h"
+#include "result_cache.h"
 #include "nlohmann.h"
 
 /********************************************************************************************
 
 0.0.6.2 - Aerojump corrected
 0.0.6.3 - Float replaced by doubles to reduce rounding error
+0.0.6.4 - Batch requests (many shots in one message)
+0.0.6.5 - Adaptive step integrator (Options.integrator)
+0.0.6.6 - Early exit and range-card window (Options.early.exit, mach.dists, rangecard.from/to)
+0.0.6.7 - Fire-solution cache with quantized meteo (see result_cache.h)
+0.0.6.8 - Range and range-card step per request (Options.range, table.step)
+0.0.6.9 - Float32 fixed-step mode for slow devices (Options.precision, see accuracy_report.cpp)
+0.0.7.0 - Monte-Carlo dispersion and hit probability (Dispersion request, see dispersion_solver.h)
+0.0.7.1 - Inverse queries: distance from drop or clicks, impact of dialed clicks, MPBR (Inverse request, see inverse_solver.h)
+0.0.7.2 - Complex wind: any number of windage segments (up to MAX_WIND_SEGMENTS), Options.wind.interp
+0.0.7.3 - Truing: V0 / BC / multi-BC fitted to observed corrections (Truing request, see truing_solver.h)
+0.0.7.4 - Wind estimation from observed horizontal misses (WindEstimate request, see wind_estimator.h), "wind": "estimated"
+0.0.7.5 - Sector firing table over terrain angles x target azimuths x distances from one integration (Sweep request, see sweep_solver.h)
+0.0.7.6 - Trajectory spline: Hermite fit of vert. / drop / horiz. / deriv. / time / Mach within set tolerances, cached (Spline request, see trajectory_spline.h)
+0.0.7.7 - Sensitivities of the shot by V0, BC, crosswind and distance from the same integration (Options.sens., see trajectory_sensitivity.h)
+0.0.7.8 - Several distances in one request and one integration ("Inputs": {"dist.": [...]}, see solveDistances())
+0.0.7.9 - Profile handles: Bullet/Rifle/Scope registered once, requests carry "Profile" (Register request, see profile_registry.h)
+0.0.8.0 - Atmosphere response surface: repeated requests answered by interpolation over T x P x H with "Surface": {"err."} (see response_surface.h)
 
 ********************************************************************************************/
 
@@ -18,11 +37,22 @@
 /*******************************************************************************************/
 
 #define BALLISTIX_WORKING_BUFFER_SIZE 0x10000
+#define MAX_SHOT_DISTANCES 64		/* "dist." of one request */
 
 /*******************************************************************************************/
 namespace s2 {
+
+	struct profile;
 	
-	void solveBallistics(const std::string& inputJson, std::string& workBuffer);	
+	void solveBallistics(const std::string& inputJson, std::string& workBuffer, SolverContext& ctx);	
+	void solveBallistics(const nlohmann::json& bodyJson, std::string& workBuffer, SolverContext& ctx, resultcache* cache = nullptr, 
+		const profile* registered = nullptr);
+	bool isBatchRequest(const nlohmann::json& bodyJson);
+
+	/* "Inputs": {"dist.": [812, 815, 1020], ...} - detailed results at every distance (a few LRF readings) 
+	from one integration and in one reply, see trajectorySolverAt() */
+	bool isMultiDistanceRequest(const nlohmann::json& bodyJson);
+	void solveDistances(const nlohmann::json& bodyJson, std::string& workBuffer, SolverContext& ctx, const profile* registered = nullptr);
 }
 /*******************************************************************************************/
 
@@ -32,29 +62,104 @@ namespace s2 {
 
 		private:
 
-			const char* version = "0.0.6.3";
+			const char* version = "0.0.8.0";
 
 			std::string m_token;
 			
 			bool m_makeRangecard{false};
 			bool m_unitsIsMrads{false};
+			bool m_machDistances{true};
+			bool m_sensitivities{false};
+			uint16_t m_rangecardFirst{0};
+			uint16_t m_rangecardLast{BALLISTIC_TABLE_SIZE};
 			windDataArray m_windArray{};
+			CDMDataArray m_CDMArray{};
+			MBCDataArray m_MBCArray{};
 			
 			std::vector<float> m_distances, m_verticals, m_horizontals, m_derivations, m_times;
 
 			void prepareRangecardData(const Results& results);
+			void addMachDistances(const Results& results, nlohmann::json& resultJson) const;
+			void addSensitivities(const Results& results, nlohmann::json& resultJson) const;
 
 		public:
 			datapreparator() = default;
-			Bullet parseForBulletData(const nlohmann::json& bodyJson) const;
+			Bullet parseForBulletData(const nlohmann::json& bodyJson);
 			Rifle parseForRifleData(const nlohmann::json& bodyJson) const;
 			Scope parseForScopeData(const nlohmann::json& bodyJson);
 			Meteo parseForMeteoData(const nlohmann::json& bodyJson);
 			Options parseForOptions(const nlohmann::json& bodyJson);
 			Inputs parseForInputs(const nlohmann::json& bodyJson) const;
+
+			/* Sections of the request, the missing ones from the registered profile (may be nullptr), 
+			false - some section is in neither */
+			bool parseForProfile(const nlohmann::json& bodyJson, const profile* registered, 
+				Bullet& OUT bullet, Rifle& OUT rifle, Scope& OUT scope);
+
 			void serializeResult(const Results& results, std::string& workBuffer);
+			nlohmann::json resultToJson(const Results& results);
 
 			void getToken(const nlohmann::json& bodyJson);
+			const char* getVersion() const;
+			const std::string& token() const;
+	};
+
+	/* Batch request: shared Bullet/Rifle/Scope/Meteo/Options at the top level and 
+	an array of shots, each with its own Inputs and optional per-shot overrides:
+
+	{"Token": "...", "Bullet": {...}, "Rifle": {...}, ..., 
+	 "Batch": [{"Inputs": {...}}, {"Inputs": {...}, "Bullet": {...}}, ...]}
+
+	Shared Bullet/Rifle/Scope may come from a registered profile ("Profile" at the top level). 
+	Shared sections are parsed once, shots are solved independently (solveShot() 
+	may be called from different threads for different indexes). solveShots() runs 
+	up to LOCKSTEP_MAX_LANES consecutive shots through the lockstep integrator */
+
+	class batchsolver {
+
+		private:
+
+			const nlohmann::json& m_bodyJson;
+			datapreparator m_shared;
+
+			Bullet m_bullet{};
+			Rifle m_rifle{};
+			Scope m_scope{};
+			Meteo m_meteo{};
+			Options m_options{};
+			Inputs m_inputs{};
+
+			bool m_hasBullet{false};
+			bool m_hasRifle{false};
+			bool m_hasScope{false};
+			bool m_hasMeteo{false};
+			bool m_hasOptions{false};
+			bool m_hasInputs{false};
+
+			std::vector<nlohmann::json> m_results;
+
+			struct shot {
+
+				datapreparator dp;
+
+				Bullet bullet;
+				Rifle rifle;
+				Scope scope;
+				Meteo meteo;
+				Options options;
+				Inputs inputs;
+				Results results;
+			};
+
+			bool prepareShot(size_t index, shot& OUT s);
+
+		public:
+			explicit batchsolver(const nlohmann::json& bodyJson, const profile* registered = nullptr);
+
+			size_t size() const;
+			void solveShot(size_t index, SolverContext& ctx);
+			void solveShots(size_t first, size_t count, SolverContext* const ctxs[]);
+			void serializeResults(std::string& workBuffer) const;
 	};
 }
 
@@ -0,0 +1,91 @@
+#ifndef _PROFILE_REGISTRY_H_
+#define _PROFILE_REGISTRY_H_
+
+#include "trajectory_solver_API.h"
+#include "nlohmann.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/*******************************************************************************************
+
+Profile handles: Bullet, Rifle and Scope (any of them) are registered once
+
+{"Token": "...", "Register": {"Bullet": {...}, "Rifle": {...}, "Scope": {...}}}
+
+Reply: {"Version": "...", "Token": "...", "Profile": "5e0c4a1f93b2d7e8"}
+
+and later requests carry the handle instead of the sections: {"Token": "...", "Profile":
+"5e0c4a1f93b2d7e8", "Meteo": {...}, "Options": {...}, "Inputs": {...}}. A section present
+in the request is taken from it, the profile only fills the missing ones.
+
+The sections are parsed and checked at registration, single-shot, several-distance and
+batch requests take the solver structs as they are (CDM / multiBC tables are kept in the
+profile), other requests get the registered sections back into their JSON. The handle is the
+64-bit FNV-1a hash of the sections, registering the same profile again gives the same handle
+on any build and target.
+
+The daemon keeps up to [Profiles] size profiles, a full registry refuses new ones until
+"profiles.reset".
+
+*******************************************************************************************/
+
+namespace s2 {
+
+	struct profile {
+
+		bool hasBullet{false};
+		bool hasRifle{false};
+		bool hasScope{false};
+
+		Bullet bullet{};
+		Rifle rifle{};
+		Scope scope{};
+
+		/* bullet.cdmData / mbcData point here, so a profile is never copied */
+		CDMDataArray CDMArray{};
+		MBCDataArray MBCArray{};
+
+		nlohmann::json sections;		/* as registered */
+
+		profile() = default;
+		profile(const profile&) = delete;
+		profile& operator=(const profile&) = delete;
+	};
+
+	bool isRegisterRequest(const nlohmann::json& bodyJson);
+	bool hasProfileHandle(const nlohmann::json& bodyJson);
+
+	/* Sections of the profile the request does not have itself */
+	void applyProfile(const profile& registered, nlohmann::json& bodyJson);
+
+	class profileregistry {
+
+		private:
+
+			const size_t m_capacity;
+
+			std::map<std::string, std::shared_ptr<const profile>> m_profiles;
+			mutable std::mutex m_mutex;
+
+			static std::shared_ptr<profile> parseProfile(const nlohmann::json& registerJson);
+
+		public:
+
+			explicit profileregistry(size_t capacity);
+
+			/* Throws std::invalid_argument for a wrong profile, std::out_of_range when full */
+			std::string add(const nlohmann::json& registerJson);
+			std::shared_ptr<const profile> find(const std::string& handle) const;
+
+			size_t size() const;
+			size_t capacity() const;
+			void clear();
+	};
+
+	void serializeRegistration(const nlohmann::json& bodyJson, const std::string& handle, std::string& workBuffer);
+}
+
+#endif /* _PROFILE_REGISTRY_H_ */
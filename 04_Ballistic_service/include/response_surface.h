@@ -0,0 +1,128 @@
+#ifndef _RESPONSE_SURFACE_H_
+#define _RESPONSE_SURFACE_H_
+
+#include "trajectory_solver_API.h"
+#include "trajectory_solver.h"
+#include "json_working_stuff.h"
+#include "sharded_lru.h"
+#include "nlohmann.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*******************************************************************************************
+
+Atmosphere response surface: the single-shot reply of one request (profile, wind, options,
+inputs) solved in advance over a coarse temperature x pressure x humidity grid, so the slow
+drift of the atmosphere does not cost a solve per request.
+
+A request whose key (everything but Token and Meteo temp. / press. / humid.) misses the
+cache twice within the last SURFACE_CANDIDATES misses is the active one: the daemon solves
+the grid nodes in the background (lockstep lanes, one pool thread) while it keeps answering
+directly. Later requests inside the grid are answered by trilinear interpolation of every
+number of the Result (integers rounded) and the reply gets
+
+"Surface": {"err.": 0.004}
+
+- the error estimate of the cell in scope units. Every cell is solved once more at its center,
+the largest miss of vert. / horiz. / deriv. there over the cell and its neighbours times
+SURFACE_ERROR_MARGIN is the estimate: the model is not smooth everywhere (A0 is taken in whole
+m/s, so the corrections step every degree or two) and a miss away from the centers may be
+larger. A request outside the grid or with the estimate over max.err is solved directly.
+
+The default 8 x 8 x 3 grid takes 192 node and 98 center solves, in lockstep groups.
+
+The surface is an opt-in approximation ([Response_surface] enabled, off by default). err. is
+a heuristic and covers vert. / horiz. / deriv. only, the other numbers (Sm, clicks, Mach
+distances) are interpolated and rounded without any check.
+
+*******************************************************************************************/
+
+#define SURFACE_CANDIDATES 8		/* misses remembered to find the active request */
+#define SURFACE_ERROR_MARGIN 2
+
+namespace s2 {
+
+	struct profile;
+
+	struct surfaceAxis {
+
+		double from;
+		double to;
+		double step;
+
+		size_t nodes() const;
+		double at(size_t node) const;
+	};
+
+	struct surfaceGrid {
+
+		surfaceAxis temp{-30, 40, 10};		/* Celsius */
+		surfaceAxis press{700, 1050, 50};	/* hPa */
+		surfaceAxis humid{0, 100, 50};		/* % */
+		double maxError{0.02};				/* scope units */
+
+		size_t nodes() const;
+	};
+
+	class responseSurface {
+
+		private:
+
+			surfaceGrid m_grid;
+			nlohmann::json m_template;		/* Result of the first node, the shape of every reply */
+
+			size_t m_leaves{0};
+			std::vector<double> m_values;	/* [node][number of the Result] */
+			std::vector<double> m_errors;	/* per cell, the largest miss of vert. / horiz. / deriv. at its center */
+
+			size_t nodeIndex(size_t t, size_t p, size_t h) const;
+			bool interpolate(const double at[3], std::vector<double>& OUT values, size_t& OUT cell) const;
+
+		public:
+
+			/* Solves the grid nodes of the request, throws std::invalid_argument when it can not be interpolated */
+			responseSurface(const nlohmann::json& bodyJson, const surfaceGrid& grid, const profile* registered,
+				SolverContext* const ctxs[]);
+
+			/* false - Meteo is outside the grid */
+			bool evaluate(double temp, double press, double humid, nlohmann::json& OUT resultJson, double& OUT error) const;
+			size_t bytes() const;
+	};
+
+	class surfaceCache : public shardedLRU<std::string, std::shared_ptr<const responseSurface>> {
+
+		private:
+
+			const surfaceGrid m_grid;
+
+			std::mutex m_mutex;
+			std::deque<std::string> m_misses;
+			bool m_building{false};
+
+		public:
+
+			surfaceCache(size_t capacity, const surfaceGrid& grid);
+
+			const surfaceGrid& grid() const;
+
+			/* The request without Token and Meteo temp. / press. / humid. */
+			static std::string makeKey(const nlohmann::json& bodyJson);
+
+			/* On a miss: true - the caller builds the surface of the key and calls finishBuild() */
+			bool startBuild(const std::string& key);
+			void finishBuild();
+	};
+
+	/* Single shot with its own numeric temp. / press. / humid. */
+	bool isSurfaceRequest(const nlohmann::json& bodyJson);
+
+	/* false - not answered, the request is to be solved directly */
+	bool solveFromSurface(const nlohmann::json& bodyJson, const responseSurface& surface, double maxError,
+		std::string& workBuffer);
+}
+
+#endif /* _RESPONSE_SURFACE_H_ */
@@ -0,0 +1,57 @@
+#ifndef _RESULT_CACHE_H_
+#define _RESULT_CACHE_H_
+
+#include "trajectory_solver_API.h"
+#include "sharded_lru.h"
+
+#include <string>
+
+/*******************************************************************************************
+
+Fire-solution cache in front of s2::solveBallistics(). Meteo is snapped to the quantization 
+grid before solving, so a reply depends only on the canonical (quantized) inputs and any 
+request that lands in the same cell gets the same reply. Replies are stored as the text 
+around the token, a hit only splices the new token in.
+
+Quantization changes results within one grid step, so the cache is opt-in 
+([Result_cache] enabled), keep it off when exact reproducibility is needed.
+
+*******************************************************************************************/
+
+namespace s2 {
+
+	struct quantizationSteps { /* 0 - not quantized */
+
+		double temp{1.0};		/* Celsius */
+		double press{1.0};		/* hPa */
+		double humid{1.0};		/* % */
+		double windSpeed{0.0};	/* m/s */
+		double windDir{0.0};	/* degrees */
+	};
+
+	struct cachedReply {
+
+		std::string head;		/* up to the token value */
+		std::string tail;		/* after the token value */
+	};
+
+	class resultcache : public shardedLRU<std::string, cachedReply> {
+
+		private:
+
+			const quantizationSteps m_steps;
+
+		public:
+
+			resultcache(size_t capacity, size_t shards, const quantizationSteps& steps);
+
+			void quantize(Meteo& meteo) const;
+			std::string makeKey(const Meteo& meteo, const Bullet& bullet, const Rifle& rifle, 
+				const Scope& scope, const Inputs& inputs, const Options& options) const;
+
+			static bool splitReply(const std::string& reply, const std::string& token, cachedReply& OUT cached);
+			static void joinReply(const cachedReply& cached, const std::string& token, std::string& OUT reply);
+	};
+}
+
+#endif /* _RESULT_CACHE_H_ */
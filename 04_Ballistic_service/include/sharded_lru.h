@@ -0,0 +1,205 @@
+#ifndef _SHARDED_LRU_H_
+#define _SHARDED_LRU_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*******************************************************************************************
+
+Bounded LRU map for the pool threads. Sharded by key hash, every shard is a small LRU 
+under its own mutex, so threads rarely meet. Keeps hit/miss/eviction counters and the 
+memory taken by entries (as reported by the caller on insert).
+
+*******************************************************************************************/
+
+/* FNV-1a, 64 bits whatever size_t is and the same in every build */
+inline uint64_t fnv1aHash(const void* data, size_t size) {
+
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = 14695981039346656037ULL;
+
+	for(size_t i = 0; i < size; i++) {
+
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+/* Raw bytes of a scalar field for string keys, fields go one by one so struct padding never gets in */
+template<typename T>
+inline void appendKeyBytes(std::string& key, const T& value) {
+
+	key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+class shardedLRU {
+
+	private:
+
+		struct entry {
+
+			Key key;
+			Value value;
+			size_t bytes;
+		};
+
+		typedef std::list<entry> lruList;
+
+		struct shard {
+
+			std::mutex mutex;
+			lruList lru;
+			std::unordered_map<Key, typename lruList::iterator, Hash, Equal> index;
+			size_t bytes{0};
+		};
+
+		std::vector<std::unique_ptr<shard>> m_shards;
+		size_t m_shardCapacity;
+
+		std::atomic<uint64_t> m_hits{0};
+		std::atomic<uint64_t> m_misses{0};
+		std::atomic<uint64_t> m_evictions{0};
+
+		shard& shardFor(const Key& key) {
+
+			/* size_t is 32 bits on ARM, upper bits are folded in rather than shifted out */
+			const size_t hash = Hash()(key);
+			return *m_shards[(hash ^ (hash >> 16)) % m_shards.size()];
+		}
+
+	public:
+
+		shardedLRU(size_t capacity, size_t shards) {
+
+			if(shards == 0) {
+				shards = 1;
+			}
+
+			m_shardCapacity = (capacity + shards - 1) / shards;
+
+			if(m_shardCapacity == 0) {
+				m_shardCapacity = 1;
+			}
+
+			for(size_t i = 0; i < shards; i++) {
+				m_shards.push_back(std::make_unique<shard>());
+			}
+		}
+
+		bool find(const Key& key, Value& value) {
+
+			shard& s = shardFor(key);
+
+			{
+				std::lock_guard<std::mutex> lock(s.mutex);
+
+				auto it = s.index.find(key);
+
+				if(it != s.index.end()) {
+
+					s.lru.splice(s.lru.begin(), s.lru, it->second);
+					value = it->second->value;
+
+					m_hits++;
+					return true;
+				}
+			}
+
+			m_misses++;
+			return false;
+		}
+
+		void insert(const Key& key, const Value& value, size_t bytes = 0) {
+
+			shard& s = shardFor(key);
+
+			std::lock_guard<std::mutex> lock(s.mutex);
+
+			auto it = s.index.find(key);
+
+			if(it != s.index.end()) { /* another thread got here first */
+
+				s.bytes = s.bytes - it->second->bytes + bytes;
+				it->second->value = value;
+				it->second->bytes = bytes;
+				s.lru.splice(s.lru.begin(), s.lru, it->second);
+				return;
+			}
+
+			if(s.lru.size() >= m_shardCapacity) {
+
+				s.bytes -= s.lru.back().bytes;
+				s.index.erase(s.lru.back().key);
+				s.lru.pop_back();
+
+				m_evictions++;
+			}
+
+			s.lru.push_front(entry{key, value, bytes});
+			s.index[key] = s.lru.begin();
+			s.bytes += bytes;
+		}
+
+		void clear() {
+
+			for(auto& s : m_shards) {
+
+				std::lock_guard<std::mutex> lock(s->mutex);
+
+				s->index.clear();
+				s->lru.clear();
+				s->bytes = 0;
+			}
+		}
+
+		uint64_t hits() const {
+			return m_hits.load();
+		}
+
+		uint64_t misses() const {
+			return m_misses.load();
+		}
+
+		uint64_t evictions() const {
+			return m_evictions.load();
+		}
+
+		size_t size() {
+
+			size_t total = 0;
+
+			for(auto& s : m_shards) {
+
+				std::lock_guard<std::mutex> lock(s->mutex);
+				total += s->lru.size();
+			}
+
+			return total;
+		}
+
+		size_t bytes() {
+
+			size_t total = 0;
+
+			for(auto& s : m_shards) {
+
+				std::lock_guard<std::mutex> lock(s->mutex);
+				total += s->bytes;
+			}
+
+			return total;
+		}
+};
+
+#endif /* _SHARDED_LRU_H_ */
@@ -2,6 +2,7 @@
 #define _SOLVER_STRUCTS_AND_CONSTS_H_
 
 #include <stdint.h>
+#include "trajectory_solver_API.h"
 
 const double STEP_f = 3.28084;
 const double DegToRad = 0.0174533;
@@ -71,6 +72,20 @@ struct windPortion {
 	double Wz;
 };
 
+struct windSegment {
+
+	uint16_t from;				/* meters, the segment goes on up to the next one */
+	struct windPortion wind;	/* components at from */
+	struct windPortion slope;	/* change per meter up to the next segment, interpolated wind only */
+};
+
+struct windTable { /* complex wind of one request, see prepareWindTable() */
+
+	struct windSegment segments[MAX_WIND_SEGMENTS];
+	uint8_t count;
+	uint8_t cursor;		/* segment of the last lookup, distances mostly only grow */
+};
+
 struct dragAndBCInfo {
 
 	double CD;
@@ -97,6 +112,21 @@ struct zeroingInfo {
 
 	double DistFeet;
 	double Yzero;
+	double BCzero;		/* BC at zero distance */
+};
+
+struct zeroingKey { /* every input of ZeroingAngleforNumeric(), compared bytewise (padding zeroed) */
+
+	double G_f;
+	double BCzero;
+	double scopeHight;
+	double V0;
+	double thermalSens;
+	uint16_t zeroDistance;
+	uint16_t zeroPress;
+	int8_t zeroTemp;
+	int8_t V0temp;
+	uint8_t dragFunction;
 };
 
 struct CalibCoefficients {
@@ -120,4 +150,52 @@ struct terminalData {
 	uint32_t cineticEnergy;
 };
 
+struct solverInvariants { /* per request values, constant along the trajectory */
+
+	double V0;
+	double KoriolisVert;
+	double CCF;
+	double A0_f;
+	double SG;
+	double YaeroJump;
+	double G_f;
+	uint16_t lastDist;	/* last distance the integration has to reach */
+	uint16_t range;		/* maximum distance, see solverRange() */
+	uint16_t tableStep;
+	uint16_t tableSize;	/* range-card rows 0 ... tableSize, the shot goes to tableSize + 1 */
+};
+
+struct trajectoryState { /* integration state at the current distance */
+
+	double Vx;			/* velocity components, feets/s */
+	double Vy;
+	double Vz;
+	double V;			/* full speed, feets/s */
+	double M;			/* Mach number */
+	double H2;			/* elevation in feets (absolute) */
+	double W2;			/* wind drift in feets */
+	double Time;		/* flight time (sec) */
+};
+
+struct sensitivityTangents { /* Options.Sensitivities: the shot as integrated, see finalizeSensitivities() */
+
+	bool integrated;				/* the loop passed the shot distance */
+	double V0rate;					/* V0 of the solve per m/s of Bullet.V0 (thermal correction) */
+	struct trajectoryState shot;
+	double windSpeed;				/* m/s, crosswind at the shot */
+	double Yabs[SENS_RANGE];		/* sm, derivatives by the integrated inputs */
+	double W[SENS_RANGE];
+	double Time[SENS_RANGE];
+	double Mach[SENS_RANGE];
+	double MachRate;				/* per meter at the shot (DSF of the drop follows Mach) */
+	double Yzero[SENS_RANGE];		/* sm, at the zero distance */
+};
+
+struct shotCapture { /* one more shot distance of the same integration, see trajectorySolverAt() */
+
+	struct solveCompactData solveData;
+	struct terminalData terminalInfo;
+	struct sensitivityTangents tangents;	/* but V0rate and Yzero */
+};
+
 #endif /* _SOLVER_STRUCTS_AND_CONSTS_H_ */
@@ -0,0 +1,77 @@
+#ifndef _SWEEP_SOLVER_H_
+#define _SWEEP_SOLVER_H_
+
+#include "trajectory_solver_API.h"
+#include "trajectory_solver.h"
+#include "json_working_stuff.h"
+#include "nlohmann.h"
+
+#include <string>
+#include <vector>
+
+/*******************************************************************************************
+
+Sector firing table: the usual single-shot sections (Inputs.dist., terrain_angle and
+target_azimuth are not used) plus
+
+"Sweep": {"angles": [0, 5, 10, 15], "azimuths": [0, 36, 72], "dist.": [100, 200, 300]}
+
+	angles - terrain angles in degrees (0 ... 90), azimuths - target azimuths in degrees
+	(Coriolis), dist. - distances in meters. Every axis is a list or {"from", "to", "step"}
+
+Terrain angle and target azimuth are applied to the rows after the integration only (see
+refinalizeSolver()), so the trajectory is integrated once up to the farthest distance with
+range-card rows at the requested ones and every cell is the finalization of these rows.
+Cells are spread over the pool by angle. Horizontal, derivation and time do not depend on
+the cell in this model and are given once per distance.
+
+Reply (one line, corrections in scope units rounded to 0.01, time to 0.001 s):
+{"Version": "...", "Token": "...", "Sweep": {"angles": [...], "azimuths": [...], "dist.": [...],
+	"vert.": [[[angle 0, azimuth 0: per distance], [azimuth 1], ...], [angle 1], ...],
+	"horiz.": [per distance], "deriv.": [per distance], "time": [per distance]}}
+
+*******************************************************************************************/
+
+#define SWEEP_MAX_CELLS 100000		/* angles x azimuths x distances */
+
+namespace s2 {
+
+	bool isSweepRequest(const nlohmann::json& bodyJson);
+
+	class sweepsolver {
+
+		private:
+
+			datapreparator m_dp;
+
+			Bullet m_bullet{};
+			Rifle m_rifle{};
+			Scope m_scope{};
+			Meteo m_meteo{};
+			Options m_options{};
+			Inputs m_inputs{};
+
+			std::vector<int16_t> m_angles;
+			std::vector<int16_t> m_azimuths;
+			std::vector<uint16_t> m_dists;
+
+			Options m_sweepOptions{};
+			SolverContext m_solved;		/* the one integration, its rows are refinalized per cell */
+
+			std::vector<double> m_vert;		/* [angle][azimuth][distance] */
+			std::vector<double> m_horiz, m_deriv, m_time;
+
+			static std::vector<int16_t> axis(const nlohmann::json& axisJson, int16_t lowest, int16_t highest);
+			Inputs cellInputs(size_t angle, size_t azimuth) const;
+
+		public:
+			explicit sweepsolver(const nlohmann::json& bodyJson);
+
+			size_t angles() const;
+			void solveBase(SolverContext& ctx);
+			void solveAngle(size_t angle, SolverContext& ctx);
+			void serializeResults(std::string& workBuffer) const;
+	};
+}
+
+#endif /* _SWEEP_SOLVER_H_ */
@@ -0,0 +1,151 @@
+#ifndef _TRAJECTORY_SENSITIVITY_H_
+#define _TRAJECTORY_SENSITIVITY_H_
+
+#include <cmath>
+
+#include "trajectory_solver_API.h"
+
+/*******************************************************************************************
+
+Sensitivities of the shot solution (Options.Sensitivities, Results.sens) in forward mode:
+every value of the fixed-step loop carries its partial derivatives by V0, BC and crosswind
+along (dualNumber is one more Real of integrateFixedStep()), so a solve gives the solution
+and its Jacobian at once instead of a full solve per changed input.
+
+	V0 - seeds the muzzle velocity of the state
+	BC - the drag factor, whose slope by Mach is taken from the drag table at every step
+	crosswind - Wz of every step
+
+The shot row is finalized once more in dualNumber<SENS_INPUTS> (finalizeSensitivities()),
+where the distance is one more input: the state moves along with its rates at the shot.
+SG, aerojump and vertical Coriolis follow V0, the zeroing angle follows V0 and BC: from the
+same integration (zero.atm = here) or by central differences of the zeroing in its own
+atmosphere (not_here, cached as every zeroing angle).
+
+A solve with sensitivities costs about 3 plain ones (not_here zeroing included, 4 more
+zeroings without the cache). Derivatives are of the model as solved: crossing the line of
+sight or a drag table point they are one-sided, the rifle roll of +-90 degrees at the zero
+distance is a constant correction. The crosswind does not include the vertical part of a
+sloped wind (incl.).
+
+*******************************************************************************************/
+
+#define SENS_MACH_STEP 1e-4		/* Mach, drag slope by central difference */
+
+template<int N>
+struct dualNumber {
+
+	double v;
+	double d[N];
+
+	dualNumber(double value = 0) : v(value) {
+
+		for(int k = 0; k < N; k++) {
+			d[k] = 0;
+		}
+	}
+
+	friend dualNumber operator+(const dualNumber& a, const dualNumber& b) {
+
+		dualNumber r(a.v + b.v);
+
+		for(int k = 0; k < N; k++) {
+			r.d[k] = a.d[k] + b.d[k];
+		}
+
+		return r;
+	}
+
+	friend dualNumber operator-(const dualNumber& a, const dualNumber& b) {
+
+		dualNumber r(a.v - b.v);
+
+		for(int k = 0; k < N; k++) {
+			r.d[k] = a.d[k] - b.d[k];
+		}
+
+		return r;
+	}
+
+	friend dualNumber operator*(const dualNumber& a, const dualNumber& b) {
+
+		dualNumber r(a.v * b.v);
+
+		for(int k = 0; k < N; k++) {
+			r.d[k] = a.d[k] * b.v + a.v * b.d[k];
+		}
+
+		return r;
+	}
+
+	friend dualNumber operator/(const dualNumber& a, const dualNumber& b) {
+
+		dualNumber r(a.v / b.v);
+
+		for(int k = 0; k < N; k++) {
+			r.d[k] = (a.d[k] - r.v * b.d[k]) / b.v;
+		}
+
+		return r;
+	}
+
+	/* Constants do not go through the full product */
+
+	friend dualNumber operator+(const dualNumber& a, double b) { dualNumber r = a; r.v += b; return r; }
+	friend dualNumber operator+(double a, const dualNumber& b) { return b + a; }
+	friend dualNumber operator-(const dualNumber& a, double b) { dualNumber r = a; r.v -= b; return r; }
+	friend dualNumber operator-(double a, const dualNumber& b) { return scaled(b, -1) + a; }
+	friend dualNumber operator*(const dualNumber& a, double b) { return scaled(a, b); }
+	friend dualNumber operator*(double a, const dualNumber& b) { return scaled(b, a); }
+	friend dualNumber operator/(const dualNumber& a, double b) { return scaled(a, 1 / b); }
+
+	/* f(x) with f'(x) */
+	friend dualNumber chained(const dualNumber& a, double value, double slope) {
+
+		dualNumber r(value);
+
+		for(int k = 0; k < N; k++) {
+			r.d[k] = slope * a.d[k];
+		}
+
+		return r;
+	}
+
+	friend dualNumber scaled(const dualNumber& a, double factor) {
+
+		return chained(a, a.v * factor, factor);
+	}
+
+	friend dualNumber sqrt(const dualNumber& a) { const double root = std::sqrt(a.v); return chained(a, root, 0.5 / root); }
+	friend dualNumber fabs(const dualNumber& a) { return chained(a, std::fabs(a.v), a.v < 0 ? -1 : 1); }
+	friend dualNumber sin(const dualNumber& a) { return chained(a, std::sin(a.v), std::cos(a.v)); }
+	friend dualNumber tan(const dualNumber& a) { const double t = std::tan(a.v); return chained(a, t, 1 + t * t); }
+	friend dualNumber atan(const dualNumber& a) { return chained(a, std::atan(a.v), 1 / (1 + a.v * a.v)); }
+	friend dualNumber pow(const dualNumber& a, double p) { const double r = std::pow(a.v, p); return chained(a, r, p * r / a.v); }
+};
+
+/* The integrated inputs, the distance is differentiated on the shot row only */
+typedef dualNumber<SENS_RANGE> sensitiveReal;
+
+static inline double realValue(double value) {
+
+	return value;
+}
+
+template<int N>
+static inline double realValue(const dualNumber<N>& value) {
+
+	return value.v;
+}
+
+struct SolverContext;
+struct SolverRequest;
+
+/* Before the loop: seeds of the solve */
+void prepareSensitivities(struct SolverContext* ctx, const struct SolverRequest* const req);
+
+/* From finalizeSolver(): Results.sens from the tangents of the loop, zeros if the loop did not reach the shot 
+(trajectorySolver() takes the fixed-step loop whatever Integrator is, the lockstep integrator passes such requests to it) */
+void finalizeSensitivities(struct SolverContext* ctx, const struct SolverRequest* const req, double throwAngle);
+
+#endif /* _TRAJECTORY_SENSITIVITY_H_ */
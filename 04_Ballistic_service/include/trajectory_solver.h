@@ -5,9 +5,99 @@
 #include "trajectory_solver_API.h"
 #include "trajectory_solver_routines.h"
 #include "solver_structs_and_consts.h"
+#include "roll_angle.h"
 
+#include <vector>
+
+class zeroingCache;
+class trajectoryTraceCache;
+
+/* All scratch state of a single solve. One context per call or per worker thread 
+makes trajectorySolver() reentrant, so pool threads never share it */
+
+struct SolverContext {
+
+	/* Sized per request (range / step), grow only and are reused by the next solves */
+	std::vector<solverUnit> solver;
+	std::vector<double> tableRows;		/* storage of Results::table */
+	std::vector<solverUnit> rawRows;	/* rows as integrated, kept by finalizeSolver() with keepRawRows (see refinalizeSolver()) */
+	bool keepRawRows{false};
+
+	struct calibrationDistances calibDists;
+	struct windPortion windComps;
+	struct windTable windTable;		/* complex wind segments of the request */
+	struct dragAndBCInfo dragInfo;
+	struct zeroingInfo zeroData;
+	struct solveCompactData solveData;
+	struct terminalData terminalInfo;
+	struct rifleAngles anglesData;
+	struct roolCorrectionData rifleRollData;
+	struct solverInvariants setup;
+	struct sensitivityTangents tangents;		/* Options.Sensitivities */
+	double throwAngle;		/* of the last solve, tan() is sm of drop per feet of distance (see absoluteDropToZeroing()) */
+
+	/* More shot distances of the solve (trajectorySolverAt()), ascending and below Inputs.shotDistance */
+	std::vector<uint16_t> extraShots;
+	std::vector<struct shotCapture> extraCaptures;
+	size_t nextExtraShot{0};
+
+	zeroingCache* zeroCache{nullptr};	/* shared between contexts, optional */
+	trajectoryTraceCache* traceCache{nullptr};	/* shared between contexts, optional, fixed step only */
+};
+
+/* Everything one solve reads from and writes to */
+
+struct SolverRequest {
+
+	const struct Meteo* meteo;
+	const struct Bullet* bullet;
+	const struct Rifle* rifle;
+	const struct Scope* scope;
+	const struct Inputs* inputs;
+	const struct Options* options;
+	struct Results* results;
+};
+
+void trajectorySolver (struct SolverContext* ctx, const struct Meteo* const meteo, const struct Bullet* const bullet, 
+const struct Rifle* const rifle, const struct Scope* const scope, const struct Inputs* const inputs, 
+const struct Options* const options, struct Results* OUT results);
+
+/* Detailed Results at several distances from one integration: results[k] is what trajectorySolver() gives 
+for Inputs.shotDistance = dists[k] (every distance 1 ... range; the adaptive integrator steps up to the farthest 
+one, so its results agree within its tolerance). The range card (Options.BallisticTable) comes with the farthest 
+distance only, the others have no table */
+void trajectorySolverAt(struct SolverContext* ctx, const struct Meteo* const meteo, const struct Bullet* const bullet, 
+const struct Rifle* const rifle, const struct Scope* const scope, const struct Inputs* const inputs, 
+const struct Options* const options, const uint16_t dists[], size_t count, struct Results* OUT results);
+
+/* Legacy entry point, works on a thread local context */
 void trajectorySolver (const struct Meteo* const meteo, const struct Bullet* const bullet, 
 const struct Rifle* const rifle, const struct Scope* const scope, const struct Inputs* const inputs, 
 const struct Options* const options, struct Results* OUT results);
 
+/* Solver phases, shared by trajectorySolver() and the lockstep integrator: 
+prepareSolver() once, then for every metre prepareSolverStep() -> integration step -> recordSolverStep(), 
+then finalizeSolver() */
+
+void prepareSolver(struct SolverContext* ctx, const struct SolverRequest* const req, struct OUT trajectoryState* state);
+void prepareSolverStep(struct SolverContext* ctx, const struct SolverRequest* const req, uint16_t dist, double Mach);
+void recordSolverStep(struct SolverContext* ctx, const struct SolverRequest* const req, uint16_t dist, 
+	const struct trajectoryState* const state, double Vprev);
+void finalizeSolver(struct SolverContext* ctx, const struct SolverRequest* const req);
+bool solverReachedEnd(const struct SolverContext* const ctx, const struct SolverRequest* const req, uint16_t dist, double Mach);
+
+/* Terrain angle, target azimuth and target speed are applied by finalizeSolver() only, the integration does not 
+depend on them. refinalizeSolver() gives the solution of solved (a context that solved with keepRawRows) for other 
+such Inputs (same distance, latitude and the rest) without integrating: ctx takes its rows and finalizes them 
+again. solved is only read, many contexts may refinalize it at once */
+void refinalizeSolver(struct SolverContext* ctx, const struct SolverContext* const solved, const struct SolverRequest* const req);
+
+#define NO_EXTRA_SHOT 0xFFFF
+
+/* Next distance of extraShots the integration has not passed yet */
+static inline uint16_t pendingExtraShot(const struct SolverContext* const ctx) {
+
+	return ctx->nextExtraShot < ctx->extraShots.size() ? ctx->extraShots[ctx->nextExtraShot] : NO_EXTRA_SHOT;
+}
+
 #endif /* __TRAJECTORY_SOLVER_H__ */
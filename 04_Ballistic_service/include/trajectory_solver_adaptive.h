@@ -0,0 +1,28 @@
+#ifndef __TRAJECTORY_SOLVER_ADAPTIVE_H__
+#define __TRAJECTORY_SOLVER_ADAPTIVE_H__
+
+#include "trajectory_solver.h"
+
+/****************************************************************
+*
+*	Adaptive integrator (Options.Integrator == ADAPTIVE_STEP):
+*	Bogacki-Shampine 3(2) pair over distance, step size chosen by
+*	the embedded error estimate, steps are cut at complex wind
+*	boundaries. Range-card points, the shot distance, zeroing and
+*	calibration distances are read from the cubic Hermite dense
+*	output at the same metre marks the fixed-step mode records.
+*
+****************************************************************/
+
+#define ADAPTIVE_RTOL 1e-6				/* relative tolerance */
+#define ADAPTIVE_ATOL_SPEED 1e-2		/* feets/s */
+#define ADAPTIVE_ATOL_DIST 1e-3			/* feets */
+#define ADAPTIVE_ATOL_TIME 1e-6			/* sec */
+
+#define ADAPTIVE_FIRST_STEP 5.0			/* meters */
+#define ADAPTIVE_MIN_STEP 1.0			/* meters, accepted whatever the error (fixed-step resolution) */
+#define ADAPTIVE_MAX_STEP 200.0			/* meters */
+
+void trajectorySolverAdaptive(struct SolverContext* ctx, const struct SolverRequest* const req);
+
+#endif /* __TRAJECTORY_SOLVER_ADAPTIVE_H__ */
@@ -0,0 +1,35 @@
+#ifndef __TRAJECTORY_SOLVER_LOCKSTEP_H__
+#define __TRAJECTORY_SOLVER_LOCKSTEP_H__
+
+#include <stddef.h>
+#include "trajectory_solver.h"
+
+/****************************************************************
+*
+*	Lockstep integrator: 4 (SSE2/NEON) or 8 (AVX2) independent
+*	trajectories advance through the 1-metre Heun loop together,
+*	their state kept as structure of arrays. Drag, wind and
+*	per-metre bookkeeping stay per lane and reuse the scalar code.
+*
+*	Lane count is chosen at runtime (lockstepLanes()), builds
+*	without SIMD support fall back to trajectorySolver() per request.
+*	ADAPTIVE_STEP, PRECISION_FLOAT and Sensitivities requests are 
+*	always solved by trajectorySolver().
+*
+*	Tolerance: every lane performs the same IEEE operations in the
+*	same order as trajectorySolver(), so results are bitwise equal
+*	when the compiler does not contract multiply-add into FMA
+*	(default for -std=c++17). With contraction allowed doubles may
+*	differ by LOCKSTEP_TOLERANCE (relative), rounded outputs
+*	(sm, clicks, distances) may differ by one unit.
+*
+****************************************************************/
+
+#define LOCKSTEP_MAX_LANES 8
+#define LOCKSTEP_TOLERANCE 1e-9
+
+int lockstepLanes(void);
+
+void trajectorySolverLockstep(struct SolverContext* const ctxs[], const struct SolverRequest requests[], size_t count);
+
+#endif /* __TRAJECTORY_SOLVER_LOCKSTEP_H__ */
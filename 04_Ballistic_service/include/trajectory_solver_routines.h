@@ -7,6 +7,7 @@
 #include <math.h>
 #include "trajectory_solver_API.h"
 #include "solver_structs_and_consts.h"
+#include "drag_tables.h"
 
 /* INFO - should be in actual state */
 #define LIB_VERSION "2.0.0.6"
@@ -25,6 +26,8 @@ double ConditionCorrectionFactor (const struct Meteo* const meteo);
 double ZeroingAngleforNumeric(double G_f, const struct Rifle* const rifle, const struct Bullet* const bullet, 
 	const struct Meteo* const meteo, const struct dragAndBCInfo* const dragInfo);
 
+void fillZeroingKey(double G_f, const struct Rifle* const rifle, const struct Bullet* const bullet, 
+	const struct dragAndBCInfo* const dragInfo, struct OUT zeroingKey* key);
 double throwAngleCalculation (double Y, double Dst_f);
 double DragCoefficient (uint8_t DragFunction, double M);
 double DragCoefficientForCDM (const struct Bullet* bullet, double Mach);
@@ -63,18 +66,29 @@ double calculateFakeG7BC(const uint16_t bulletMass, double caliberInch, double i
 bool machAtTranssonic(const double MachNum);
 bool machAtSubsonic(const double MachNum);
 bool machAtDeepSubsonic(const double MachNum);
+uint16_t solverRange(const struct Options* const options);
+uint16_t rangecardStep(const struct Options* const options);
+uint16_t rangecardSize(const struct Options* const options);
+uint16_t rangecardFirstIndex(const struct Options* const options);
+uint16_t rangecardLastIndex(const struct Options* const options);
 void fullfillBallisticTable(const struct Meteo* meteo, const struct Bullet* bullet, 
-    const struct Rifle* rifle, const solverUnit solver[], const struct Scope* const scope, struct Results* OUT results);
+    const struct Rifle* rifle, const solverUnit solver[], const struct Scope* const scope, uint16_t firstIndex, uint16_t lastIndex, 
+    struct Results* OUT results);
+uint8_t complexWindSegments(const struct Meteo* const meteo);
+uint8_t complexWindIndex(const struct Meteo* const meteo, const uint16_t dist);
 void getWindComponents(const struct Meteo* meteo, const uint16_t dist, struct OUT windPortion* wind);
 double aeroJmpCorrector(double MillersFGS, const struct Bullet* bullet, const struct Rifle* const rifle, 
 	const struct Meteo* const meteo, const struct Options* const options);
 void initStartWindComponents(const struct Meteo* const meteo, struct windPortion* windComps);
-void windComponentsForComplexCase(const struct Meteo* const meteo, struct windPortion* windComps, uint16_t currentDist);
+void prepareWindTable(const struct Meteo* const meteo, const struct Options* const options, struct OUT windTable* table);
 void addSomeSolutionDataToSolverStruct(double KoriolisVert, double YaeroJump, double throwAngle, const struct Inputs* const inputs, 
     const struct Options* const options, const struct Bullet* const bullet, solverUnit* solver, uint64_t index, const struct Meteo* const meteo);
 
 void defineDragInfoForCDM(uint16_t dist, double Mach, double CCF, const struct Bullet* const bullet, 
 	const struct Rifle* const rifle, struct dragAndBCInfo* dragInfo, struct calibrationDistances* calibDists);
+void defineDragInfo(uint16_t dist, double Mach, double CCF, const struct Bullet* const bullet, 
+	const struct Rifle* const rifle, struct dragAndBCInfo* dragInfo);
+void markCalibrationDistances(uint16_t dist, double Mach, struct calibrationDistances* calibDists);
 double calculateC3(double CCF, double BC);
 double BCforMBCCase (const struct Bullet* bullet, double Mach);
 uint8_t startIndexForMBC(double Mach);
@@ -83,4 +97,29 @@ int32_t calculateAbsDrop(double Yabs);
 double convertToFeets(double value);
 double convertFromFeets(double value);
 
+/* Wind at dist from the table of prepareWindTable(), the cursor makes a walk along the 
+trajectory a compare per step whatever the number of segments */
+static inline void windTableAt(struct windTable* table, uint16_t dist, struct OUT windPortion* wind) {
+
+	const struct windSegment* const segments = table->segments;
+	uint8_t cursor = table->cursor;
+
+	if(dist < segments[cursor].from) {
+		cursor = 0;
+	}
+
+	while(cursor + 1 < table->count && segments[cursor + 1].from <= dist) {
+		cursor++;
+	}
+
+	table->cursor = cursor;
+
+	const struct windSegment* const segment = &segments[cursor];
+	const double x = dist > segment->from ? dist - segment->from : 0;
+
+	wind->Wx = segment->wind.Wx + segment->slope.Wx * x;
+	wind->Wy = segment->wind.Wy + segment->slope.Wy * x;
+	wind->Wz = segment->wind.Wz + segment->slope.Wz * x;
+}
+
 #endif /* __TRAJECTORY_SOLVER_ROUTINES_H__ */
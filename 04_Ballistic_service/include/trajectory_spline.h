@@ -0,0 +1,108 @@
+#ifndef _TRAJECTORY_SPLINE_H_
+#define _TRAJECTORY_SPLINE_H_
+
+#include "trajectory_solver_API.h"
+#include "trajectory_solver.h"
+#include "json_working_stuff.h"
+#include "sharded_lru.h"
+#include "nlohmann.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*******************************************************************************************
+
+Trajectory spline: the usual single-shot sections (Inputs.dist. is not used) plus
+
+"Spline": {"from": 50, "to": 1200, "dist.": [412.5, 733], "knots": true}
+
+	from, to - distances in meters the spline covers (default SPLINE_FROM ... Options.range,
+		a bullet falling back after the stall cuts "to" where no span fits its rows any more)
+	dist. - distances to answer from the spline (optional)
+	knots - reply the spline itself (default when there is no dist.)
+
+The trajectory is solved once with 1 m range-card rows and every channel is fitted with a
+cubic Hermite spline: values at the knots, slopes from central differences of the rows. The
+knots start SPLINE_MAX_SPAN apart, a span is halved while a channel misses any metre row in
+it by more than its tolerance (down to SPLINE_MIN_SPAN), so err. - the largest deviation
+from the direct solution over every metre of the range - stays within the tolerance (but
+for SPLINE_MIN_SPAN spans a few meters from the muzzle):
+
+	vert. - correction in scope units as the range card gives it, SPLINE_TOL_ANGLE
+	drop - sm below the line of sight (negative - above), SPLINE_TOL_DROP
+	horiz., deriv. - scope units, as the range card gives them, SPLINE_TOL_ANGLE
+	time - s, SPLINE_TOL_TIME, Mach - SPLINE_TOL_MACH
+
+The channels are range-card rows, the rifle roll (applied to the single shot only) is not
+in them. Corrections are magnitudes and break where the bullet crosses the line of sight:
+both rows around a crossing are knots and the slopes next to them are one-sided, so every
+span keeps its own pair of slopes.
+
+A query is a table lookup of the span (one entry per meter) and one cubic per channel. The
+daemon keeps fitted splines by profile, atmosphere and wind (splineCache), a repeated state
+with other dist. is answered without solving.
+
+Reply: {"Version": "...", "Token": "...", "Spline": {"from": 50, "to": 1200,
+	"answers": [{"dist.": 412.5, "vert.": 2.31, "drop": 152.3, "horiz.": ..., "deriv.": ...,
+	"time": 0.61, "Mach": 1.71}, ...], "err.": {"vert.": 0.003, ...},
+	"knots": {"dist.": [50, 150, ...], "vert.": {"values": [per knot], "slopes": [[at start,
+	at end] per span, per meter]}, ...}}}
+
+In a span from a to b (h = b - a, t = (x - a) / h) a channel with values p0, p1 and slopes
+m0, m1 is p0 (2t^3 - 3t^2 + 1) + m0 h (t^3 - 2t^2 + t) + p1 (-2t^3 + 3t^2) + m1 h (t^3 - t^2).
+
+*******************************************************************************************/
+
+#define SPLINE_FROM 10			/* meters, closer the corrections grow as 1 / distance */
+#define SPLINE_MAX_SPAN 100		/* meters between the first knots */
+#define SPLINE_MIN_SPAN 2
+#define SPLINE_TOL_ANGLE 0.005	/* scope units, half of the 0.01 the clients show */
+#define SPLINE_TOL_DROP 0.05	/* sm */
+#define SPLINE_TOL_TIME 0.0005	/* s */
+#define SPLINE_TOL_MACH 0.0005
+
+namespace s2 {
+
+	enum splineChannel {
+
+		SPLINE_VERT = 0,
+		SPLINE_DROP,
+		SPLINE_HORIZ,
+		SPLINE_DERIV,
+		SPLINE_TIME,
+		SPLINE_MACH,
+		SPLINE_CHANNELS
+	};
+
+	struct trajectorySpline {
+
+		uint16_t from;
+		uint16_t to;
+
+		std::vector<uint16_t> knots;
+		std::vector<uint16_t> spanOf;		/* span index of every meter from "from" */
+		std::vector<double> values[SPLINE_CHANNELS];		/* per knot */
+		std::vector<double> slopes[SPLINE_CHANNELS];		/* per span: at its start and at its end, per meter */
+		double error[SPLINE_CHANNELS];
+
+		bool evaluate(double dist, double OUT result[SPLINE_CHANNELS]) const;
+		size_t bytes() const;
+	};
+
+	class splineCache : public shardedLRU<std::string, std::shared_ptr<const trajectorySpline>> {
+
+		public:
+
+			using shardedLRU::shardedLRU;
+
+			/* The request without Token, Inputs.dist. and the queries */
+			static std::string makeKey(const nlohmann::json& bodyJson);
+	};
+
+	bool isSplineRequest(const nlohmann::json& bodyJson);
+	std::shared_ptr<const trajectorySpline> fitSpline(const nlohmann::json& bodyJson, SolverContext& ctx);
+	void serializeSpline(const nlohmann::json& bodyJson, const trajectorySpline& spline, std::string& workBuffer);
+}
+
+#endif /* _TRAJECTORY_SPLINE_H_ */
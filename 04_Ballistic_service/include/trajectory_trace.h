@@ -0,0 +1,62 @@
+#ifndef _TRAJECTORY_TRACE_H_
+#define _TRAJECTORY_TRACE_H_
+
+#include "trajectory_solver_API.h"
+#include "solver_structs_and_consts.h"
+#include "sharded_lru.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*******************************************************************************************
+
+Per-metre trace of the last fixed-step trajectory for every profile and atmosphere. Only the 
+cross wind, target speed and terrain angle changed -> the solver replays the stored vertical 
+and time solution and re-integrates the lateral channel only (see replayTrace()), anything 
+drag-relevant changed -> full integration, the new trace replaces the old one.
+
+Replay keeps the full speed of the traced shot, so the cross wind feedback on drag (second 
+order, Vz << Vx) is the only difference to a full solve. Range and vertical wind components 
+must be within TRACE_WIND_TOLERANCE of the traced ones. A replayed answer thus depends on 
+which request left the trace, the daemon keeps traces only when [Trajectory_trace] size > 0.
+
+*******************************************************************************************/
+
+#define TRACE_WIND_TOLERANCE 0.03	/* feets/s, range and vertical wind components */
+
+struct traceStep { /* one metre of the traced integration */
+
+	double H2;			/* elevation in feets (absolute) after the step */
+	double Time;		/* flight time after the step */
+	double M;			/* Mach number after the step */
+	double Vprev;		/* full speed before the step */
+	double C4;			/* drag factors of both Heun stages */
+	double C5;
+	double Vx13;		/* Vx1 + Vx3 */
+};
+
+struct trajectoryTrace {
+
+	std::vector<traceStep> steps;		/* 0 ... last integrated metre */
+
+	struct windPortion winds[MAX_WIND_SEGMENTS];	/* range/vertical components the trace was solved with, per wind segment */
+	struct dragAndBCInfo dragInfo;					/* state after the last step */
+	struct calibrationDistances calibDists;
+	struct zeroingInfo zeroData;
+};
+
+class trajectoryTraceCache : public shardedLRU<std::string, std::shared_ptr<const trajectoryTrace>> {
+
+	public:
+
+		using shardedLRU::shardedLRU;
+
+		static std::string makeKey(const struct Meteo* const meteo, const struct Bullet* const bullet, const struct Rifle* const rifle, 
+			const struct Options* const options, double latitude, uint16_t lastDist, uint16_t range);
+};
+
+void traceWinds(const struct windTable* const table, struct windPortion OUT winds[MAX_WIND_SEGMENTS]);
+bool traceWindsMatch(const struct windPortion traced[MAX_WIND_SEGMENTS], const struct windPortion current[MAX_WIND_SEGMENTS], uint8_t count);
+
+#endif /* _TRAJECTORY_TRACE_H_ */
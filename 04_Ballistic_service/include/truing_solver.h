@@ -0,0 +1,107 @@
+#ifndef _TRUING_SOLVER_H_
+#define _TRUING_SOLVER_H_
+
+#include "trajectory_solver_API.h"
+#include "trajectory_solver.h"
+#include "json_working_stuff.h"
+#include "nlohmann.h"
+
+#include <string>
+#include <vector>
+
+/*******************************************************************************************
+
+Truing: the usual single-shot sections (Inputs.dist. is not used) plus
+
+"Truing": {"observed": [{"dist.": 600, "vert.": 4.3}, {"dist.": 900, "vert.": 8.1}], "fit": "V0+BC"}
+
+	observed - distances in meters and the vertical corrections (scope units) that hit there
+	fit - "V0", "BC", "V0+BC" (default) or "MBC", nothing else: BC factors at up to TRUING_MAX_KNOTS Mach
+	knots spread over the Mach numbers of the observed distances, linear between them. MBC
+	needs a G1/G7/MBCG1/MBCG7 bullet and replies a multi-BC curve. BC scales MBC points or
+	divides CDM points for such bullets.
+
+Least squares of the correction residuals by a pattern search: every iteration solves the
+neighbours of the current point (V0 +- step, BC factors +- step, all combinations up to
+LOCKSTEP_MAX_LANES of them) as one batch, moves to the best one or halves the steps. The
+batch is solved in lockstep groups spread over the pool, V0 stays integer as in the API.
+
+Reply: {"Version": "...", "Token": "...", "Truing": {"Bullet": {fitted Bullet section},
+	"rms": 0.03, "rms.before": 0.41, "iterations": 24, "solves": 190,
+	"residuals": [{"dist.": 600, "vert.": 4.3, "fit": 4.28}, ...]}}
+
+*******************************************************************************************/
+
+#define TRUING_MAX_OBSERVED 16
+#define TRUING_MAX_KNOTS 4
+#define TRUING_MAX_ITERATIONS 100
+#define TRUING_V0_STEP 16			/* m/s, first step */
+#define TRUING_FACTOR_STEP 0.08		/* first step of BC factors */
+#define TRUING_FACTOR_TOLERANCE 1e-4	/* the search stops below it (and V0 step 1) */
+
+namespace s2 {
+
+	bool isTruingRequest(const nlohmann::json& bodyJson);
+
+	class truingsolver {
+
+		private:
+
+			datapreparator m_dp;
+			nlohmann::json m_bulletJson;
+
+			Bullet m_bullet{};
+			Rifle m_rifle{};
+			Scope m_scope{};
+			Meteo m_meteo{};
+			Options m_options{};
+			Inputs m_inputs{};
+
+			std::vector<uint16_t> m_dists;
+			std::vector<double> m_observed;
+
+			bool m_fitV0{true};
+			std::vector<double> m_knots;		/* Mach of the BC factors, empty - BC is not fitted */
+
+			/* Search state: V0 (if fitted) then BC factors */
+			std::vector<double> m_point;
+			std::vector<double> m_steps;
+			double m_cost{0};
+			double m_costBefore{0};
+			std::vector<double> m_fitted;
+			uint32_t m_iterations{0};
+			uint32_t m_solves{0};
+
+			struct candidate {
+
+				Bullet bullet;
+				CDMDataArray cdm;
+				MBCDataArray mbc;
+				Results results;
+
+				std::vector<double> point;
+				std::vector<double> predicted;
+				double cost;
+			};
+
+			std::vector<candidate> m_batch;
+
+			Options solveOptions() const;
+			double factorAt(const std::vector<double>& point, double Mach) const;
+			void applyPoint(candidate& OUT c) const;
+			void readPredicted(candidate& OUT c) const;
+			nlohmann::json fittedBullet() const;
+
+		public:
+			explicit truingsolver(const nlohmann::json& bodyJson);
+
+			size_t batchSize() const;
+			void solveNominal(SolverContext& ctx);
+			bool prepareBatch();
+			void solveBatch(size_t first, size_t count, SolverContext* const ctxs[]);
+			void acceptBatch();
+			void serializeResults(std::string& workBuffer) const;
+	};
+}
+
+#endif /* _TRUING_SOLVER_H_ */
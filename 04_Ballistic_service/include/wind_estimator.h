@@ -0,0 +1,117 @@
+#ifndef _WIND_ESTIMATOR_H_
+#define _WIND_ESTIMATOR_H_
+
+#include "trajectory_solver_API.h"
+#include "trajectory_solver.h"
+#include "json_working_stuff.h"
+#include "nlohmann.h"
+
+#include <string>
+#include <vector>
+
+/*******************************************************************************************
+
+Wind estimation: the usual single-shot sections (Inputs.dist. is not used) plus
+
+"WindEstimate": {"observed": [{"dist.": 600, "horiz.": -0.4}, {"dist.": 900, "horiz.": -1.1}],
+	"segments": [0, 500], "dir.": 60}
+
+	observed - distances in meters and the horizontal corrections (scope units, wind plus
+	derivation as horiz. + deriv. of the forward reply) that hit there, i.e. the dialed
+	correction plus the observed miss in scope units
+	segments - start distances of the wind segments to estimate (up to MAX_WIND_SEGMENTS),
+	default one per observation starting at the previous observed distance
+	dir. - wind direction if it is known (a flag, mirage), the speed along it is estimated.
+	Without it the wind is a pure crosswind (90 or 270)
+
+Only the crosswind is seen by horizontal misses. The drift is almost linear in it, so it is
+estimated by Gauss-Newton: every iteration solves the current winds and the winds with one
+segment changed by WIND_ESTIMATE_DELTA as one batch (lockstep groups spread over the pool),
+then the least squares step from these differences. Neighbouring segments are tied by a weak
+smoothing term, so segments no observation can see take the wind of the ones before them.
+Meteo (but wind), Rifle, Scope and the rest come from the request.
+
+Reply: {"Version": "...", "Token": "...", "WindEstimate": {"Meteo": {"wind": "complex",
+	"windage": [{"dist.": 0, "speed": 3.1, "dir.": 90, "incl.": 0}, ...]}, "cross": [3.1, ...],
+	"rms": 0.01, "rms.before": 0.35, "iterations": 2, "solves": 6,
+	"residuals": [{"dist.": 600, "horiz.": -0.4, "fit": -0.41}, ...]}}
+
+rms.before is the one of the request's own wind. The daemon keeps the last estimate of a Token
+(up to [Wind_estimates] size of them, the least recently used go first),
+"Meteo": {"wind": "estimated", ...} of later requests with it is replaced by the estimate.
+
+*******************************************************************************************/
+
+#define WIND_ESTIMATE_MAX_OBSERVED 16
+#define WIND_ESTIMATE_MAX_ITERATIONS 5
+#define WIND_ESTIMATE_DELTA 1.0			/* m/s, crosswind change for the differences */
+#define WIND_ESTIMATE_TOLERANCE 0.01	/* m/s, the iterations stop below it */
+#define WIND_ESTIMATE_SMOOTHING 1e-5	/* weight of the neighbour tie, relative to the mean curvature */
+
+namespace s2 {
+
+	bool isWindEstimateRequest(const nlohmann::json& bodyJson);
+
+	class windestimator {
+
+		private:
+
+			datapreparator m_dp;
+
+			Bullet m_bullet{};
+			Rifle m_rifle{};
+			Scope m_scope{};
+			Meteo m_meteo{};
+			Options m_options{};
+			Inputs m_inputs{};
+
+			std::vector<uint16_t> m_dists;
+			std::vector<double> m_observed;
+
+			std::vector<uint16_t> m_segments;	/* start distances */
+			uint16_t m_dir{90};
+			bool m_dirKnown{false};
+			double m_terrainDir{0};
+
+			/* Search state: crosswind (m/s) of every segment */
+			std::vector<double> m_cross;
+			double m_cost{0};
+			double m_costBefore{0};
+			std::vector<double> m_fitted;
+			uint32_t m_iterations{0};
+			uint32_t m_solves{0};
+			bool m_final{false};
+			bool m_converged{false};
+
+			struct candidate {
+
+				Meteo meteo;
+				windDataArray winds;
+				Results results;
+
+				std::vector<double> predicted;
+				double cost;
+			};
+
+			std::vector<candidate> m_batch;
+
+			Options solveOptions() const;
+			void applyWinds(const std::vector<double>& cross, candidate& OUT c) const;
+			void readPredicted(candidate& OUT c) const;
+			double speedOf(double cross) const;
+			uint16_t dirOf(double cross) const;
+
+		public:
+			explicit windestimator(const nlohmann::json& bodyJson);
+
+			size_t batchSize() const;
+			void solveNominal(SolverContext& ctx);
+			bool prepareBatch();
+			void solveBatch(size_t first, size_t count, SolverContext* const ctxs[]);
+			void acceptBatch();
+			nlohmann::json windage() const;
+			void serializeResults(std::string& workBuffer) const;
+	};
+}
+
+#endif /* _WIND_ESTIMATOR_H_ */
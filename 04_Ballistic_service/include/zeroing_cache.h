@@ -0,0 +1,32 @@
+#ifndef _ZEROING_CACHE_H_
+#define _ZEROING_CACHE_H_
+
+#include "solver_structs_and_consts.h"
+#include "sharded_lru.h"
+
+/*******************************************************************************************
+
+Throw angles of ZeroingAngleforNumeric() (zero.atm = not_here) keyed by exactly its inputs. 
+Keys are exact, a changed profile simply misses, clear() drops everything.
+
+*******************************************************************************************/
+
+struct zeroingKeyHash {
+	size_t operator()(const zeroingKey& key) const;
+};
+
+struct zeroingKeyEqual {
+	bool operator()(const zeroingKey& lhs, const zeroingKey& rhs) const;
+};
+
+class zeroingCache : public shardedLRU<zeroingKey, double, zeroingKeyHash, zeroingKeyEqual> {
+
+	public:
+		using shardedLRU::shardedLRU;
+};
+
+/* ZeroingAngleforNumeric() through the cache (none - computed every time) */
+double cachedZeroingAngle(zeroingCache* cache, double G_f, const struct Rifle* const rifle, const struct Bullet* const bullet, 
+	const struct Meteo* const meteo, const struct dragAndBCInfo* const dragInfo);
+
+#endif /* _ZEROING_CACHE_H_ */
@@ -1,9 +1,32 @@
 #include "ballistic_daemon.h"
 #include "CFastLog.h"
 #include "json_working_stuff.h"
+#include "parallel_for.h"
 
 #include <iostream>
 
+static std::string supersedeKey(const nlohmann::json& bodyJson) {
+
+	/* Token и вид запроса: новый запрос вытесняет только запрос того же вида с тем же Token.
+	Команды, регистрации и оценки ветра меняют состояние демона и не вытесняются ("" - не вытесняется) */
+
+	if(!bodyJson.is_object() || !bodyJson.contains("Token") || bodyJson.contains("Command") || 
+		s2::isRegisterRequest(bodyJson) || s2::isWindEstimateRequest(bodyJson)) {
+		return "";
+	}
+
+	/* Порядок как в solveRequest */
+	const char* kind = s2::isBatchRequest(bodyJson) ? "Batch" : 
+		s2::isDispersionRequest(bodyJson) ? "Dispersion" : 
+		s2::isInverseRequest(bodyJson) ? "Inverse" : 
+		s2::isTruingRequest(bodyJson) ? "Truing" : 
+		s2::isSweepRequest(bodyJson) ? "Sweep" : 
+		s2::isSplineRequest(bodyJson) ? "Spline" : 
+		s2::isMultiDistanceRequest(bodyJson) ? "Distances" : "Shot";
+
+	return bodyJson["Token"].dump() + " " + kind;
+}
+
 ballisticDaemon::ballisticDaemon(const std::string inifilePath, const std::string serviceName) :  
 baseDaemon(inifilePath, serviceName) {}
 
@@ -48,12 +71,144 @@ bool ballisticDaemon::init() {
 		return false;
 	}
 
+	initSolverContexts();
 	initQueueThread();
 
+	/* Серия однотипных запросов клиента (ручка ветра и т.п.) - считается и отправляется только последний из них */
+	m_supersede = m_iniParser->getBool("Requests", "supersede", false);
+
+	if(m_supersede) {
+		LOG_INFO(fastlog::LogEventType::System) << "Устаревшие запросы того же вида с тем же Token пропускаются";
+	}
+
 	LOG_INFO(fastlog::LogEventType::System) << "Демон по рассчету баллистики успешно инициирован";
 	return true;
 }
 
+void ballisticDaemon::initSolverContexts() {
+
+	/* Каждому потоку - по контексту на дорожку интегратора, одиночные запросы используют первый из них */
+	m_solverContexts.resize(m_ThreadPool.size() * LOCKSTEP_MAX_LANES);
+
+	/* Каждая выборка рассеивания - новый профиль, кэши пристрелки и трасс ими только засорялись бы */
+	m_sampleContexts.resize(m_ThreadPool.size() * LOCKSTEP_MAX_LANES);
+
+	auto cacheSize = m_iniParser->getInt("Zeroing_cache", "size", 1024);
+	auto cacheShards = m_iniParser->getInt("Zeroing_cache", "shards", 8);
+
+	if(cacheSize > 0) {
+
+		m_zeroingCache = std::make_unique<zeroingCache>(cacheSize, cacheShards > 0 ? cacheShards : 1);
+
+		for(auto& ctx : m_solverContexts) {
+			ctx.zeroCache = m_zeroingCache.get();
+		}
+
+		LOG_INFO(fastlog::LogEventType::System) << "Кэш пристрелки включен, размер [" << cacheSize << "], сегментов [" << cacheShards << "]";
+	}
+
+	/* Трасса ~220 КБ на профиль, одиночные запросы с тем же профилем и атмосферой пересчитывают только боковой канал.
+	Пересчет не учитывает влияние бокового ветра на сопротивление, ответ зависит от того, какой запрос оставил трассу, 
+	поэтому трассы включаются только явно */
+	auto traceSize = m_iniParser->getInt("Trajectory_trace", "size", 0);
+	auto traceShards = m_iniParser->getInt("Trajectory_trace", "shards", 4);
+
+	if(traceSize > 0) {
+
+		m_traceCache = std::make_unique<trajectoryTraceCache>(traceSize, traceShards > 0 ? traceShards : 1);
+
+		for(int i = 0; i < m_ThreadPool.size(); i++) {
+			m_solverContexts[i * LOCKSTEP_MAX_LANES].traceCache = m_traceCache.get();
+		}
+
+		LOG_INFO(fastlog::LogEventType::System) << "Трассы траекторий включены, размер [" << traceSize << "], сегментов [" << traceShards << "]";
+	}
+
+	/* Сплайн ~10 КБ на профиль, атмосферу и ветер */
+	auto splineSize = m_iniParser->getInt("Trajectory_spline", "size", 64);
+	auto splineShards = m_iniParser->getInt("Trajectory_spline", "shards", 4);
+
+	if(splineSize > 0) {
+
+		m_splineCache = std::make_unique<s2::splineCache>(splineSize, splineShards > 0 ? splineShards : 1);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Кэш сплайнов траекторий включен, размер [" << splineSize << "], сегментов [" << splineShards << "]";
+	}
+
+	/* Оценка ветра - до MAX_WIND_SEGMENTS участков на Token, клиенты с новым Token на каждое сообщение 
+	вытесняют старые оценки, а не копят их */
+	auto windSize = m_iniParser->getInt("Wind_estimates", "size", 256);
+	auto windShards = m_iniParser->getInt("Wind_estimates", "shards", 4);
+
+	if(windSize > 0) {
+
+		m_windEstimates = std::make_unique<shardedLRU<std::string, nlohmann::json>>(windSize, windShards > 0 ? windShards : 1);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Оценки ветра запоминаются, размер [" << windSize << "], сегментов [" << windShards << "]";
+	}
+
+	/* Профиль - несколько КБ (таблицы CDM), зарегистрированные профили не вытесняются */
+	auto profilesSize = m_iniParser->getInt("Profiles", "size", 256);
+
+	if(profilesSize > 0) {
+
+		m_profiles = std::make_unique<s2::profileregistry>(profilesSize);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Регистрация профилей включена, профилей не более [" << profilesSize << "]";
+	}
+
+	/* Поверхность отклика меняет результат в пределах своей оценки ошибки, как и кэш ответов */
+	if(m_iniParser->getBool("Response_surface", "enabled", false)) {
+
+		auto surfacesSize = m_iniParser->getInt("Response_surface", "size", 2);
+
+		s2::surfaceGrid grid;
+		grid.temp.from = m_iniParser->getDouble("Response_surface", "temp.from", grid.temp.from);
+		grid.temp.to = m_iniParser->getDouble("Response_surface", "temp.to", grid.temp.to);
+		grid.temp.step = m_iniParser->getDouble("Response_surface", "temp.step", grid.temp.step);
+		grid.press.from = m_iniParser->getDouble("Response_surface", "press.from", grid.press.from);
+		grid.press.to = m_iniParser->getDouble("Response_surface", "press.to", grid.press.to);
+		grid.press.step = m_iniParser->getDouble("Response_surface", "press.step", grid.press.step);
+		grid.humid.from = m_iniParser->getDouble("Response_surface", "humid.from", grid.humid.from);
+		grid.humid.to = m_iniParser->getDouble("Response_surface", "humid.to", grid.humid.to);
+		grid.humid.step = m_iniParser->getDouble("Response_surface", "humid.step", grid.humid.step);
+		grid.maxError = m_iniParser->getDouble("Response_surface", "max.err", grid.maxError);
+
+		if(surfacesSize > 0) {
+
+			m_surfaceCache = std::make_unique<s2::surfaceCache>(surfacesSize, grid);
+
+			LOG_INFO(fastlog::LogEventType::System) << "Поверхности отклика включены, поверхностей [" << surfacesSize 
+			<< "], узлов сетки [" << grid.nodes() << "], допустимая ошибка [" << grid.maxError << "]";
+		}
+	}
+
+	/* Кэш ответов меняет результат в пределах шага квантования, для точной воспроизводимости его нужно выключить */
+	if(m_iniParser->getBool("Result_cache", "enabled", false)) {
+
+		auto resultsSize = m_iniParser->getInt("Result_cache", "size", 4096);
+		auto resultsShards = m_iniParser->getInt("Result_cache", "shards", 8);
+
+		s2::quantizationSteps steps;
+		steps.temp = m_iniParser->getDouble("Result_cache", "temp.step", steps.temp);
+		steps.press = m_iniParser->getDouble("Result_cache", "press.step", steps.press);
+		steps.humid = m_iniParser->getDouble("Result_cache", "humid.step", steps.humid);
+		steps.windSpeed = m_iniParser->getDouble("Result_cache", "wind.step", steps.windSpeed);
+		steps.windDir = m_iniParser->getDouble("Result_cache", "wind.dir.step", steps.windDir);
+
+		if(resultsSize > 0) {
+
+			m_resultCache = std::make_unique<s2::resultcache>(resultsSize, resultsShards > 0 ? resultsShards : 1, steps);
+
+			LOG_INFO(fastlog::LogEventType::System) << "Кэш ответов включен, размер [" << resultsSize << "], сегментов [" << resultsShards 
+			<< "], шаги квантования T/P/H/ветер/направление [" << steps.temp << "/" << steps.press << "/" << steps.humid 
+			<< "/" << steps.windSpeed << "/" << steps.windDir << "]";
+		}
+	}
+
+	LOG_INFO(fastlog::LogEventType::System) << "Инициированы контексты решателя, колличество [" << m_solverContexts.size() << "]";
+}
+
 void ballisticDaemon::initQueueThread() {
 
 	LOG_INFO(fastlog::LogEventType::System) << "Поток для очереди сообщений занят в пулле";
@@ -85,10 +240,44 @@ void ballisticDaemon::run() {
 				
 				incomingData = s_recv(*m_zmqPULLer);
 
-				m_ThreadPool.push([this, data = std::move(incomingData)](int) {
+				/* Вид запроса определяется по разобранному JSON, поэтому при вытеснении запрос разбирается здесь 
+				(порядок регистрации - порядок прихода) и поток пула его уже не разбирает */
+				nlohmann::json bodyJson;
+				std::string key;
+				const uint64_t arrival = ++m_arrivals;
+
+				if(m_supersede) {
+
+					bodyJson = nlohmann::json::parse(incomingData, nullptr, false);
+					key = supersedeKey(bodyJson);
+				}
+
+				if(!key.empty()) {
+
+					std::lock_guard<std::mutex> lock(m_freshestMutex);
+					m_freshest[key] = arrival;
+				}
+
+				m_ThreadPool.push([this, data = std::move(incomingData), bodyJson = std::move(bodyJson), key = std::move(key), 
+					arrival](int id) mutable {
+
+					if(isSuperseded(key, arrival)) {
+
+						m_skipped++;
+						LOG_INFO(fastlog::LogEventType::System) << "Запрос пропущен, есть более новый того же вида [" << key << "]";
+						return;
+					}
 
 					std::string workingBuffer;
-					s2::solveBallistics(data, workingBuffer);
+					solveRequest(id, data, bodyJson, workingBuffer);
+
+					if(!finishRequest(key, arrival)) {
+
+						m_dropped++;
+						LOG_INFO(fastlog::LogEventType::System) << "Результат не отправлен, есть более новый запрос того же вида [" << key << "]";
+						return;
+					}
+
 					sendResultsToQueue(std::move(workingBuffer));
 				});
 			}
@@ -100,6 +289,645 @@ void ballisticDaemon::run() {
 	stopZMQ();
 }
 
+void ballisticDaemon::solveRequest(int threadId, const std::string& data, nlohmann::json& bodyJson, std::string& workingBuffer) {
+
+	try {
+
+		/* Пустой - запрос не разобран при приеме */
+		if(bodyJson.is_null() || bodyJson.is_discarded()) {
+			bodyJson = nlohmann::json::parse(data);
+		}
+	}
+	catch(...) {
+
+		LOG_INFO(fastlog::LogEventType::System) << "Приняты входные данные: " << data;
+		LOG_INFO(fastlog::LogEventType::System) << "Данные не обработаны";
+		workingBuffer = "{}";
+		return;
+	}
+
+	if(bodyJson.contains("Command")) {
+
+		LOG_INFO(fastlog::LogEventType::System) << "Принята команда: " << data;
+		solveCommand(bodyJson, workingBuffer);
+		return;
+	}
+
+	if(s2::isRegisterRequest(bodyJson)) {
+
+		LOG_INFO(fastlog::LogEventType::System) << "Принята регистрация профиля: " << data;
+		solveRegister(bodyJson, workingBuffer);
+		return;
+	}
+
+	/* "Profile": "..." - пуля, винтовка и прицел зарегистрированного профиля, 
+	секции самого запроса важнее */
+	std::shared_ptr<const s2::profile> registered;
+
+	if(s2::hasProfileHandle(bodyJson)) {
+
+		const auto handle = bodyJson["Profile"].get<std::string>();
+
+		registered = m_profiles ? m_profiles->find(handle) : nullptr;
+
+		if(!registered) {
+
+			workingBuffer = "{}";
+			LOG_INFO(fastlog::LogEventType::System) << "Профиль не найден [" << handle << "]";
+			return;
+		}
+	}
+
+	applyWindEstimate(bodyJson);
+
+	if(s2::isBatchRequest(bodyJson)) {
+
+		solveBatch(threadId, bodyJson, registered.get(), workingBuffer);
+		return;
+	}
+
+	/* Эти запросы разбирают секции сами, им профиль подставляется в JSON */
+	if(registered && (s2::isDispersionRequest(bodyJson) || s2::isInverseRequest(bodyJson) || s2::isTruingRequest(bodyJson) || 
+		s2::isWindEstimateRequest(bodyJson) || s2::isSweepRequest(bodyJson) || s2::isSplineRequest(bodyJson))) {
+
+		s2::applyProfile(*registered, bodyJson);
+	}
+
+	if(s2::isDispersionRequest(bodyJson)) {
+
+		solveDispersion(threadId, bodyJson, workingBuffer);
+		return;
+	}
+
+	if(s2::isInverseRequest(bodyJson)) {
+
+		solveInverse(threadId, bodyJson, workingBuffer);
+		return;
+	}
+
+	if(s2::isTruingRequest(bodyJson)) {
+
+		solveTruing(threadId, bodyJson, workingBuffer);
+		return;
+	}
+
+	if(s2::isWindEstimateRequest(bodyJson)) {
+
+		solveWindEstimate(threadId, bodyJson, workingBuffer);
+		return;
+	}
+
+	if(s2::isSweepRequest(bodyJson)) {
+
+		solveSweep(threadId, bodyJson, workingBuffer);
+		return;
+	}
+
+	if(s2::isSplineRequest(bodyJson)) {
+
+		solveSpline(threadId, bodyJson, workingBuffer);
+		return;
+	}
+
+	if(s2::isMultiDistanceRequest(bodyJson)) {
+
+		LOG_INFO(fastlog::LogEventType::System) << "Приняты входные данные (несколько дистанций): " << data;
+		s2::solveDistances(bodyJson, workingBuffer, m_solverContexts[threadId * LOCKSTEP_MAX_LANES], registered.get());
+		return;
+	}
+
+	LOG_INFO(fastlog::LogEventType::System) << "Приняты входные данные: " << data;
+
+	if(m_surfaceCache && s2::isSurfaceRequest(bodyJson) && solveFromSurface(bodyJson, registered, workingBuffer)) {
+		return;
+	}
+
+	s2::solveBallistics(bodyJson, workingBuffer, m_solverContexts[threadId * LOCKSTEP_MAX_LANES], m_resultCache.get(), registered.get());
+}
+
+void ballisticDaemon::solveBatch(int threadId, const nlohmann::json& bodyJson, const s2::profile* registered, std::string& workingBuffer) {
+
+	/* Выстрелы пакета раскидываются по потокам пула группами по lockstepLanes() выстрелов, 
+	группа считается интегратором за один проход. Текущий поток участвует в расчете сам */
+
+	try {
+
+		s2::batchsolver batch(bodyJson, registered);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Принят пакет на расчет, выстрелов в пакете [" << batch.size() << "]";
+
+		const size_t lanes = lockstepLanes();
+		const size_t groups = (batch.size() + lanes - 1) / lanes;
+
+		threadpool::parallelFor(m_ThreadPool, groups, threadId, [this, &batch, lanes](int id, size_t group) {
+
+			SolverContext* ctxs[LOCKSTEP_MAX_LANES];
+
+			for (size_t l = 0; l < LOCKSTEP_MAX_LANES; l++) {
+				ctxs[l] = &m_solverContexts[id * LOCKSTEP_MAX_LANES + l];
+			}
+
+			const size_t first = group * lanes;
+			batch.solveShots(first, std::min(lanes, batch.size() - first), ctxs);
+		});
+
+		batch.serializeResults(workingBuffer);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Пакет рассчитан, выстрелов [" << batch.size() << "]";
+	}
+	catch(...) {
+
+		workingBuffer = "{}";
+		LOG_INFO(fastlog::LogEventType::System) << "Пакет не обработан";
+	}
+}
+
+void ballisticDaemon::solveDispersion(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer) {
+
+	/* Номинальное решение считает текущий поток, выборки раскидываются по потокам пула 
+	группами по lockstepLanes(), результат не зависит от того, какой поток какую группу взял */
+
+	try {
+
+		s2::dispersionsolver dispersion(bodyJson);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Принят расчет рассеивания, выборок [" << dispersion.size() << "]";
+
+		dispersion.solveNominal(m_solverContexts[threadId * LOCKSTEP_MAX_LANES]);
+
+		const size_t lanes = lockstepLanes();
+		const size_t groups = (dispersion.size() + lanes - 1) / lanes;
+
+		threadpool::parallelFor(m_ThreadPool, groups, threadId, [this, &dispersion, lanes](int id, size_t group) {
+
+			SolverContext* ctxs[LOCKSTEP_MAX_LANES];
+
+			for (size_t l = 0; l < LOCKSTEP_MAX_LANES; l++) {
+				ctxs[l] = &m_sampleContexts[id * LOCKSTEP_MAX_LANES + l];
+			}
+
+			const size_t first = group * lanes;
+			dispersion.solveSamples(first, std::min(lanes, dispersion.size() - first), ctxs);
+		});
+
+		dispersion.serializeResults(workingBuffer);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Рассеивание рассчитано, выборок [" << dispersion.size() << "]";
+	}
+	catch(...) {
+
+		workingBuffer = "{}";
+		LOG_INFO(fastlog::LogEventType::System) << "Расчет рассеивания не выполнен";
+	}
+}
+
+void ballisticDaemon::solveInverse(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer) {
+
+	/* Траектория считается один раз на всю дальность, все запросы отвечаются по ее строкам */
+
+	try {
+
+		s2::inversesolver inverse(bodyJson);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Принят обратный запрос, вопросов [" << bodyJson["Inverse"].size() << "]";
+
+		inverse.solve(m_solverContexts[threadId * LOCKSTEP_MAX_LANES]);
+		inverse.serializeResults(workingBuffer);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Обратный запрос рассчитан";
+	}
+	catch(...) {
+
+		workingBuffer = "{}";
+		LOG_INFO(fastlog::LogEventType::System) << "Обратный запрос не обработан";
+	}
+}
+
+void ballisticDaemon::solveTruing(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer) {
+
+	/* Каждая итерация подбора - пакет соседних точек, он считается группами по lockstepLanes()
+	на потоках пула, как выборки рассеивания. Итерации идут последовательно */
+
+	try {
+
+		s2::truingsolver truing(bodyJson);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Принят расчет пристрелки по наблюдениям, точек [" << bodyJson["Truing"]["observed"].size() << "]";
+
+		truing.solveNominal(m_solverContexts[threadId * LOCKSTEP_MAX_LANES]);
+
+		const size_t lanes = lockstepLanes();
+
+		while(truing.prepareBatch()) {
+
+			const size_t groups = (truing.batchSize() + lanes - 1) / lanes;
+
+			threadpool::parallelFor(m_ThreadPool, groups, threadId, [this, &truing, lanes](int id, size_t group) {
+
+				SolverContext* ctxs[LOCKSTEP_MAX_LANES];
+
+				for (size_t l = 0; l < LOCKSTEP_MAX_LANES; l++) {
+					ctxs[l] = &m_sampleContexts[id * LOCKSTEP_MAX_LANES + l];
+				}
+
+				const size_t first = group * lanes;
+				truing.solveBatch(first, std::min(lanes, truing.batchSize() - first), ctxs);
+			});
+
+			truing.acceptBatch();
+		}
+
+		truing.serializeResults(workingBuffer);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Пристрелка по наблюдениям рассчитана";
+	}
+	catch(...) {
+
+		workingBuffer = "{}";
+		LOG_INFO(fastlog::LogEventType::System) << "Пристрелка по наблюдениям не выполнена";
+	}
+}
+
+void ballisticDaemon::solveWindEstimate(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer) {
+
+	/* Итерация Гаусса-Ньютона - пакет из текущего ветра и ветров с одним измененным участком,
+	считается группами по lockstepLanes() на потоках пула. Оценка запоминается по Token */
+
+	try {
+
+		s2::windestimator estimator(bodyJson);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Принята оценка ветра по промахам, точек [" << bodyJson["WindEstimate"]["observed"].size() << "]";
+
+		estimator.solveNominal(m_solverContexts[threadId * LOCKSTEP_MAX_LANES]);
+
+		const size_t lanes = lockstepLanes();
+
+		while(estimator.prepareBatch()) {
+
+			const size_t groups = (estimator.batchSize() + lanes - 1) / lanes;
+
+			threadpool::parallelFor(m_ThreadPool, groups, threadId, [this, &estimator, lanes](int id, size_t group) {
+
+				SolverContext* ctxs[LOCKSTEP_MAX_LANES];
+
+				for (size_t l = 0; l < LOCKSTEP_MAX_LANES; l++) {
+					ctxs[l] = &m_sampleContexts[id * LOCKSTEP_MAX_LANES + l];
+				}
+
+				const size_t first = group * lanes;
+				estimator.solveBatch(first, std::min(lanes, estimator.batchSize() - first), ctxs);
+			});
+
+			estimator.acceptBatch();
+		}
+
+		estimator.serializeResults(workingBuffer);
+
+		if(m_windEstimates && bodyJson.contains("Token")) {
+			m_windEstimates->insert(bodyJson["Token"].dump(), estimator.windage());
+		}
+
+		LOG_INFO(fastlog::LogEventType::System) << "Ветер по промахам оценен";
+	}
+	catch(...) {
+
+		workingBuffer = "{}";
+		LOG_INFO(fastlog::LogEventType::System) << "Оценка ветра не выполнена";
+	}
+}
+
+void ballisticDaemon::solveSweep(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer) {
+
+	/* Траектория интегрируется один раз, ячейки (угол места, азимут) - только пересчет ее строк,
+	углы места раскидываются по потокам пула */
+
+	try {
+
+		s2::sweepsolver sweep(bodyJson);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Принят расчет таблицы сектора, углов места [" << sweep.angles() << "]";
+
+		sweep.solveBase(m_solverContexts[threadId * LOCKSTEP_MAX_LANES]);
+
+		threadpool::parallelFor(m_ThreadPool, sweep.angles(), threadId, [this, &sweep](int id, size_t angle) {
+
+			sweep.solveAngle(angle, m_sampleContexts[id * LOCKSTEP_MAX_LANES]);
+		});
+
+		sweep.serializeResults(workingBuffer);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Таблица сектора рассчитана";
+	}
+	catch(...) {
+
+		workingBuffer = "{}";
+		LOG_INFO(fastlog::LogEventType::System) << "Таблица сектора не рассчитана";
+	}
+}
+
+void ballisticDaemon::solveSpline(int threadId, const nlohmann::json& bodyJson, std::string& workingBuffer) {
+
+	/* Сплайн строится один раз на профиль, атмосферу и ветер, повторные запросы с другими 
+	дальностями отвечаются по нему без расчета траектории */
+
+	try {
+
+		std::shared_ptr<const s2::trajectorySpline> spline;
+		std::string key;
+
+		if(m_splineCache) {
+
+			key = s2::splineCache::makeKey(bodyJson);
+			m_splineCache->find(key, spline);
+		}
+
+		if(!spline) {
+
+			spline = s2::fitSpline(bodyJson, m_solverContexts[threadId * LOCKSTEP_MAX_LANES]);
+
+			LOG_INFO(fastlog::LogEventType::System) << "Построен сплайн траектории, узлов [" << spline->knots.size() << "]";
+
+			if(m_splineCache) {
+				m_splineCache->insert(key, spline, key.size() + spline->bytes());
+			}
+		}
+
+		s2::serializeSpline(bodyJson, *spline, workingBuffer);
+	}
+	catch(...) {
+
+		workingBuffer = "{}";
+		LOG_INFO(fastlog::LogEventType::System) << "Сплайн траектории не построен";
+	}
+}
+
+bool ballisticDaemon::solveFromSurface(const nlohmann::json& bodyJson, const std::shared_ptr<const s2::profile>& registered, 
+	std::string& workingBuffer) {
+
+	/* Запрос, повторившийся с другой атмосферой, - активный: его сетка считается в фоне на одном потоке пула 
+	(контексты выборок этого потока), пока ответы идут прямым расчетом */
+
+	try {
+
+		const auto key = s2::surfaceCache::makeKey(bodyJson);
+
+		std::shared_ptr<const s2::responseSurface> surface;
+
+		if(m_surfaceCache->find(key, surface)) {
+
+			if(!s2::solveFromSurface(bodyJson, *surface, m_surfaceCache->grid().maxError, workingBuffer)) {
+				return false;
+			}
+
+			LOG_INFO(fastlog::LogEventType::System) << "Результат по поверхности отклика: " << workingBuffer;
+			return true;
+		}
+
+		if(!m_surfaceCache->startBuild(key)) {
+			return false;
+		}
+
+		m_ThreadPool.push([this, bodyJson, registered, key](int id) {
+
+			SolverContext* ctxs[LOCKSTEP_MAX_LANES];
+
+			for (size_t l = 0; l < LOCKSTEP_MAX_LANES; l++) {
+				ctxs[l] = &m_sampleContexts[id * LOCKSTEP_MAX_LANES + l];
+			}
+
+			try {
+
+				auto surface = std::make_shared<const s2::responseSurface>(bodyJson, m_surfaceCache->grid(), registered.get(), ctxs);
+				m_surfaceCache->insert(key, surface, key.size() + surface->bytes());
+
+				LOG_INFO(fastlog::LogEventType::System) << "Построена поверхность отклика, КБ [" << surface->bytes() / 1024 << "]";
+			}
+			catch(...) {
+
+				LOG_INFO(fastlog::LogEventType::System) << "Поверхность отклика не построена";
+			}
+
+			m_surfaceCache->finishBuild();
+		});
+	}
+	catch(...) {}
+
+	return false;
+}
+
+void ballisticDaemon::solveRegister(const nlohmann::json& bodyJson, std::string& workingBuffer) {
+
+	/* Секции разбираются и проверяются один раз, дальше запросы берут готовые структуры решателя */
+
+	try {
+
+		if(!m_profiles) {
+			throw std::out_of_range("profiles are disabled");
+		}
+
+		const auto handle = m_profiles->add(bodyJson["Register"]);
+
+		s2::serializeRegistration(bodyJson, handle, workingBuffer);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Профиль зарегистрирован [" << handle << "], профилей [" << m_profiles->size() << "]";
+	}
+	catch(const std::exception& ex) {
+
+		workingBuffer = "{}";
+		LOG_INFO(fastlog::LogEventType::System) << "Профиль не зарегистрирован: [" << ex.what() << "]";
+	}
+}
+
+void ballisticDaemon::applyWindEstimate(nlohmann::json& bodyJson) {
+
+	/* "Meteo": {"wind": "estimated", ...} - ветер из последней оценки по тому же Token,
+	без оценки остается "windage" запроса (как сложный ветер) */
+
+	if(!m_windEstimates || !bodyJson.is_object() || !bodyJson.contains("Meteo") || !bodyJson["Meteo"].is_object() || 
+		bodyJson["Meteo"].value("wind", nlohmann::json()) != "estimated" || !bodyJson.contains("Token")) {
+		return;
+	}
+
+	nlohmann::json windage;
+
+	if(m_windEstimates->find(bodyJson["Token"].dump(), windage)) {
+
+		bodyJson["Meteo"]["wind"] = "complex";
+		bodyJson["Meteo"]["windage"] = std::move(windage);
+	}
+}
+
+void ballisticDaemon::solveCommand(const nlohmann::json& bodyJson, std::string& workingBuffer) {
+
+	/* Служебные команды:
+	{"Command": "zeroing.stats", "Token": "..."} - счетчики кэша пристрелки
+	{"Command": "zeroing.reset", "Token": "..."} - очистка кэша (при изменении профилей)
+	{"Command": "results.stats", "Token": "..."} - счетчики кэша ответов
+	{"Command": "results.reset", "Token": "..."} - очистка кэша ответов
+	{"Command": "wind.reset", "Token": "..."} - сброс оценок ветра
+	{"Command": "spline.stats", "Token": "..."} - счетчики кэша сплайнов
+	{"Command": "spline.reset", "Token": "..."} - очистка кэша сплайнов
+	{"Command": "surface.stats", "Token": "..."} - счетчики поверхностей отклика
+	{"Command": "surface.reset", "Token": "..."} - удаление поверхностей отклика
+	{"Command": "requests.stats", "Token": "..."} - счетчики вытесненных запросов (пропущенных и не отправленных)
+	{"Command": "profiles.stats", "Token": "..."} - число зарегистрированных профилей
+	{"Command": "profiles.reset", "Token": "..."} - удаление всех профилей (их идентификаторы больше не действуют) */
+
+	try {
+
+		auto command = bodyJson["Command"].get<std::string>();
+
+		nlohmann::json responceJson;
+		responceJson["Command"] = command;
+
+		if(bodyJson.contains("Token")) {
+			responceJson["Token"] = bodyJson["Token"];
+		}
+
+		if(command == "zeroing.stats" || command == "zeroing.reset") {
+
+			if(command == "zeroing.reset" && m_zeroingCache) {
+
+				m_zeroingCache->clear();
+				LOG_INFO(fastlog::LogEventType::System) << "Кэш пристрелки очищен";
+			}
+
+			responceJson["hits"] = m_zeroingCache ? m_zeroingCache->hits() : 0;
+			responceJson["misses"] = m_zeroingCache ? m_zeroingCache->misses() : 0;
+			responceJson["evictions"] = m_zeroingCache ? m_zeroingCache->evictions() : 0;
+			responceJson["size"] = m_zeroingCache ? m_zeroingCache->size() : 0;
+		}
+		else if(command == "results.stats" || command == "results.reset") {
+
+			if(command == "results.reset" && m_resultCache) {
+
+				m_resultCache->clear();
+				LOG_INFO(fastlog::LogEventType::System) << "Кэш ответов очищен";
+			}
+
+			const auto hits = m_resultCache ? m_resultCache->hits() : 0;
+			const auto misses = m_resultCache ? m_resultCache->misses() : 0;
+
+			responceJson["enabled"] = m_resultCache != nullptr;
+			responceJson["hits"] = hits;
+			responceJson["misses"] = misses;
+			responceJson["hit.ratio"] = hits + misses > 0 ? (double)hits / (hits + misses) : 0.0;
+			responceJson["evictions"] = m_resultCache ? m_resultCache->evictions() : 0;
+			responceJson["size"] = m_resultCache ? m_resultCache->size() : 0;
+			responceJson["bytes"] = m_resultCache ? m_resultCache->bytes() : 0;
+		}
+		else if(command == "spline.stats" || command == "spline.reset") {
+
+			if(command == "spline.reset" && m_splineCache) {
+
+				m_splineCache->clear();
+				LOG_INFO(fastlog::LogEventType::System) << "Кэш сплайнов очищен";
+			}
+
+			responceJson["hits"] = m_splineCache ? m_splineCache->hits() : 0;
+			responceJson["misses"] = m_splineCache ? m_splineCache->misses() : 0;
+			responceJson["evictions"] = m_splineCache ? m_splineCache->evictions() : 0;
+			responceJson["size"] = m_splineCache ? m_splineCache->size() : 0;
+			responceJson["bytes"] = m_splineCache ? m_splineCache->bytes() : 0;
+		}
+		else if(command == "surface.stats" || command == "surface.reset") {
+
+			if(command == "surface.reset" && m_surfaceCache) {
+
+				m_surfaceCache->clear();
+				LOG_INFO(fastlog::LogEventType::System) << "Поверхности отклика удалены";
+			}
+
+			responceJson["enabled"] = m_surfaceCache != nullptr;
+			responceJson["hits"] = m_surfaceCache ? m_surfaceCache->hits() : 0;
+			responceJson["misses"] = m_surfaceCache ? m_surfaceCache->misses() : 0;
+			responceJson["evictions"] = m_surfaceCache ? m_surfaceCache->evictions() : 0;
+			responceJson["size"] = m_surfaceCache ? m_surfaceCache->size() : 0;
+			responceJson["bytes"] = m_surfaceCache ? m_surfaceCache->bytes() : 0;
+		}
+		else if(command == "requests.stats") {
+
+			std::lock_guard<std::mutex> lock(m_freshestMutex);
+
+			responceJson["supersede"] = m_supersede;
+			responceJson["skipped"] = m_skipped.load();
+			responceJson["dropped"] = m_dropped.load();
+			responceJson["pending.tokens"] = m_freshest.size();
+		}
+		else if(command == "profiles.stats" || command == "profiles.reset") {
+
+			if(command == "profiles.reset" && m_profiles) {
+
+				m_profiles->clear();
+				LOG_INFO(fastlog::LogEventType::System) << "Профили удалены";
+			}
+
+			responceJson["enabled"] = m_profiles != nullptr;
+			responceJson["size"] = m_profiles ? m_profiles->size() : 0;
+			responceJson["capacity"] = m_profiles ? m_profiles->capacity() : 0;
+		}
+		else if(command == "wind.reset") {
+
+			responceJson["size"] = m_windEstimates ? m_windEstimates->size() : 0;
+			responceJson["evictions"] = m_windEstimates ? m_windEstimates->evictions() : 0;
+
+			if(m_windEstimates) {
+				m_windEstimates->clear();
+			}
+
+			LOG_INFO(fastlog::LogEventType::System) << "Оценки ветра сброшены";
+		}
+		else {
+
+			workingBuffer = "{}";
+			LOG_INFO(fastlog::LogEventType::System) << "Неизвестная команда [" << command << "]";
+			return;
+		}
+
+		workingBuffer = responceJson.dump(4);
+	}
+	catch(...) {
+
+		workingBuffer = "{}";
+		LOG_INFO(fastlog::LogEventType::System) << "Команда не обработана";
+	}
+}
+
+bool ballisticDaemon::isSuperseded(const std::string& key, uint64_t arrival) {
+
+	if(key.empty()) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_freshestMutex);
+
+	auto freshest = m_freshest.find(key);
+
+	return freshest != m_freshest.end() && freshest->second != arrival;
+}
+
+bool ballisticDaemon::finishRequest(const std::string& key, uint64_t arrival) {
+
+	/* false - пока запрос считался, пришел более новый, его результат и будет отправлен */
+
+	if(key.empty()) {
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lock(m_freshestMutex);
+
+	auto freshest = m_freshest.find(key);
+
+	if(freshest == m_freshest.end() || freshest->second != arrival) {
+		return false;
+	}
+
+	m_freshest.erase(freshest);
+
+	return true;
+}
+
 void ballisticDaemon::sendResultsToQueue(std::string&& workingBuffer) {
 
 	LOG_INFO(fastlog::LogEventType::System) << "Результаты расчета добавлены в очередь на отправку";
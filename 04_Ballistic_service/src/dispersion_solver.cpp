@@ -0,0 +1,348 @@
+#include "dispersion_solver.h"
+#include "trajectory_solver_lockstep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/* splitmix64, one stream per sample */
+struct randomStream {
+
+	uint64_t state;
+
+	uint64_t next() {
+
+		uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	double uniform() { /* [0, 1) */
+
+		return (next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	double normal() { /* Box-Muller, second value is dropped to keep the stream layout simple */
+
+		double u1 = 1.0 - uniform();
+		double u2 = uniform();
+		return sqrt(-2.0 * log(u1)) * cos(2.0 * Pi * u2);
+	}
+};
+
+static inline double roundStochastic(double value, randomStream& rnd) {
+
+	double base = floor(value);
+	return base + (rnd.uniform() < value - base ? 1.0 : 0.0);
+}
+
+static inline uint16_t perturbDirection(double dir, double sd, randomStream& rnd) {
+
+	double perturbed = fmod(roundStochastic(dir + sd * rnd.normal(), rnd), 360.0);
+	return (uint16_t)(perturbed < 0 ? perturbed + 360.0 : perturbed);
+}
+
+bool s2::isDispersionRequest(const nlohmann::json& bodyJson) {
+
+	return bodyJson.is_object() && bodyJson.contains("Dispersion") && bodyJson["Dispersion"].is_object();
+}
+
+s2::dispersionsolver::dispersionsolver(const nlohmann::json& bodyJson) {
+
+	m_dp.getToken(bodyJson);
+
+	m_bullet = m_dp.parseForBulletData(bodyJson);
+	m_rifle = m_dp.parseForRifleData(bodyJson);
+	m_scope = m_dp.parseForScopeData(bodyJson);
+	m_meteo = m_dp.parseForMeteoData(bodyJson);
+	m_options = m_dp.parseForOptions(bodyJson);
+	m_inputs = m_dp.parseForInputs(bodyJson);
+
+	/* Offsets are computed in MRAD whatever the scope is */
+	m_scope.angleUnits = MRAD_UNITS;
+
+	const auto& dispersionJson = bodyJson["Dispersion"];
+
+	auto samples = dispersionJson.value("samples", DISPERSION_DEFAULT_SAMPLES);
+	m_spread.samples = std::min(std::max(samples, 1), DISPERSION_MAX_SAMPLES);
+	m_spread.seed = dispersionJson.value("seed", (uint64_t)1);
+
+	m_spread.V0 = dispersionJson.value("V0.sd", 0.0);
+	m_spread.therm = dispersionJson.value("therm.sd", 0.0);
+	m_spread.BC = dispersionJson.value("BC.sd", 0.0);
+	m_spread.windSpeed = dispersionJson.value("wind.speed.sd", 0.0);
+	m_spread.windDir = dispersionJson.value("wind.dir.sd", 0.0);
+	m_spread.dist = dispersionJson.value("dist.sd", 0.0);
+	m_spread.precision = dispersionJson.value("precision.sd", 0.0);
+	m_spread.points = dispersionJson.value("points", false);
+
+	if(dispersionJson.contains("POI.sd")) {
+
+		m_spread.POIvert = dispersionJson["POI.sd"][0].get<double>();
+		m_spread.POIhoriz = dispersionJson["POI.sd"][1].get<double>();
+	}
+
+	if(dispersionJson.contains("target")) {
+
+		const auto& targetJson = dispersionJson["target"];
+
+		m_spread.targetWidth = targetJson.value("width", 0.0);
+		m_spread.targetHeight = targetJson.value("height", 0.0);
+		m_spread.targetDiameter = targetJson.value("diam.", 0.0);
+	}
+
+	m_impacts.resize(m_spread.samples);
+}
+
+size_t s2::dispersionsolver::size() const {
+
+	return m_impacts.size();
+}
+
+Options s2::dispersionsolver::sampleOptions(bool nominal) const {
+
+	/* Only the shot distance is needed, the nominal solve also gets 1 m range-card rows
+	covering the likely measured distances */
+
+	Options options = m_options;
+
+	options.EarlyExit = OPTION_YES;
+	options.MachDistances = OPTION_NO;
+	options.BallisticTable = OPTION_NO;
+	options.RangecardFrom = 0;
+	options.RangecardTo = 0;
+	options.TableStep = 0;
+
+	if(nominal && m_spread.dist > 0) {
+
+		const double range = solverRange(&options);
+		const double margin = 5 * m_spread.dist + 1;
+
+		options.BallisticTable = OPTION_YES;
+		options.TableStep = 1;
+		options.RangecardFrom = (uint16_t)std::max(1.0, m_inputs.shotDistance - margin);
+		options.RangecardTo = (uint16_t)std::min(range, m_inputs.shotDistance + margin);
+	}
+
+	return options;
+}
+
+void s2::dispersionsolver::solveNominal(SolverContext& ctx) {
+
+	const Options options = sampleOptions(true);
+	Results results;
+
+	trajectorySolver(&ctx, &m_meteo, &m_bullet, &m_rifle, &m_scope, &m_inputs, &options, OUT &results);
+
+	m_vertNominal = results.vertAngleUnits;
+	m_horizNominal = results.horizAngleUnits + results.derivAngleUnits;
+	m_throwNominal = ctx.throwAngle;
+
+	m_rowsVert.clear();
+	m_rowsHoriz.clear();
+
+	if(options.BallisticTable == OPTION_YES) {
+
+		m_rowsFrom = rangecardFirstIndex(&options);
+
+		for(uint16_t i = m_rowsFrom; i <= rangecardLastIndex(&options); i++) {
+
+			m_rowsVert.push_back(results.table.Vert[i][1]);
+			m_rowsHoriz.push_back(results.table.Horiz[i][1] + results.table.Deriv[i][1]);
+		}
+	}
+}
+
+void s2::dispersionsolver::perturb(size_t index, sample& OUT s) const {
+
+	randomStream rnd{m_spread.seed * 0xD1B54A32D192ED03ULL + index};
+
+	s.bullet = m_bullet;
+	s.meteo = m_meteo;
+
+	s.bullet.V0 = (uint16_t)std::max(1.0, roundStochastic(m_bullet.V0 + m_spread.V0 * rnd.normal(), rnd));
+	s.bullet.thermalSens = m_bullet.thermalSens + m_spread.therm * rnd.normal();
+
+	const double BCfactor = std::max(0.5, 1.0 + m_spread.BC * rnd.normal());
+	s.bullet.BC = m_bullet.BC * BCfactor;
+
+	if(m_bullet.cdmData) {
+
+		memcpy(s.cdm, *m_bullet.cdmData, sizeof(CDMDataArray));
+
+		for(int i = 0; i < CMD_GRANULARITY; i++) {
+			s.cdm[i].CD /= BCfactor;
+		}
+		s.bullet.cdmData = &s.cdm;
+	}
+
+	if(m_bullet.mbcData) {
+
+		memcpy(s.mbc, *m_bullet.mbcData, sizeof(MBCDataArray));
+
+		for(int i = 0; i < MBC_GRANULARITY; i++) {
+			s.mbc[i].BC *= BCfactor;
+		}
+		s.bullet.mbcData = &s.mbc;
+	}
+
+	if(m_meteo.WindType == SIMPLE_CASE) {
+
+		s.meteo.windSpeed = std::max(0.0, m_meteo.windSpeed + m_spread.windSpeed * rnd.normal());
+		s.meteo.windDir = perturbDirection(m_meteo.windDir, m_spread.windDir, rnd);
+	}
+	else {
+
+		memcpy(s.wind, *m_meteo.windData, sizeof(windDataArray));
+
+		for(int i = 0; i < complexWindSegments(&m_meteo); i++) {
+
+			s.wind[i].windSpeed = std::max(0.0, s.wind[i].windSpeed + m_spread.windSpeed * rnd.normal());
+			s.wind[i].windDir = perturbDirection(s.wind[i].windDir, m_spread.windDir, rnd);
+		}
+		s.meteo.windData = &s.wind;
+	}
+
+	s.measuredDist = m_inputs.shotDistance + m_spread.dist * rnd.normal();
+
+	const double mradPerSmAtZero = 10.0 / m_rifle.zeroDistance;
+
+	s.vertNoise = m_spread.POIvert * mradPerSmAtZero * rnd.normal() + m_spread.precision * rnd.normal();
+	s.horizNoise = m_spread.POIhoriz * mradPerSmAtZero * rnd.normal() + m_spread.precision * rnd.normal();
+}
+
+double s2::dispersionsolver::dialedRow(const std::vector<double>& rows, double dist) const {
+
+	double x = std::min(std::max(dist - m_rowsFrom, 0.0), (double)(rows.size() - 1));
+	size_t i = std::min((size_t)x, rows.size() - 2);
+
+	return rows[i] + (rows[i + 1] - rows[i]) * (x - i);
+}
+
+s2::impactPoint s2::dispersionsolver::impact(const sample& s, const SolverContext& ctx) const {
+
+	const double dist = m_inputs.shotDistance;
+	const double smPerMrad = dist / 10.0;
+
+	/* Needed correction with the bore of the nominal zero, the sample's own zero is
+	tilted by the difference of the throwing angles (radians to MRAD) */
+	double vertNeeded = s.results.vertAngleUnits + 1000.0 * (ctx.throwAngle - m_throwNominal);
+	double horizNeeded = s.results.horizAngleUnits + s.results.derivAngleUnits;
+
+	double vertDialed = m_vertNominal;
+	double horizDialed = m_horizNominal;
+
+	if(m_rowsVert.size() > 1) {
+
+		vertDialed += dialedRow(m_rowsVert, s.measuredDist) - dialedRow(m_rowsVert, dist);
+		horizDialed += dialedRow(m_rowsHoriz, s.measuredDist) - dialedRow(m_rowsHoriz, dist);
+	}
+
+	return {(vertDialed - vertNeeded + s.vertNoise) * smPerMrad, (horizDialed - horizNeeded + s.horizNoise) * smPerMrad};
+}
+
+void s2::dispersionsolver::solveSamples(size_t first, size_t count, SolverContext* const ctxs[]) {
+
+	sample samples[LOCKSTEP_MAX_LANES];
+	SolverRequest requests[LOCKSTEP_MAX_LANES]{};
+
+	const Options options = sampleOptions(false);
+
+	for(size_t l = 0; l < count; l++) {
+
+		perturb(first + l, samples[l]);
+		requests[l] = {&samples[l].meteo, &samples[l].bullet, &m_rifle, &m_scope, &m_inputs, &options, &samples[l].results};
+	}
+
+	trajectorySolverLockstep(ctxs, requests, count);
+
+	for(size_t l = 0; l < count; l++) {
+		m_impacts[first + l] = impact(samples[l], *ctxs[l]);
+	}
+}
+
+void s2::dispersionsolver::serializeResults(std::string& workBuffer) const {
+
+	const size_t n = m_impacts.size();
+
+	double vertMean = 0, horizMean = 0;
+
+	for(const auto& p : m_impacts) {
+
+		vertMean += p.vert;
+		horizMean += p.horiz;
+	}
+
+	vertMean /= n;
+	horizMean /= n;
+
+	double vertVar = 0, horizVar = 0, cov = 0;
+	size_t hits = 0;
+	std::vector<double> radii;
+	radii.reserve(n);
+
+	const double halfWidth = m_spread.targetWidth / 2;
+	const double halfHeight = m_spread.targetHeight / 2;
+	const double radius = m_spread.targetDiameter / 2;
+
+	for(const auto& p : m_impacts) {
+
+		vertVar += (p.vert - vertMean) * (p.vert - vertMean);
+		horizVar += (p.horiz - horizMean) * (p.horiz - horizMean);
+		cov += (p.vert - vertMean) * (p.horiz - horizMean);
+
+		const double r = sqrt(p.vert * p.vert + p.horiz * p.horiz);
+		radii.push_back(r);
+
+		if(radius > 0 ? r <= radius : (fabs(p.horiz) <= halfWidth && fabs(p.vert) <= halfHeight)) {
+			hits++;
+		}
+	}
+
+	const double vertSd = n > 1 ? sqrt(vertVar / (n - 1)) : 0;
+	const double horizSd = n > 1 ? sqrt(horizVar / (n - 1)) : 0;
+	const double corr = vertVar > 0 && horizVar > 0 ? cov / sqrt(vertVar * horizVar) : 0;
+
+	auto percentile = [&radii, n](double p) {
+
+		auto it = radii.begin() + std::min((size_t)(p * n), n - 1);
+		std::nth_element(radii.begin(), it, radii.end());
+		return *it;
+	};
+
+	nlohmann::json dispersionJson;
+	dispersionJson["samples"] = n;
+	dispersionJson["vert."] = {vertMean, vertSd};
+	dispersionJson["horiz."] = {horizMean, horizSd};
+	dispersionJson["corr"] = corr;
+	dispersionJson["radius"] = {percentile(0.5), percentile(0.9)};
+
+	if(radius > 0 || (halfWidth > 0 && halfHeight > 0)) {
+		dispersionJson["hit.prob"] = (double)hits / n;
+	}
+
+	if(m_spread.points) {
+
+		std::vector<float> verticals, horizontals;
+		verticals.reserve(n);
+		horizontals.reserve(n);
+
+		for(const auto& p : m_impacts) {
+
+			verticals.push_back(p.vert);
+			horizontals.push_back(p.horiz);
+		}
+
+		dispersionJson["points"]["vert."] = verticals;
+		dispersionJson["points"]["horiz."] = horizontals;
+	}
+
+	nlohmann::json responceJson;
+	responceJson["Version"] = m_dp.getVersion();
+	responceJson["Token"] = m_dp.token();
+	responceJson["Dispersion"] = dispersionJson;
+
+	workBuffer.reserve(BALLISTIX_WORKING_BUFFER_SIZE);
+	workBuffer = responceJson.dump(4);
+}
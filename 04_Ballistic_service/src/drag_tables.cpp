@@ -0,0 +1,76 @@
+#include "drag_tables.h"
+#include "trajectory_solver_routines.h"
+
+#include <array>
+
+#ifndef SLOW_DEVICE
+
+/* Same coefficients as DragCoefficient(), Horner form (pow() is not constexpr) */
+
+static constexpr double G7Precise (double M) {
+
+	if (M<=0.749) {return 0.0012*M+0.1192;}
+	else if (M<=0.949) {return (((114.6667*M-369.2162)*M+446.1956)*M-239.7609)*M+48.4391;}
+	else if (M<=0.9749) {return (43.6*M-80.174)*M+37.0217;}
+	else if (M<=1.049) {return ((441.6*M-1372.64)*M+1422.248)*M-490.8277;}
+	else if (M<=2.049) {return ((((0.1185*M-1.1073)*M+4.0521)*M-7.1962)*M+6.05)*M-1.5097;}
+	else if (M<=4.0) {return -0.0547*M+0.4064;}
+
+	return 0.0;
+}
+
+static constexpr double G1Precise (double M) {
+
+	if (M<=0.499) {return (0.0852*M-0.1657)*M+0.2637;}
+	else if (M<=0.999) {return (((((-89.1534*M+370.3571)*M-630.2645)*M+564.7044)*M-281.0384)*M+73.5809)*M-7.705;}
+	else if (M<=1.499) {return (((-3.8058*M+21.5685)*M-46.2897)*M+44.5479)*M-15.54;}
+	else if (M<=2.499) {return ((0.067212*M-0.38359)*M+0.593708)*M+0.403095;}
+	else if (M<=4.0) {return (0.0459*M-0.3051)*M+1.0156;}
+
+	return 0.0;
+}
+
+static constexpr double GsLinear (double M) {
+
+	if (M<=0.55) {return 0.0551*M+0.4662;}
+	else if (M<=1.15) {return 0.7301*M+0.0819;}
+	else if (M<=1.3) {return 0.522*M+0.3184;}
+	else if (M<=1.6) {return 0.0564*M+0.92175;}
+
+	return -0.03698*M+1.07324;
+}
+
+typedef std::array<double, DRAG_TABLE_SIZE> dragTable;
+
+template<double (*dragFunction)(double)>
+static constexpr dragTable generateDragTable () {
+
+	dragTable table{};
+
+	for (int i = 0; i < DRAG_TABLE_SIZE; i++) {
+		table[i] = dragFunction(i / (1.0 / DRAG_TABLE_STEP));
+	}
+
+	return table;
+}
+
+static constexpr dragTable G7Table = generateDragTable<G7Precise>();
+static constexpr dragTable G1Table = generateDragTable<G1Precise>();
+static constexpr dragTable GsTable = generateDragTable<GsLinear>();
+
+#endif /* SLOW_DEVICE */
+
+const double* dragTableFor (uint8_t DragFunction) {
+
+#ifndef SLOW_DEVICE
+	if (DragFunction == G7) {return G7Table.data();}
+	else if (DragFunction == G1) {return G1Table.data();}
+	else if (DragFunction == Gs) {return GsTable.data();}
+#endif
+	return nullptr;
+}
+
+double DragCoefficientTabled (uint8_t DragFunction, double M) {
+
+	return DragCoefficientFromTable (dragTableFor (DragFunction), DragFunction, M);
+}
@@ -0,0 +1,234 @@
+#include "inverse_solver.h"
+#include "trajectory_solver_routines.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+bool s2::isInverseRequest(const nlohmann::json& bodyJson) {
+
+	return bodyJson.is_object() && bodyJson.contains("Inverse") && bodyJson["Inverse"].is_array();
+}
+
+s2::inversesolver::inversesolver(const nlohmann::json& bodyJson) {
+
+	m_dp.getToken(bodyJson);
+
+	m_bullet = m_dp.parseForBulletData(bodyJson);
+	m_rifle = m_dp.parseForRifleData(bodyJson);
+	m_scope = m_dp.parseForScopeData(bodyJson);
+	m_meteo = m_dp.parseForMeteoData(bodyJson);
+	m_options = m_dp.parseForOptions(bodyJson);
+	m_inputs = m_dp.parseForInputs(bodyJson);
+
+	m_queries = bodyJson["Inverse"];
+}
+
+void s2::inversesolver::solve(SolverContext& ctx) {
+
+	/* One solve with 1 m range-card rows over the whole range, every query is answered from them */
+
+	Options options = m_options;
+
+	options.BallisticTable = OPTION_YES;
+	options.TableStep = 1;
+	options.RangecardFrom = 1;
+	options.RangecardTo = 0;
+	options.EarlyExit = OPTION_YES;
+	options.MachDistances = OPTION_NO;
+
+	const uint16_t range = solverRange(&options);
+	m_inputs.shotDistance = std::min(m_inputs.shotDistance, range);
+
+	Results results;
+	trajectorySolver(&ctx, &m_meteo, &m_bullet, &m_rifle, &m_scope, &m_inputs, &options, OUT &results);
+
+	const uint16_t lastIndex = rangecardLastIndex(&options);
+	const int units = m_scope.angleUnits == MRAD_UNITS ? 1 : 0;
+	const double tanThrow = tan(ctx.throwAngle);
+
+	m_corrections.assign(lastIndex + 1, 0.0);
+	m_heights.assign(lastIndex + 1, -m_rifle.scopeHight);
+
+	for(uint16_t i = 1; i <= lastIndex; i++) {
+
+		const solverUnit& row = ctx.solver[i];
+
+		/* Only Yrz is the magnitude of the drop (see absoluteDropToZeroing()), its sign is the side 
+		of the line of sight the bullet is on. The terrain angle and aerojump terms added to it 
+		in Yrt keep their sign whatever the side, flipping them too would break the rows at 
+		every crossing */
+		const bool above = row.Yabs - row.Dst_f * tanThrow > 0;
+		const double drop = (above ? -row.Yrz : row.Yrz) + (row.Yrt - row.Yrz);
+		const double dropMOA = convertSmToMOA(drop, row.Dist);
+		const double drift = results.table.Vert[i][units] - (units ? row.Yrt_mrad : row.Yrt_moa);
+
+		m_corrections[i] = (units ? convertMOAToMRAD(dropMOA) : dropMOA) + drift;
+		m_heights[i] = -drop;
+	}
+
+	m_answers = nlohmann::json::array();
+
+	for(const auto& query : m_queries) {
+		m_answers.push_back(answer(query));
+	}
+}
+
+std::vector<double> s2::inversesolver::crossings(const std::vector<double>& rows, size_t first, double value) const {
+
+	std::vector<double> dists;
+
+	for(size_t i = first; i + 1 < rows.size(); i++) {
+
+		const double a = rows[i];
+		const double b = rows[i + 1];
+
+		if((a < value) != (b < value)) {
+			dists.push_back(i + (value - a) / (b - a));
+		}
+	}
+
+	return dists;
+}
+
+double s2::inversesolver::interpolate(const std::vector<double>& rows, double dist) const {
+
+	double x = std::min(std::max(dist, 0.0), (double)(rows.size() - 1));
+	size_t i = std::min((size_t)x, rows.size() - 2);
+
+	return rows[i] + (rows[i + 1] - rows[i]) * (x - i);
+}
+
+double s2::inversesolver::smPerUnit(double dist) const {
+
+	return m_scope.angleUnits == MRAD_UNITS ? dist / 10.0 : (dist / 100.0) * MOA_;
+}
+
+nlohmann::json s2::inversesolver::pointBlank(double target, double slope) const {
+
+	/* Heights with the bore tilted by slope (sm per meter), the first stretch within the band */
+
+	const double half = target / 2;
+	auto height = [this, slope](size_t i) { return m_heights[i] + slope * i; };
+	auto inside = [half](double h) { return fabs(h) <= half; };
+
+	nlohmann::json pbrJson = nlohmann::json::object();
+
+	size_t i = 0;
+
+	while(i < m_heights.size() && !inside(height(i))) {
+		i++;
+	}
+
+	if(i == m_heights.size()) {
+		return pbrJson;
+	}
+
+	double near = i;
+
+	if(i > 0) {
+
+		const double a = height(i - 1);
+		const double edge = a < 0 ? -half : half;
+		near = (i - 1) + (edge - a) / (height(i) - a);
+	}
+
+	double far = m_heights.size() - 1;
+	double zero = -1;
+	size_t peak = i;
+
+	for(; i < m_heights.size(); i++) {
+
+		const double h = height(i);
+
+		if(!inside(h)) {
+
+			const double a = height(i - 1);
+			const double edge = h < 0 ? -half : half;
+			far = (i - 1) + (edge - a) / (h - a);
+			break;
+		}
+
+		if(h > height(peak)) {
+			peak = i;
+		}
+
+		if(i > 0 && height(i - 1) > 0 && h <= 0) {
+			zero = (i - 1) + height(i - 1) / (height(i - 1) - h);
+		}
+	}
+
+	pbrJson["near"] = near;
+	pbrJson["far"] = far;
+	pbrJson["peak"] = peak;
+
+	if(zero >= 0) {
+		pbrJson["zero"] = zero;
+	}
+
+	return pbrJson;
+}
+
+nlohmann::json s2::inversesolver::answer(const nlohmann::json& query) const {
+
+	nlohmann::json answerJson = query;
+
+	if(query.contains("mpbr")) {
+
+		const double target = query["mpbr"].get<double>();
+		const double half = target / 2;
+
+		/* The best zero lifts the trajectory until its top touches the upper edge */
+		double slope = std::numeric_limits<double>::max();
+
+		for(size_t i = 1; i < m_heights.size(); i++) {
+			slope = std::min(slope, (half - m_heights[i]) / i);
+		}
+
+		auto current = pointBlank(target, 0);
+		answerJson.update(current);
+		answerJson["opt."] = pointBlank(target, slope);
+
+		return answerJson;
+	}
+
+	if(query.contains("drop")) {
+
+		answerJson["dist."] = crossings(m_heights, 0, -query["drop"].get<double>());
+		return answerJson;
+	}
+
+	double vert = 0;
+
+	if(query.contains("clicks")) {
+		vert = query["clicks"].get<double>() * m_scope.clickVert;
+	}
+	else if(query.contains("vert.")) {
+		vert = query["vert."].get<double>();
+	}
+
+	if(query.contains("dist.")) {
+
+		const double dist = query["dist."].get<double>();
+
+		if(dist >= 1 && dist <= m_corrections.size() - 1) {
+			answerJson["impact"] = (vert - interpolate(m_corrections, dist)) * smPerUnit(dist);
+		}
+
+		return answerJson;
+	}
+
+	answerJson["dist."] = crossings(m_corrections, 1, vert);
+	return answerJson;
+}
+
+void s2::inversesolver::serializeResults(std::string& workBuffer) const {
+
+	nlohmann::json responceJson;
+	responceJson["Version"] = m_dp.getVersion();
+	responceJson["Token"] = m_dp.token();
+	responceJson["Inverse"] = m_answers;
+
+	workBuffer.reserve(BALLISTIX_WORKING_BUFFER_SIZE);
+	workBuffer = responceJson.dump(4);
+}
@@ -1,21 +1,21 @@
 #include "json_working_stuff.h"
+#include "profile_registry.h"
 #include "CFastLog.h"
 
+#include <algorithm>
 #include <map>
 #include <cstring>
 #include <iostream>
+#include <stdexcept>
 
-static CDMDataArray CDMArray{};
-static MBCDataArray MBCArray{};
-
-Bullet s2::datapreparator::parseForBulletData(const nlohmann::json& bodyJson) const {
+Bullet s2::datapreparator::parseForBulletData(const nlohmann::json& bodyJson) {
 
 	/* Parse for bullet data: 
 	"Bullet":{"DF":"G7","BC":0.247,"CDM":[{"0.5":0.156},{"0.6":0.456} ...],"V0":740,"lenght":33.15,
 	"weight":185,"diam.":7.82,"CCF_0.9":1.015,"CCF_1.0":1.012,"CCF_1.1":1.017,"V0temp":22.5,"therm":1.6} 
 	*/
 
-	const std::map<std::string, dragModels> DFStringToEnum {
+	static const std::map<std::string, dragModels> DFStringToEnum {
 		{"\"G1\"", G1},
 		{"\"G7\"", G7},
 		{"\"Gs\"", Gs},
@@ -44,13 +44,13 @@ Bullet s2::datapreparator::parseForBulletData(const nlohmann::json& bodyJson) co
 			auto Mach = 0.5 + i * 0.1;
 			auto Cd = cdPair.get<double>();
 
-			CDMArray[i].MachNumber = Mach;
-			CDMArray[i].CD = Cd;
+			m_CDMArray[i].MachNumber = Mach;
+			m_CDMArray[i].CD = Cd;
 
 			i++;
 		}
 
-		return Bullet{"*", (uint8_t)DF, BC, CCF_09, CCF_10, CCF_11, V0, lenght, weight, dia, V0temp, therm, &CDMArray, USELESS_COMPLEX_DATA};
+		return Bullet{"*", (uint8_t)DF, BC, CCF_09, CCF_10, CCF_11, V0, lenght, weight, dia, V0temp, therm, &m_CDMArray, USELESS_COMPLEX_DATA};
 	}
 	else if(DF == MBCG1 || DF == MBCG7) {
 
@@ -61,13 +61,13 @@ Bullet s2::datapreparator::parseForBulletData(const nlohmann::json& bodyJson) co
 			auto Mach = 0.5 + i * 0.1;
 			auto BCi = bcPair.get<double>();
 
-			MBCArray[i].MachNumber = Mach;
-			MBCArray[i].BC = BCi;
+			m_MBCArray[i].MachNumber = Mach;
+			m_MBCArray[i].BC = BCi;
 
 			i++;
 		}
 
-		return Bullet{"*", (uint8_t)DF, BC, CCF_09, CCF_10, CCF_11, V0, lenght, weight, dia, V0temp, therm, USELESS_COMPLEX_DATA, &MBCArray};
+		return Bullet{"*", (uint8_t)DF, BC, CCF_09, CCF_10, CCF_11, V0, lenght, weight, dia, V0temp, therm, USELESS_COMPLEX_DATA, &m_MBCArray};
 	}
 	else {
 
@@ -135,7 +135,17 @@ Scope s2::datapreparator::parseForScopeData(const nlohmann::json& bodyJson) {
 Options s2::datapreparator::parseForOptions(const nlohmann::json& bodyJson) {
 
 	/* Parse for options data:
-	"Options": {"koriolis": true,"rangecard": false,"therm.corr": false,"aerojump": true}
+	"Options": {"koriolis": true,"rangecard": false,"therm.corr": false,"aerojump": true,"integrator": "adaptive"}
+	"integrator" is optional: "fixed" (default) or "adaptive"
+	
+	Optional as well:
+	"early.exit": true - integrate only up to the shot, zero and range-card distances (default false, whole range)
+	"mach.dists": true - with early exit also find Mach-threshold distances (default false, they are not replied then)
+	"rangecard.from": 100, "rangecard.to": 800 - range-card window in meters (default whole table)
+	"range": 300, "table.step": 10 - maximum distance and range-card step in meters (default 4000 and 25, range up to 10000)
+	"precision": "float" - float32 fixed-step integration for devices without a double FPU (no faster elsewhere), "double" (default) is the reference
+	"wind.interp": true - complex wind changes linearly between the windage distances (default false, in steps)
+	"sens.": true - also the derivatives of the shot by V0, BC, crosswind and distance (default false, see trajectory_sensitivity.h)
 	*/
 
 	auto koriolis = bodyJson["Options"]["koriolis"].get<bool>() ? OPTION_YES : OPTION_NO;
@@ -145,15 +155,46 @@ Options s2::datapreparator::parseForOptions(const nlohmann::json& bodyJson) {
 	auto thermal = bodyJson["Options"]["therm.corr"].get<bool>() ? OPTION_YES : OPTION_NO;
 	auto aerojump = bodyJson["Options"]["aerojump"].get<bool>() ? OPTION_YES : OPTION_NO;
 
-	return Options{(uint8_t)koriolis, (uint8_t)rangecard, (uint8_t)thermal, (uint8_t)aerojump};
+	auto integrator = FIXED_STEP;
+
+	if(bodyJson["Options"].contains("integrator")) {
+		integrator = bodyJson["Options"]["integrator"].get<std::string>() == "adaptive" ? ADAPTIVE_STEP : FIXED_STEP;
+	}
+
+	const auto& optionsJson = bodyJson["Options"];
+
+	auto earlyExit = optionsJson.contains("early.exit") && optionsJson["early.exit"].get<bool>() ? OPTION_YES : OPTION_NO;
+	auto machDists = optionsJson.contains("mach.dists") && optionsJson["mach.dists"].get<bool>() ? OPTION_YES : OPTION_NO;
+	auto rangecardFrom = optionsJson.contains("rangecard.from") ? optionsJson["rangecard.from"].get<uint16_t>() : 0;
+	auto rangecardTo = optionsJson.contains("rangecard.to") ? optionsJson["rangecard.to"].get<uint16_t>() : 0;
+	auto range = optionsJson.contains("range") ? optionsJson["range"].get<uint16_t>() : 0;
+	auto tableStep = optionsJson.contains("table.step") ? optionsJson["table.step"].get<uint16_t>() : 0;
+	auto precision = optionsJson.contains("precision") && optionsJson["precision"].get<std::string>() == "float" ? 
+		PRECISION_FLOAT : PRECISION_DOUBLE;
+	auto windInterp = optionsJson.contains("wind.interp") && optionsJson["wind.interp"].get<bool>() ? OPTION_YES : OPTION_NO;
+	auto sensitivities = optionsJson.contains("sens.") && optionsJson["sens."].get<bool>() ? OPTION_YES : OPTION_NO;
+
+	Options options{(uint8_t)koriolis, (uint8_t)rangecard, (uint8_t)thermal, (uint8_t)aerojump, (uint8_t)integrator, 
+		(uint8_t)earlyExit, (uint8_t)machDists, (uint16_t)rangecardFrom, (uint16_t)rangecardTo, (uint16_t)range, (uint16_t)tableStep, 
+		(uint8_t)precision, (uint8_t)windInterp, (uint8_t)sensitivities};
+
+	m_sensitivities = (sensitivities == OPTION_YES);
+
+	m_machDistances = (earlyExit == OPTION_NO || machDists == OPTION_YES);
+	m_rangecardFirst = rangecardFirstIndex(&options);
+	m_rangecardLast = rangecardLastIndex(&options);
+
+	return options;
 }
 
 Inputs s2::datapreparator::parseForInputs(const nlohmann::json& bodyJson) const {
 	
 	/* Parse for input data:
-	"Inputs": {"dist.": 1000,"terrain_angle": 0,"target_azimuth": -15,"latitude": 54,"targ.speed": 2.3} */
+	"Inputs": {"dist.": 1000,"terrain_angle": 0,"target_azimuth": -15,"latitude": 54,"targ.speed": 2.3} 
+	"dist.": [812, 815, 1020] - several distances, see solveDistances() */
 
-	auto dist = bodyJson["Inputs"]["dist."].get<uint16_t>();
+	const auto& distJson = bodyJson["Inputs"]["dist."];
+	auto dist = distJson.is_array() ? (uint16_t)0 : distJson.get<uint16_t>();
 	auto terrain_angle = bodyJson["Inputs"]["terrain_angle"].get<uint8_t>();
 	auto target_azimuth = bodyJson["Inputs"]["target_azimuth"].get<int16_t>();
 	auto latitude = bodyJson["Inputs"]["latitude"].get<double>();
@@ -162,9 +203,53 @@ Inputs s2::datapreparator::parseForInputs(const nlohmann::json& bodyJson) const
 	return Inputs{dist, terrain_angle, targSpeed, target_azimuth, latitude, 0}; //No magnetic inclination
 }
 
+bool s2::datapreparator::parseForProfile(const nlohmann::json& bodyJson, const profile* registered, 
+	Bullet& OUT bullet, Rifle& OUT rifle, Scope& OUT scope) {
+
+	/* A registered profile is parsed and checked already, its CDM / MBC tables stay in it. 
+	A section neither of them has is left as it is */
+
+	bool complete = true;
+
+	if(bodyJson.contains("Bullet")) {
+		bullet = parseForBulletData(bodyJson);
+	}
+	else if(registered && registered->hasBullet) {
+		bullet = registered->bullet;
+	}
+	else {
+		complete = false;
+	}
+
+	if(bodyJson.contains("Rifle")) {
+		rifle = parseForRifleData(bodyJson);
+	}
+	else if(registered && registered->hasRifle) {
+		rifle = registered->rifle;
+	}
+	else {
+		complete = false;
+	}
+
+	if(bodyJson.contains("Scope")) {
+		scope = parseForScopeData(bodyJson);
+	}
+	else if(registered && registered->hasScope) {
+
+		scope = registered->scope;
+		m_unitsIsMrads = (scope.angleUnits == MRAD_UNITS);
+	}
+	else {
+		complete = false;
+	}
+
+	return complete;
+}
+
 Meteo s2::datapreparator::parseForMeteoData(const nlohmann::json& bodyJson) {
 
-	/* Parse for meteo data "Meteo": {"temp.":15,"press.":1000,"humid.":50} */
+	/* Parse for meteo data "Meteo": {"temp.":15,"press.":1000,"humid.":50} 
+	"wind": "complex" takes every "windage" entry (sorted by "dist.", up to MAX_WIND_SEGMENTS) */
 
 	auto temp = bodyJson["Meteo"]["temp."].get<int8_t>();
 	auto press = bodyJson["Meteo"]["press."].get<uint16_t>();
@@ -183,12 +268,17 @@ Meteo s2::datapreparator::parseForMeteoData(const nlohmann::json& bodyJson) {
 
 		memset(m_windArray, 0, sizeof(windDataArray));
 
-		for(auto i = 0; i < WIND_GRANULARITY; ++i) {
+		const auto& windageJson = bodyJson["Meteo"]["windage"];
+		const auto segments = std::max<size_t>(1, std::min<size_t>(windageJson.size(), MAX_WIND_SEGMENTS));
 
-			auto windDist = bodyJson["Meteo"]["windage"][i]["dist."].get<uint16_t>();
-			auto windSpeed = bodyJson["Meteo"]["windage"][i]["speed"].get<double>();
-			auto windDir = bodyJson["Meteo"]["windage"][i]["dir."].get<uint16_t>();
-			auto windIncl = bodyJson["Meteo"]["windage"][i]["incl."].get<double>();
+		for(size_t i = 0; i < segments; ++i) {
+
+			const auto& segmentJson = windageJson.at(i);
+
+			auto windDist = segmentJson["dist."].get<uint16_t>();
+			auto windSpeed = segmentJson["speed"].get<double>();
+			auto windDir = segmentJson["dir."].get<uint16_t>();
+			auto windIncl = segmentJson["incl."].get<double>();
 
 			m_windArray[i].currentDistance = windDist;
 			m_windArray[i].windSpeed = windSpeed;
@@ -196,7 +286,7 @@ Meteo s2::datapreparator::parseForMeteoData(const nlohmann::json& bodyJson) {
 			m_windArray[i].terrainDir = windIncl;
 		}
 
-		return Meteo{temp, press, humid, USELESS_DATA, USELESS_DATA, USELESS_DATA, (int8_t)windType, &m_windArray};
+		return Meteo{temp, press, humid, USELESS_DATA, USELESS_DATA, USELESS_DATA, (int8_t)windType, &m_windArray, (uint8_t)segments};
 	}
 }
 
@@ -228,40 +318,84 @@ void s2::datapreparator::serializeResult(const Results& results, std::string& wo
 	nlohmann::json responceJson;
 	responceJson["Version"] = version;
 	responceJson["Token"] = m_token;
-	
-	responceJson["Result"]["vert."] = {results.vertSm, results.vertAngleUnits, results.vertClicks};
-	responceJson["Result"]["vert.abs"] = results.vertSmABS;
-	responceJson["Result"]["horiz."] = {results.horizSm, results.horizAngleUnits, results.horizClicks};
-	responceJson["Result"]["deriv."] = {results.derivSm, results.derivAngleUnits, results.derivClicks};
-	responceJson["Result"]["time"] = results.flightTime;
-	responceJson["Result"]["Mach"] = results.MachNumber;
-	responceJson["Result"]["FGS"] = results.FGS;
-	responceJson["Result"]["A0"] = results.A0;
-	responceJson["Result"]["trg.move"] = results.targetAdvance;
-	responceJson["Result"]["cinetic"] = results.cineticEnergy;	
-	responceJson["Result"]["transsonic"] = results.transsonicDist;
-	responceJson["Result"]["supersonic"] = results.subsonicDist;
-	responceJson["Result"]["subsonic"] = results.deepSubsonic;
-    responceJson["Result"]["subsonic0.7M"] = results.deepSubsonic_0_7M;
-	responceJson["Result"]["transsonic2.2M"] = results.deeptranssonic_2_2M;
-	responceJson["Result"]["transsonic2.0M"] = results.deeptranssonic_2_0M;
-	responceJson["Result"]["transsonic1.8M"] = results.deeptranssonic_1_8M;
-	responceJson["Result"]["transsonic1.6M"] = results.deeptranssonic_1_6M;
-	responceJson["Result"]["transsonic1.4M"] = results.deeptranssonic_1_4M;
-	responceJson["Result"]["transsonic1.2M"] = results.deeptranssonic_1_2M;
-
-	if(m_makeRangecard) {
+	responceJson["Result"] = resultToJson(results);
+
+	workBuffer = responceJson.dump(4);
+}
+
+nlohmann::json s2::datapreparator::resultToJson(const Results& results) {
+
+	nlohmann::json resultJson;
+
+	resultJson["vert."] = {results.vertSm, results.vertAngleUnits, results.vertClicks};
+	resultJson["vert.abs"] = results.vertSmABS;
+	resultJson["horiz."] = {results.horizSm, results.horizAngleUnits, results.horizClicks};
+	resultJson["deriv."] = {results.derivSm, results.derivAngleUnits, results.derivClicks};
+	resultJson["time"] = results.flightTime;
+	resultJson["Mach"] = results.MachNumber;
+	resultJson["FGS"] = results.FGS;
+	resultJson["A0"] = results.A0;
+	resultJson["trg.move"] = results.targetAdvance;
+	resultJson["cinetic"] = results.cineticEnergy;	
+
+	if(m_machDistances) {
+		addMachDistances(results, resultJson);
+	}
+
+	if(m_sensitivities) {
+		addSensitivities(results, resultJson);
+	}
+
+	if(m_makeRangecard && results.table.Vert) {
 
 		prepareRangecardData(results);
 
-		responceJson["Result"]["rangecard"]["dist."] = m_distances;
-		responceJson["Result"]["rangecard"]["vert."] = m_verticals;
-		responceJson["Result"]["rangecard"]["horiz."] = m_horizontals;
-		responceJson["Result"]["rangecard"]["deriv."] = m_derivations;
-		responceJson["Result"]["rangecard"]["time"] = m_times;
+		resultJson["rangecard"]["dist."] = m_distances;
+		resultJson["rangecard"]["vert."] = m_verticals;
+		resultJson["rangecard"]["horiz."] = m_horizontals;
+		resultJson["rangecard"]["deriv."] = m_derivations;
+		resultJson["rangecard"]["time"] = m_times;
 	}
 
-	workBuffer = responceJson.dump(4);
+	return resultJson;
+}
+
+void s2::datapreparator::addSensitivities(const Results& results, nlohmann::json& resultJson) const {
+
+	/* "sens.": {"vert.": {"V0": ..., "BC%": ..., "wind": ..., "dist.": ...}, "horiz.": {...}, "deriv.": {...}, "time": {...}} 
+	per m/s of V0, per 1% of BC, per m/s of crosswind from 90 degrees and per meter */
+
+	static const char* const inputNames[SENS_INPUTS] = {"V0", "BC%", "wind", "dist."};
+
+	auto byInputs = [](const double values[SENS_INPUTS]) {
+
+		nlohmann::json valuesJson;
+
+		for(int k = 0; k < SENS_INPUTS; k++) {
+			valuesJson[inputNames[k]] = values[k];
+		}
+
+		return valuesJson;
+	};
+
+	resultJson["sens."]["vert."] = byInputs(results.sens.vertAngleUnits);
+	resultJson["sens."]["horiz."] = byInputs(results.sens.horizAngleUnits);
+	resultJson["sens."]["deriv."] = byInputs(results.sens.derivAngleUnits);
+	resultJson["sens."]["time"] = byInputs(results.sens.flightTime);
+}
+
+void s2::datapreparator::addMachDistances(const Results& results, nlohmann::json& resultJson) const {
+
+	resultJson["transsonic"] = results.transsonicDist;
+	resultJson["supersonic"] = results.subsonicDist;
+	resultJson["subsonic"] = results.deepSubsonic;
+    resultJson["subsonic0.7M"] = results.deepSubsonic_0_7M;
+	resultJson["transsonic2.2M"] = results.deeptranssonic_2_2M;
+	resultJson["transsonic2.0M"] = results.deeptranssonic_2_0M;
+	resultJson["transsonic1.8M"] = results.deeptranssonic_1_8M;
+	resultJson["transsonic1.6M"] = results.deeptranssonic_1_6M;
+	resultJson["transsonic1.4M"] = results.deeptranssonic_1_4M;
+	resultJson["transsonic1.2M"] = results.deeptranssonic_1_2M;
 }
 
 void s2::datapreparator::prepareRangecardData(const Results& results) {
@@ -272,15 +406,17 @@ void s2::datapreparator::prepareRangecardData(const Results& results) {
 	m_derivations.clear();
 	m_times.clear();
 
-	m_distances.reserve(BALLISTIC_TABLE_SIZE + 1);
-	m_verticals.reserve(BALLISTIC_TABLE_SIZE + 1);
-	m_horizontals.reserve(BALLISTIC_TABLE_SIZE + 1);
-	m_derivations.reserve(BALLISTIC_TABLE_SIZE + 1);
-	m_times.reserve(BALLISTIC_TABLE_SIZE + 1);
+	const size_t rows = results.table.size + 1;
+
+	m_distances.reserve(rows);
+	m_verticals.reserve(rows);
+	m_horizontals.reserve(rows);
+	m_derivations.reserve(rows);
+	m_times.reserve(rows);
 
-	for(int i = 1; i < BALLISTIC_TABLE_SIZE + 1; i++) {
+	for(int i = (m_rangecardFirst > 1 ? m_rangecardFirst : 1); i <= m_rangecardLast; i++) {
 
-		m_distances.push_back(i * TABLE_STEP);
+		m_distances.push_back(i * results.table.step);
 		m_verticals.push_back(results.table.Vert[i][m_unitsIsMrads]);
 		m_horizontals.push_back(results.table.Horiz[i][m_unitsIsMrads]);
 		m_derivations.push_back(results.table.Deriv[i][m_unitsIsMrads]);
@@ -293,32 +429,90 @@ void s2::datapreparator::getToken(const nlohmann::json& bodyJson) {
 	m_token = bodyJson["Token"].get<std::string>();
 }
 
-void s2::solveBallistics(const std::string& inputJson, std::string& workBuffer) {
+const char* s2::datapreparator::getVersion() const {
 
-	LOG_INFO(fastlog::LogEventType::System) << "Приняты входные данные: " << inputJson;
+	return version;
+}
 
-	workBuffer.reserve(BALLISTIX_WORKING_BUFFER_SIZE);
+const std::string& s2::datapreparator::token() const {
+
+	return m_token;
+}
+
+void s2::solveBallistics(const std::string& inputJson, std::string& workBuffer, SolverContext& ctx) {
+
+	LOG_INFO(fastlog::LogEventType::System) << "Приняты входные данные: " << inputJson;
 
 	try {
 		
 		auto bodyJson = nlohmann::json::parse(inputJson);
+		s2::solveBallistics(bodyJson, workBuffer, ctx);
+	}
+	catch(...) {
+
+		workBuffer = "{}";
+		LOG_INFO(fastlog::LogEventType::System) << "Данные не обработаны";
+	}
+}
+
+void s2::solveBallistics(const nlohmann::json& bodyJson, std::string& workBuffer, SolverContext& ctx, resultcache* cache, 
+	const profile* registered) {
+
+	workBuffer.reserve(BALLISTIX_WORKING_BUFFER_SIZE);
+
+	try {
 
 		s2::datapreparator dp;
 
 		dp.getToken(bodyJson);
 
-		auto bullet = dp.parseForBulletData(bodyJson);
-		auto rifle = dp.parseForRifleData(bodyJson);
-		auto scope = dp.parseForScopeData(bodyJson);
+		Bullet bullet;
+		Rifle rifle;
+		Scope scope;
+
+		if(!dp.parseForProfile(bodyJson, registered, OUT bullet, OUT rifle, OUT scope)) {
+			throw std::invalid_argument("no Bullet, Rifle or Scope");
+		}
+
 		auto meteo = dp.parseForMeteoData(bodyJson);
 		auto options = dp.parseForOptions(bodyJson);
 		auto inputs = dp.parseForInputs(bodyJson);
 
+		std::string key;
+
+		if(cache) {
+
+			/* Solve the quantized meteo, so the reply doesn't depend on which request filled the cache */
+			cache->quantize(meteo);
+			key = cache->makeKey(meteo, bullet, rifle, scope, inputs, options);
+
+			cachedReply cached;
+
+			if(cache->find(key, cached)) {
+
+				resultcache::joinReply(cached, dp.token(), workBuffer);
+
+				LOG_INFO(fastlog::LogEventType::System) << "Результат из кэша: " << workBuffer;
+				return;
+			}
+		}
+
 		Results results;
-		trajectorySolver(&meteo, &bullet, &rifle, &scope, &inputs, &options, OUT &results);
+		trajectorySolver(&ctx, &meteo, &bullet, &rifle, &scope, &inputs, &options, OUT &results);
 
 		dp.serializeResult(results, workBuffer);
 
+		if(cache) {
+
+			cachedReply cached;
+
+			if(resultcache::splitReply(workBuffer, dp.token(), cached)) {
+
+				const auto bytes = key.size() + cached.head.size() + cached.tail.size();
+				cache->insert(key, cached, bytes);
+			}
+		}
+
 		LOG_INFO(fastlog::LogEventType::System) << "Результат вычислений: " << workBuffer;
 		return;
 	}
@@ -328,4 +522,222 @@ void s2::solveBallistics(const std::string& inputJson, std::string& workBuffer)
 		LOG_INFO(fastlog::LogEventType::System) << "Данные не обработаны";
 		return;
 	}	
+}
+
+bool s2::isMultiDistanceRequest(const nlohmann::json& bodyJson) {
+
+	return bodyJson.is_object() && bodyJson.contains("Inputs") && bodyJson["Inputs"].is_object() && 
+		bodyJson["Inputs"].contains("dist.") && bodyJson["Inputs"]["dist."].is_array();
+}
+
+void s2::solveDistances(const nlohmann::json& bodyJson, std::string& workBuffer, SolverContext& ctx, const profile* registered) {
+
+	/* {"Version": "...", "Token": "...", "Results": [{"dist.": 812, <Result at 812>}, ...]} in the order of "dist.", 
+	the range card (Options.rangecard) is in the Result of the farthest distance */
+
+	workBuffer.reserve(BALLISTIX_WORKING_BUFFER_SIZE);
+
+	try {
+
+		s2::datapreparator dp;
+
+		dp.getToken(bodyJson);
+
+		Bullet bullet;
+		Rifle rifle;
+		Scope scope;
+
+		if(!dp.parseForProfile(bodyJson, registered, OUT bullet, OUT rifle, OUT scope)) {
+			throw std::invalid_argument("no Bullet, Rifle or Scope");
+		}
+
+		auto meteo = dp.parseForMeteoData(bodyJson);
+		auto options = dp.parseForOptions(bodyJson);
+		auto inputs = dp.parseForInputs(bodyJson);
+
+		const auto dists = bodyJson["Inputs"]["dist."].get<std::vector<uint16_t>>();
+		const uint16_t range = solverRange(&options);
+
+		if(dists.empty() || dists.size() > MAX_SHOT_DISTANCES) {
+			throw std::out_of_range("wrong number of distances");
+		}
+
+		for(auto dist : dists) {
+
+			if(dist < 1 || dist > range) {
+				throw std::out_of_range("distance is out of range");
+			}
+		}
+
+		std::vector<Results> results(dists.size());
+		trajectorySolverAt(&ctx, &meteo, &bullet, &rifle, &scope, &inputs, &options, dists.data(), dists.size(), OUT results.data());
+
+		nlohmann::json resultsJson = nlohmann::json::array();
+
+		for(size_t k = 0; k < dists.size(); k++) {
+
+			auto resultJson = dp.resultToJson(results[k]);
+			resultJson["dist."] = dists[k];
+
+			resultsJson.push_back(resultJson);
+		}
+
+		nlohmann::json responceJson;
+		responceJson["Version"] = dp.getVersion();
+		responceJson["Token"] = dp.token();
+		responceJson["Results"] = resultsJson;
+
+		workBuffer = responceJson.dump(4);
+
+		LOG_INFO(fastlog::LogEventType::System) << "Результат вычислений: " << workBuffer;
+	}
+	catch(...) {
+
+		workBuffer = "{}";
+		LOG_INFO(fastlog::LogEventType::System) << "Данные не обработаны";
+	}
+}
+
+bool s2::isBatchRequest(const nlohmann::json& bodyJson) {
+
+	return bodyJson.is_object() && bodyJson.contains("Batch") && bodyJson["Batch"].is_array();
+}
+
+s2::batchsolver::batchsolver(const nlohmann::json& bodyJson, const profile* registered) : m_bodyJson(bodyJson) {
+
+	m_shared.getToken(bodyJson);
+
+	/* Shared sections are optional, each shot may bring its own */
+
+	m_hasBullet = bodyJson.contains("Bullet") || (registered && registered->hasBullet);
+	m_hasRifle = bodyJson.contains("Rifle") || (registered && registered->hasRifle);
+	m_hasScope = bodyJson.contains("Scope") || (registered && registered->hasScope);
+
+	m_shared.parseForProfile(bodyJson, registered, OUT m_bullet, OUT m_rifle, OUT m_scope);
+
+	if((m_hasMeteo = bodyJson.contains("Meteo"))) {
+		m_meteo = m_shared.parseForMeteoData(bodyJson);
+	}
+
+	if((m_hasOptions = bodyJson.contains("Options"))) {
+		m_options = m_shared.parseForOptions(bodyJson);
+	}
+
+	if((m_hasInputs = bodyJson.contains("Inputs"))) {
+		m_inputs = m_shared.parseForInputs(bodyJson);
+	}
+
+	m_results.resize(bodyJson["Batch"].size());
+}
+
+size_t s2::batchsolver::size() const {
+
+	return m_results.size();
+}
+
+bool s2::batchsolver::prepareShot(size_t index, shot& OUT s) {
+
+	const auto& shotJson = m_bodyJson["Batch"][index];
+
+	if((!shotJson.contains("Bullet") && !m_hasBullet) || (!shotJson.contains("Rifle") && !m_hasRifle) || 
+		(!shotJson.contains("Scope") && !m_hasScope) || (!shotJson.contains("Meteo") && !m_hasMeteo) || 
+		(!shotJson.contains("Options") && !m_hasOptions) || (!shotJson.contains("Inputs") && !m_hasInputs)) {
+
+		return false;
+	}
+
+	/* Copy keeps units/rangecard flags of shared sections, shared CDM/MBC/wind 
+	arrays stay in m_shared and are only read by the solver. Overridden sections 
+	point into s.dp, so s must not be moved until the shot is solved */
+	s.dp = m_shared;
+
+	s.bullet = shotJson.contains("Bullet") ? s.dp.parseForBulletData(shotJson) : m_bullet;
+	s.rifle = shotJson.contains("Rifle") ? s.dp.parseForRifleData(shotJson) : m_rifle;
+	s.scope = shotJson.contains("Scope") ? s.dp.parseForScopeData(shotJson) : m_scope;
+	s.meteo = shotJson.contains("Meteo") ? s.dp.parseForMeteoData(shotJson) : m_meteo;
+	s.options = shotJson.contains("Options") ? s.dp.parseForOptions(shotJson) : m_options;
+	s.inputs = shotJson.contains("Inputs") ? s.dp.parseForInputs(shotJson) : m_inputs;
+
+	return true;
+}
+
+void s2::batchsolver::solveShot(size_t index, SolverContext& ctx) {
+
+	try {
+
+		shot s;
+
+		if(!prepareShot(index, s)) {
+
+			m_results[index] = nlohmann::json::object();
+			return;
+		}
+
+		trajectorySolver(&ctx, &s.meteo, &s.bullet, &s.rifle, &s.scope, &s.inputs, &s.options, OUT &s.results);
+
+		m_results[index] = s.dp.resultToJson(s.results);
+	}
+	catch(...) {
+
+		m_results[index] = nlohmann::json::object();
+	}
+}
+
+void s2::batchsolver::solveShots(size_t first, size_t count, SolverContext* const ctxs[]) {
+
+	/* Shots that fail to parse are replied with {} and do not take a lane */
+
+	std::vector<shot> shots(count);
+	std::vector<size_t> indexes;
+	std::vector<SolverRequest> requests;
+
+	indexes.reserve(count);
+	requests.reserve(count);
+
+	for(size_t i = 0; i < count; i++) {
+
+		try {
+
+			if(prepareShot(first + i, shots[i])) {
+
+				auto& s = shots[i];
+				requests.push_back({&s.meteo, &s.bullet, &s.rifle, &s.scope, &s.inputs, &s.options, &s.results});
+				indexes.push_back(i);
+				continue;
+			}
+		}
+		catch(...) {}
+
+		m_results[first + i] = nlohmann::json::object();
+	}
+
+	trajectorySolverLockstep(ctxs, requests.data(), requests.size());
+
+	for(size_t lane = 0; lane < indexes.size(); lane++) {
+
+		const size_t i = indexes[lane];
+
+		try {
+
+			m_results[first + i] = shots[i].dp.resultToJson(shots[i].results);
+		}
+		catch(...) {
+
+			m_results[first + i] = nlohmann::json::object();
+		}
+	}
+}
+
+void s2::batchsolver::serializeResults(std::string& workBuffer) const {
+
+	/* {"Version": "...", "Token": "...", "Results": [{<Result of shot 0>}, {}, ...]}, 
+	failed shots are replied with empty objects */
+
+	nlohmann::json responceJson;
+	responceJson["Version"] = m_shared.getVersion();
+	responceJson["Token"] = m_shared.token();
+	responceJson["Results"] = m_results;
+
+	workBuffer.reserve(BALLISTIX_WORKING_BUFFER_SIZE);
+	workBuffer = responceJson.dump(4);
 }
\ No newline at end of file
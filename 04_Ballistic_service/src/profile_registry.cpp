@@ -0,0 +1,185 @@
+#include "profile_registry.h"
+#include "json_working_stuff.h"
+#include "sharded_lru.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+static const char* const profileSections[] = {"Bullet", "Rifle", "Scope"};
+
+static void checkTables(const nlohmann::json& bulletJson) {
+
+	/* The parser fills the tables without looking at their size */
+	const auto DF = bulletJson.value("DF", std::string());
+
+	if(DF == "CDM" && (!bulletJson.contains("CDM") || bulletJson["CDM"].size() != CMD_GRANULARITY)) {
+		throw std::invalid_argument("CDM needs every Mach point");
+	}
+
+	if((DF == "MBCG1" || DF == "MBCG7") && (!bulletJson.contains("MBC") || bulletJson["MBC"].size() != MBC_GRANULARITY)) {
+		throw std::invalid_argument("MBC needs every Mach point");
+	}
+}
+
+bool s2::isRegisterRequest(const nlohmann::json& bodyJson) {
+
+	return bodyJson.is_object() && bodyJson.contains("Register") && bodyJson["Register"].is_object();
+}
+
+bool s2::hasProfileHandle(const nlohmann::json& bodyJson) {
+
+	return bodyJson.is_object() && bodyJson.contains("Profile") && bodyJson["Profile"].is_string();
+}
+
+void s2::applyProfile(const profile& registered, nlohmann::json& bodyJson) {
+
+	for(const auto& section : registered.sections.items()) {
+
+		if(!bodyJson.contains(section.key())) {
+			bodyJson[section.key()] = section.value();
+		}
+	}
+}
+
+s2::profileregistry::profileregistry(size_t capacity) : m_capacity(capacity) {}
+
+std::shared_ptr<s2::profile> s2::profileregistry::parseProfile(const nlohmann::json& registerJson) {
+
+	auto registered = std::make_shared<profile>();
+	datapreparator dp;
+
+	for(const char* section : profileSections) {
+
+		if(registerJson.contains(section)) {
+
+			if(!registerJson[section].is_object()) {
+				throw std::invalid_argument("profile section is not an object");
+			}
+
+			registered->sections[section] = registerJson[section];
+		}
+	}
+
+	if(registered->sections.empty()) {
+		throw std::invalid_argument("empty profile");
+	}
+
+	if((registered->hasBullet = registerJson.contains("Bullet"))) {
+
+		checkTables(registerJson["Bullet"]);
+
+		registered->bullet = dp.parseForBulletData(registerJson);
+
+		const Bullet& bullet = registered->bullet;
+
+		if((bullet.BC <= 0 && bullet.dragFunction != CDM) || bullet.V0 == 0 || bullet.length <= 0 || bullet.mass == 0 || bullet.caliber <= 0) {
+			throw std::invalid_argument("wrong bullet");
+		}
+
+		if(registered->bullet.cdmData) {
+
+			memcpy(registered->CDMArray, registered->bullet.cdmData, sizeof(CDMDataArray));
+			registered->bullet.cdmData = &registered->CDMArray;
+		}
+
+		if(registered->bullet.mbcData) {
+
+			memcpy(registered->MBCArray, registered->bullet.mbcData, sizeof(MBCDataArray));
+			registered->bullet.mbcData = &registered->MBCArray;
+		}
+	}
+
+	if((registered->hasRifle = registerJson.contains("Rifle"))) {
+
+		registered->rifle = dp.parseForRifleData(registerJson);
+
+		if(registered->rifle.zeroDistance == 0 || registered->rifle.twist <= 0) {
+			throw std::invalid_argument("wrong rifle");
+		}
+	}
+
+	if((registered->hasScope = registerJson.contains("Scope"))) {
+
+		registered->scope = dp.parseForScopeData(registerJson);
+
+		if(registered->scope.clickVert <= 0 || registered->scope.clickHoriz <= 0) {
+			throw std::invalid_argument("wrong scope");
+		}
+	}
+
+	return registered;
+}
+
+std::string s2::profileregistry::add(const nlohmann::json& registerJson) {
+
+	auto registered = parseProfile(registerJson);
+
+	/* Objects are dumped with sorted keys, equal profiles give equal handles (in every build and on every target) */
+	const std::string text = registered->sections.dump();
+
+	char handle[17];
+	snprintf(handle, sizeof(handle), "%016llx", (unsigned long long)fnv1aHash(text.data(), text.size()));
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto found = m_profiles.find(handle);
+
+	if(found != m_profiles.end()) {
+
+		if(found->second->sections.dump() != text) {
+			throw std::invalid_argument("handle collision");
+		}
+
+		return handle;
+	}
+
+	if(m_profiles.size() >= m_capacity) {
+		throw std::out_of_range("profile registry is full");
+	}
+
+	m_profiles.emplace(handle, std::move(registered));
+
+	return handle;
+}
+
+std::shared_ptr<const s2::profile> s2::profileregistry::find(const std::string& handle) const {
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto found = m_profiles.find(handle);
+
+	return found != m_profiles.end() ? found->second : nullptr;
+}
+
+size_t s2::profileregistry::size() const {
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_profiles.size();
+}
+
+size_t s2::profileregistry::capacity() const {
+
+	return m_capacity;
+}
+
+void s2::profileregistry::clear() {
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_profiles.clear();
+}
+
+void s2::serializeRegistration(const nlohmann::json& bodyJson, const std::string& handle, std::string& workBuffer) {
+
+	datapreparator dp;
+	dp.getToken(bodyJson);
+
+	nlohmann::json responceJson;
+	responceJson["Version"] = dp.getVersion();
+	responceJson["Token"] = dp.token();
+	responceJson["Profile"] = handle;
+
+	workBuffer = responceJson.dump(4);
+}
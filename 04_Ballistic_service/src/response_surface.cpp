@@ -0,0 +1,402 @@
+#include "response_surface.h"
+#include "profile_registry.h"
+#include "trajectory_solver_lockstep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+/* The corrections the error is estimated on, as resultToJson() writes them */
+static const char* const errorChannels[] = {"/vert./1", "/horiz./1", "/deriv./1"};
+
+/* Numbers of a Result in the order of its dump (keys are sorted), shape - keys and array sizes */
+static void flattenResult(const nlohmann::json& json, const std::string& path, std::vector<double>& OUT values,
+	std::vector<std::string>* paths, std::string& OUT shape) {
+
+	if(json.is_object()) {
+
+		shape += '{';
+
+		for(const auto& item : json.items()) {
+
+			shape += item.key() + ':';
+			flattenResult(item.value(), path + '/' + item.key(), values, paths, shape);
+		}
+
+		shape += '}';
+	}
+	else if(json.is_array()) {
+
+		shape += '[' + std::to_string(json.size());
+
+		for(size_t i = 0; i < json.size(); i++) {
+			flattenResult(json[i], path + '/' + std::to_string(i), values, paths, shape);
+		}
+
+		shape += ']';
+	}
+	else if(json.is_number()) {
+
+		shape += json.is_number_float() ? 'f' : 'i';
+		values.push_back(json.get<double>());
+
+		if(paths) {
+			paths->push_back(path);
+		}
+	}
+	else {
+		throw std::invalid_argument("not a number in the Result");
+	}
+}
+
+static void unflattenResult(nlohmann::json& OUT json, const double* values, size_t& OUT leaf) {
+
+	if(json.is_object() || json.is_array()) {
+
+		for(auto& item : json) {
+			unflattenResult(item, values, leaf);
+		}
+	}
+	else if(json.is_number_float()) {
+		json = values[leaf++];
+	}
+	else {
+		json = (int64_t)llround(values[leaf++]);
+	}
+}
+
+size_t s2::surfaceAxis::nodes() const {
+
+	return step > 0 && to > from ? (size_t)floor((to - from) / step + 1e-9) + 1 : 1;
+}
+
+double s2::surfaceAxis::at(size_t node) const {
+
+	return from + node * step;
+}
+
+size_t s2::surfaceGrid::nodes() const {
+
+	return temp.nodes() * press.nodes() * humid.nodes();
+}
+
+size_t s2::responseSurface::nodeIndex(size_t t, size_t p, size_t h) const {
+
+	return (t * m_grid.press.nodes() + p) * m_grid.humid.nodes() + h;
+}
+
+s2::responseSurface::responseSurface(const nlohmann::json& bodyJson, const surfaceGrid& grid, const profile* registered,
+	SolverContext* const ctxs[]) : m_grid(grid) {
+
+	const size_t temps = grid.temp.nodes();
+	const size_t presses = grid.press.nodes();
+	const size_t humids = grid.humid.nodes();
+
+	if(temps < 2 || presses < 2 || humids < 2) {
+		throw std::invalid_argument("a grid axis needs two nodes");
+	}
+
+	datapreparator dp;
+
+	Bullet bullet;
+	Rifle rifle;
+	Scope scope;
+
+	if(!dp.parseForProfile(bodyJson, registered, OUT bullet, OUT rifle, OUT scope)) {
+		throw std::invalid_argument("no Bullet, Rifle or Scope");
+	}
+
+	const Meteo meteo = dp.parseForMeteoData(bodyJson);
+	const Options options = dp.parseForOptions(bodyJson);
+	const Inputs inputs = dp.parseForInputs(bodyJson);
+
+	/* The grid nodes, then the centers of the cells (Meteo takes whole degrees, hPa and %) */
+	std::vector<Meteo> meteos;
+
+	for(size_t t = 0; t < temps; t++) {
+		for(size_t p = 0; p < presses; p++) {
+			for(size_t h = 0; h < humids; h++) {
+
+				Meteo node = meteo;
+				node.T = (int8_t)lround(grid.temp.at(t));
+				node.P = (uint16_t)lround(grid.press.at(p));
+				node.H = (uint8_t)lround(grid.humid.at(h));
+
+				meteos.push_back(node);
+			}
+		}
+	}
+
+	const size_t nodes = meteos.size();
+
+	for(size_t t = 0; t + 1 < temps; t++) {
+		for(size_t p = 0; p + 1 < presses; p++) {
+			for(size_t h = 0; h + 1 < humids; h++) {
+
+				Meteo center = meteo;
+				center.T = (int8_t)lround(grid.temp.at(t) + grid.temp.step / 2);
+				center.P = (uint16_t)lround(grid.press.at(p) + grid.press.step / 2);
+				center.H = (uint8_t)lround(grid.humid.at(h) + grid.humid.step / 2);
+
+				meteos.push_back(center);
+			}
+		}
+	}
+
+	const size_t lanes = std::max(1, lockstepLanes());
+
+	std::vector<Results> results(meteos.size());
+	std::vector<double> centers;
+	std::string firstShape;
+	std::vector<size_t> channels;
+
+	for(size_t first = 0; first < meteos.size(); first += lanes) {
+
+		const size_t count = std::min(lanes, meteos.size() - first);
+		std::vector<SolverRequest> requests;
+
+		for(size_t i = first; i < first + count; i++) {
+			requests.push_back({&meteos[i], &bullet, &rifle, &scope, &inputs, &options, &results[i]});
+		}
+
+		trajectorySolverLockstep(ctxs, requests.data(), count);
+
+		/* Range-card rows stay in the contexts until they solve again */
+		for(size_t i = first; i < first + count; i++) {
+
+			const nlohmann::json resultJson = dp.resultToJson(results[i]);
+
+			std::vector<std::string> paths;
+			std::string shape;
+
+			flattenResult(resultJson, "", i < nodes ? m_values : centers, i == 0 ? &paths : nullptr, shape);
+
+			if(i == 0) {
+
+				m_template = resultJson;
+				m_leaves = m_values.size();
+				firstShape = shape;
+
+				for(const char* channel : errorChannels) {
+
+					auto found = std::find(paths.begin(), paths.end(), channel);
+
+					if(found != paths.end()) {
+						channels.push_back(found - paths.begin());
+					}
+				}
+			}
+			else if(shape != firstShape) {
+				throw std::invalid_argument("Results of the nodes differ in shape");
+			}
+		}
+	}
+
+	/* The miss at the center of a cell, the model is not smooth everywhere (A0 is taken in whole m/s, so 
+	the corrections step every degree or two), a miss between the centers may be larger */
+	std::vector<double> misses(meteos.size() - nodes, 0.0);
+
+	for(size_t i = nodes; i < meteos.size(); i++) {
+
+		const double at[3] = {(double)meteos[i].T, (double)meteos[i].P, (double)meteos[i].H};
+		const double* solved = &centers[(i - nodes) * m_leaves];
+
+		std::vector<double> values;
+		size_t cell;
+
+		interpolate(at, OUT values, OUT cell);
+
+		for(size_t channel : channels) {
+			misses[cell] = std::max(misses[cell], fabs(values[channel] - solved[channel]));
+		}
+	}
+
+	/* The error of a cell is the largest miss of it and its neighbours with a margin */
+	const size_t cells[3] = {temps - 1, presses - 1, humids - 1};
+
+	m_errors.assign(misses.size(), 0.0);
+
+	for(size_t t = 0; t < cells[0]; t++) {
+		for(size_t p = 0; p < cells[1]; p++) {
+			for(size_t h = 0; h < cells[2]; h++) {
+
+				double& error = m_errors[(t * cells[1] + p) * cells[2] + h];
+
+				for(size_t nt = t > 0 ? t - 1 : 0; nt <= std::min(t + 1, cells[0] - 1); nt++) {
+					for(size_t np = p > 0 ? p - 1 : 0; np <= std::min(p + 1, cells[1] - 1); np++) {
+						for(size_t nh = h > 0 ? h - 1 : 0; nh <= std::min(h + 1, cells[2] - 1); nh++) {
+							error = std::max(error, SURFACE_ERROR_MARGIN * misses[(nt * cells[1] + np) * cells[2] + nh]);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+bool s2::responseSurface::interpolate(const double at[3], std::vector<double>& OUT values, size_t& OUT cell) const {
+
+	const surfaceAxis* const axes[3] = {&m_grid.temp, &m_grid.press, &m_grid.humid};
+
+	size_t cellOf[3];
+	double weight[3];
+
+	for(int axis = 0; axis < 3; axis++) {
+
+		const surfaceAxis& a = *axes[axis];
+
+		if(at[axis] < a.from || at[axis] > a.at(a.nodes() - 1)) {
+			return false;
+		}
+
+		cellOf[axis] = std::min((size_t)((at[axis] - a.from) / a.step), a.nodes() - 2);
+		weight[axis] = (at[axis] - a.at(cellOf[axis])) / a.step;
+	}
+
+	values.assign(m_leaves, 0.0);
+
+	for(int corner = 0; corner < 8; corner++) {
+
+		const size_t t = cellOf[0] + (corner & 1);
+		const size_t p = cellOf[1] + ((corner >> 1) & 1);
+		const size_t h = cellOf[2] + ((corner >> 2) & 1);
+
+		const double w = ((corner & 1) ? weight[0] : 1 - weight[0]) * (((corner >> 1) & 1) ? weight[1] : 1 - weight[1]) *
+			(((corner >> 2) & 1) ? weight[2] : 1 - weight[2]);
+
+		const double* node = &m_values[nodeIndex(t, p, h) * m_leaves];
+
+		for(size_t leaf = 0; leaf < m_leaves; leaf++) {
+			values[leaf] += w * node[leaf];
+		}
+	}
+
+	cell = (cellOf[0] * (m_grid.press.nodes() - 1) + cellOf[1]) * (m_grid.humid.nodes() - 1) + cellOf[2];
+
+	return true;
+}
+
+bool s2::responseSurface::evaluate(double temp, double press, double humid, nlohmann::json& OUT resultJson, double& OUT error) const {
+
+	const double at[3] = {temp, press, humid};
+
+	std::vector<double> values;
+	size_t cell;
+
+	if(!interpolate(at, OUT values, OUT cell)) {
+		return false;
+	}
+
+	resultJson = m_template;
+
+	size_t leaf = 0;
+	unflattenResult(resultJson, values.data(), leaf);
+
+	error = m_errors[cell];
+
+	return true;
+}
+
+size_t s2::responseSurface::bytes() const {
+
+	return sizeof(responseSurface) + (m_values.capacity() + m_errors.capacity()) * sizeof(double) + m_template.dump().size();
+}
+
+s2::surfaceCache::surfaceCache(size_t capacity, const surfaceGrid& grid) : shardedLRU(capacity, 1), m_grid(grid) {}
+
+const s2::surfaceGrid& s2::surfaceCache::grid() const {
+
+	return m_grid;
+}
+
+std::string s2::surfaceCache::makeKey(const nlohmann::json& bodyJson) {
+
+	/* Objects are dumped with sorted keys, equal requests give equal keys */
+	nlohmann::json keyJson = bodyJson;
+	keyJson.erase("Token");
+	keyJson["Meteo"].erase("temp.");
+	keyJson["Meteo"].erase("press.");
+	keyJson["Meteo"].erase("humid.");
+
+	return keyJson.dump();
+}
+
+bool s2::surfaceCache::startBuild(const std::string& key) {
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const bool active = std::find(m_misses.begin(), m_misses.end(), key) != m_misses.end();
+
+	if(!active) {
+
+		m_misses.push_back(key);
+
+		if(m_misses.size() > SURFACE_CANDIDATES) {
+			m_misses.pop_front();
+		}
+
+		return false;
+	}
+
+	/* One surface at a time, the pool is for the requests */
+	if(m_building) {
+		return false;
+	}
+
+	m_misses.erase(std::find(m_misses.begin(), m_misses.end(), key));
+	m_building = true;
+
+	return true;
+}
+
+void s2::surfaceCache::finishBuild() {
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_building = false;
+}
+
+bool s2::isSurfaceRequest(const nlohmann::json& bodyJson) {
+
+	if(!bodyJson.is_object() || !bodyJson.contains("Meteo") || !bodyJson["Meteo"].is_object() ||
+		!bodyJson.contains("Inputs") || !bodyJson["Inputs"].is_object()) {
+		return false;
+	}
+
+	const auto& meteoJson = bodyJson["Meteo"];
+
+	return meteoJson.contains("temp.") && meteoJson["temp."].is_number() && meteoJson.contains("press.") &&
+		meteoJson["press."].is_number() && meteoJson.contains("humid.") && meteoJson["humid."].is_number() &&
+		bodyJson["Inputs"].contains("dist.") && bodyJson["Inputs"]["dist."].is_number();
+}
+
+bool s2::solveFromSurface(const nlohmann::json& bodyJson, const responseSurface& surface, double maxError,
+	std::string& workBuffer) {
+
+	/* As parseForMeteoData() reads them */
+	const auto& meteoJson = bodyJson["Meteo"];
+	const double temp = meteoJson["temp."].get<int8_t>();
+	const double press = meteoJson["press."].get<uint16_t>();
+	const double humid = meteoJson["humid."].get<uint8_t>();
+
+	nlohmann::json resultJson;
+	double error;
+
+	if(!surface.evaluate(temp, press, humid, OUT resultJson, OUT error) || !(error <= maxError)) {
+		return false;
+	}
+
+	datapreparator dp;
+	dp.getToken(bodyJson);
+
+	nlohmann::json responceJson;
+	responceJson["Version"] = dp.getVersion();
+	responceJson["Token"] = dp.token();
+	responceJson["Result"] = resultJson;
+	responceJson["Surface"]["err."] = error;
+
+	workBuffer.reserve(BALLISTIX_WORKING_BUFFER_SIZE);
+	workBuffer = responceJson.dump(4);
+
+	return true;
+}
@@ -0,0 +1,167 @@
+#include "result_cache.h"
+#include "trajectory_solver_routines.h"
+#include "nlohmann.h"
+
+#include <math.h>
+
+template<typename T>
+static T quantizeValue(T value, double step) {
+
+	if(step <= 0) {
+		return value;
+	}
+
+	return (T)(round(value / step) * step);
+}
+
+s2::resultcache::resultcache(size_t capacity, size_t shards, const quantizationSteps& steps) : 
+shardedLRU(capacity, shards), m_steps(steps) {}
+
+void s2::resultcache::quantize(Meteo& meteo) const {
+
+	meteo.T = quantizeValue(meteo.T, m_steps.temp);
+	meteo.P = quantizeValue(meteo.P, m_steps.press);
+	meteo.H = quantizeValue(meteo.H, m_steps.humid);
+
+	if(meteo.WindType == COMPLEX_CASE) {
+
+		for(int i = 0; i < complexWindSegments(&meteo); i++) {
+
+			(*meteo.windData)[i].windSpeed = quantizeValue((*meteo.windData)[i].windSpeed, m_steps.windSpeed);
+			(*meteo.windData)[i].windDir = quantizeValue((*meteo.windData)[i].windDir, m_steps.windDir);
+		}
+	}
+	else {
+
+		meteo.windSpeed = quantizeValue(meteo.windSpeed, m_steps.windSpeed);
+		meteo.windDir = quantizeValue(meteo.windDir, m_steps.windDir);
+	}
+}
+
+std::string s2::resultcache::makeKey(const Meteo& meteo, const Bullet& bullet, const Rifle& rifle, 
+	const Scope& scope, const Inputs& inputs, const Options& options) const {
+
+	/* Everything the reply depends on, names are not replied and are left out */
+
+	std::string key;
+	key.reserve(512);
+
+	appendKeyBytes(key, meteo.T);
+	appendKeyBytes(key, meteo.P);
+	appendKeyBytes(key, meteo.H);
+	appendKeyBytes(key, meteo.WindType);
+
+	if(meteo.WindType == COMPLEX_CASE) {
+
+		const uint8_t segments = complexWindSegments(&meteo);
+		appendKeyBytes(key, segments);
+
+		for(int i = 0; i < segments; i++) {
+
+			appendKeyBytes(key, (*meteo.windData)[i].currentDistance);
+			appendKeyBytes(key, (*meteo.windData)[i].windSpeed);
+			appendKeyBytes(key, (*meteo.windData)[i].windDir);
+			appendKeyBytes(key, (*meteo.windData)[i].terrainDir);
+		}
+	}
+	else {
+
+		appendKeyBytes(key, meteo.windSpeed);
+		appendKeyBytes(key, meteo.windDir);
+		appendKeyBytes(key, meteo.terrainDir);
+	}
+
+	appendKeyBytes(key, bullet.dragFunction);
+	appendKeyBytes(key, bullet.BC);
+	appendKeyBytes(key, bullet.DSF_0_9);
+	appendKeyBytes(key, bullet.DSF_1_0);
+	appendKeyBytes(key, bullet.DSF_1_1);
+	appendKeyBytes(key, bullet.V0);
+	appendKeyBytes(key, bullet.length);
+	appendKeyBytes(key, bullet.mass);
+	appendKeyBytes(key, bullet.caliber);
+	appendKeyBytes(key, bullet.V0temp);
+	appendKeyBytes(key, bullet.thermalSens);
+
+	if(bullet.dragFunction == CDM) {
+
+		for(int i = 0; i < CMD_GRANULARITY; i++) {
+
+			appendKeyBytes(key, (*bullet.cdmData)[i].MachNumber);
+			appendKeyBytes(key, (*bullet.cdmData)[i].CD);
+		}
+	}
+	else if(bullet.dragFunction == MBCG1 || bullet.dragFunction == MBCG7) {
+
+		for(int i = 0; i < MBC_GRANULARITY; i++) {
+
+			appendKeyBytes(key, (*bullet.mbcData)[i].MachNumber);
+			appendKeyBytes(key, (*bullet.mbcData)[i].BC);
+		}
+	}
+
+	appendKeyBytes(key, rifle.zeroDistance);
+	appendKeyBytes(key, rifle.scopeHight);
+	appendKeyBytes(key, rifle.twist);
+	appendKeyBytes(key, rifle.twistDir);
+	appendKeyBytes(key, rifle.zeroAtm);
+	appendKeyBytes(key, rifle.zeroTemp);
+	appendKeyBytes(key, rifle.zeroPress);
+	appendKeyBytes(key, rifle.vertDrift);
+	appendKeyBytes(key, rifle.vertDrDir);
+	appendKeyBytes(key, rifle.horizDrift);
+	appendKeyBytes(key, rifle.horizDrDir);
+	appendKeyBytes(key, rifle.rollAngle);
+
+	appendKeyBytes(key, scope.angleUnits);
+	appendKeyBytes(key, scope.clickVert);
+	appendKeyBytes(key, scope.clickHoriz);
+	appendKeyBytes(key, scope.reticlePattern);
+
+	appendKeyBytes(key, inputs.shotDistance);
+	appendKeyBytes(key, inputs.terrainAndle);
+	appendKeyBytes(key, inputs.targetSpeedInMILs);
+	appendKeyBytes(key, inputs.targetAzimuth);
+	appendKeyBytes(key, inputs.latitude);
+	appendKeyBytes(key, inputs.magneticIncl);
+
+	appendKeyBytes(key, options.Koriolis);
+	appendKeyBytes(key, options.BallisticTable);
+	appendKeyBytes(key, options.ThermalCorrection);
+	appendKeyBytes(key, options.AeroJump);
+	appendKeyBytes(key, options.Integrator);
+	appendKeyBytes(key, options.EarlyExit);
+	appendKeyBytes(key, options.MachDistances);
+	appendKeyBytes(key, options.RangecardFrom);
+	appendKeyBytes(key, options.RangecardTo);
+	appendKeyBytes(key, options.Range);
+	appendKeyBytes(key, options.TableStep);
+	appendKeyBytes(key, options.Precision);
+	appendKeyBytes(key, options.WindInterpolation);
+	appendKeyBytes(key, options.Sensitivities);
+
+	return key;
+}
+
+bool s2::resultcache::splitReply(const std::string& reply, const std::string& token, cachedReply& OUT cached) {
+
+	const std::string tokenKey = "\"Token\": ";
+	const std::string tokenValue = nlohmann::json(token).dump();
+	const size_t pos = reply.find(tokenKey + tokenValue);
+
+	if(pos == std::string::npos) {
+		return false;
+	}
+
+	cached.head = reply.substr(0, pos + tokenKey.size());
+	cached.tail = reply.substr(pos + tokenKey.size() + tokenValue.size());
+
+	return true;
+}
+
+void s2::resultcache::joinReply(const cachedReply& cached, const std::string& token, std::string& OUT reply) {
+
+	reply = cached.head;
+	reply += nlohmann::json(token).dump();
+	reply += cached.tail;
+}
@@ -0,0 +1,193 @@
+#include "sweep_solver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+bool s2::isSweepRequest(const nlohmann::json& bodyJson) {
+
+	return bodyJson.is_object() && bodyJson.contains("Sweep") && bodyJson["Sweep"].is_object();
+}
+
+std::vector<int16_t> s2::sweepsolver::axis(const nlohmann::json& axisJson, int16_t lowest, int16_t highest) {
+
+	std::vector<int16_t> values;
+
+	if(axisJson.is_object()) {
+
+		const auto from = axisJson["from"].get<int16_t>();
+		const auto to = axisJson["to"].get<int16_t>();
+		const auto step = axisJson["step"].get<int16_t>();
+
+		if(step <= 0) {
+			throw std::invalid_argument("wrong sweep step");
+		}
+
+		for(int32_t value = from; value <= to && values.size() < SWEEP_MAX_CELLS; value += step) {
+			values.push_back((int16_t)value);
+		}
+	}
+	else {
+
+		for(const auto& valueJson : axisJson) {
+			values.push_back(valueJson.get<int16_t>());
+		}
+	}
+
+	if(values.empty()) {
+		throw std::invalid_argument("empty sweep axis");
+	}
+
+	for(auto value : values) {
+
+		if(value < lowest || value > highest) {
+			throw std::out_of_range("sweep value is out of range");
+		}
+	}
+
+	return values;
+}
+
+s2::sweepsolver::sweepsolver(const nlohmann::json& bodyJson) {
+
+	m_dp.getToken(bodyJson);
+
+	m_bullet = m_dp.parseForBulletData(bodyJson);
+	m_rifle = m_dp.parseForRifleData(bodyJson);
+	m_scope = m_dp.parseForScopeData(bodyJson);
+	m_meteo = m_dp.parseForMeteoData(bodyJson);
+	m_options = m_dp.parseForOptions(bodyJson);
+	m_inputs = m_dp.parseForInputs(bodyJson);
+
+	const auto& sweepJson = bodyJson["Sweep"];
+
+	m_angles = axis(sweepJson.at("angles"), 0, 90);
+	m_azimuths = axis(sweepJson.at("azimuths"), -360, 360);
+
+	for(auto dist : axis(sweepJson.at("dist."), 1, solverRange(&m_options))) {
+		m_dists.push_back((uint16_t)dist);
+	}
+
+	if(m_angles.size() * m_azimuths.size() * m_dists.size() > SWEEP_MAX_CELLS) {
+		throw std::out_of_range("too many sweep cells");
+	}
+
+	/* Range-card rows at the requested distances only: the step is their greatest common divisor */
+	uint16_t step = 0;
+
+	for(auto dist : m_dists) {
+		step = std::gcd(step, dist);
+	}
+
+	m_sweepOptions = m_options;
+	m_sweepOptions.BallisticTable = OPTION_YES;
+	m_sweepOptions.TableStep = step;
+	m_sweepOptions.RangecardFrom = *std::min_element(m_dists.begin(), m_dists.end());
+	m_sweepOptions.RangecardTo = *std::max_element(m_dists.begin(), m_dists.end());
+	m_sweepOptions.EarlyExit = OPTION_YES;
+	m_sweepOptions.MachDistances = OPTION_NO;
+
+	m_vert.resize(m_angles.size() * m_azimuths.size() * m_dists.size());
+}
+
+size_t s2::sweepsolver::angles() const {
+
+	return m_angles.size();
+}
+
+Inputs s2::sweepsolver::cellInputs(size_t angle, size_t azimuth) const {
+
+	return Inputs{m_sweepOptions.RangecardTo, (uint8_t)m_angles[angle], m_inputs.targetSpeedInMILs, m_azimuths[azimuth],
+		m_inputs.latitude, m_inputs.magneticIncl};
+}
+
+void s2::sweepsolver::solveBase(SolverContext& ctx) {
+
+	const Inputs inputs = cellInputs(0, 0);
+	Results results;
+
+	ctx.keepRawRows = true;
+	trajectorySolver(&ctx, &m_meteo, &m_bullet, &m_rifle, &m_scope, &inputs, &m_sweepOptions, OUT &results);
+	ctx.keepRawRows = false;
+
+	m_solved = ctx;
+	m_solved.zeroCache = nullptr;
+	m_solved.traceCache = nullptr;
+
+	const int units = m_scope.angleUnits == MRAD_UNITS ? 1 : 0;
+
+	for(auto dist : m_dists) {
+
+		const uint16_t row = dist / results.table.step;
+
+		m_horiz.push_back(results.table.Horiz[row][units]);
+		m_deriv.push_back(results.table.Deriv[row][units]);
+		m_time.push_back(results.table.Time[row]);
+	}
+}
+
+void s2::sweepsolver::solveAngle(size_t angle, SolverContext& ctx) {
+
+	const int units = m_scope.angleUnits == MRAD_UNITS ? 1 : 0;
+
+	for(size_t azimuth = 0; azimuth < m_azimuths.size(); azimuth++) {
+
+		const Inputs inputs = cellInputs(angle, azimuth);
+		Results results;
+
+		const SolverRequest req {&m_meteo, &m_bullet, &m_rifle, &m_scope, &inputs, &m_sweepOptions, &results};
+		refinalizeSolver(&ctx, &m_solved, &req);
+
+		double* cell = &m_vert[(angle * m_azimuths.size() + azimuth) * m_dists.size()];
+
+		for(size_t d = 0; d < m_dists.size(); d++) {
+			cell[d] = results.table.Vert[m_dists[d] / results.table.step][units];
+		}
+	}
+}
+
+static std::vector<double> rounded(const double* values, size_t count, double scale = 100) {
+
+	std::vector<double> row(count);
+
+	for(size_t i = 0; i < count; i++) {
+		row[i] = std::round(values[i] * scale) / scale;
+	}
+
+	return row;
+}
+
+void s2::sweepsolver::serializeResults(std::string& workBuffer) const {
+
+	nlohmann::json vertJson = nlohmann::json::array();
+
+	for(size_t angle = 0; angle < m_angles.size(); angle++) {
+
+		nlohmann::json angleJson = nlohmann::json::array();
+
+		for(size_t azimuth = 0; azimuth < m_azimuths.size(); azimuth++) {
+			angleJson.push_back(rounded(&m_vert[(angle * m_azimuths.size() + azimuth) * m_dists.size()], m_dists.size()));
+		}
+
+		vertJson.push_back(angleJson);
+	}
+
+	nlohmann::json sweepJson;
+	sweepJson["angles"] = m_angles;
+	sweepJson["azimuths"] = m_azimuths;
+	sweepJson["dist."] = m_dists;
+	sweepJson["vert."] = vertJson;
+	sweepJson["horiz."] = rounded(m_horiz.data(), m_horiz.size());
+	sweepJson["deriv."] = rounded(m_deriv.data(), m_deriv.size());
+	sweepJson["time"] = rounded(m_time.data(), m_time.size(), 1000);
+
+	nlohmann::json responceJson;
+	responceJson["Version"] = m_dp.getVersion();
+	responceJson["Token"] = m_dp.token();
+	responceJson["Sweep"] = sweepJson;
+
+	/* Thousands of numbers, no indentation */
+	workBuffer.reserve(BALLISTIX_WORKING_BUFFER_SIZE);
+	workBuffer = responceJson.dump();
+}
@@ -0,0 +1,201 @@
+#include "trajectory_sensitivity.h"
+#include "trajectory_solver.h"
+#include "zeroing_cache.h"
+
+typedef dualNumber<SENS_INPUTS> shotReal;
+
+/* Inputs of the loop plus the distance */
+static inline shotReal shotValue(double value, const double integrated[SENS_RANGE], double rangeRate) {
+
+	shotReal r(value);
+
+	for(int k = 0; k < SENS_RANGE; k++) {
+		r.d[k] = integrated[k];
+	}
+
+	r.d[SENS_RANGE] = rangeRate;
+
+	return r;
+}
+
+static shotReal zeroingAngle(const struct SolverContext* const ctx, const struct SolverRequest* const req, double throwAngle) {
+
+	const struct Rifle* const rifle = req->rifle;
+	const struct sensitivityTangents* const tangents = &ctx->tangents;
+
+	if(rifle->zeroAtm == HERE) {
+
+		const shotReal Yzero = shotValue(ctx->zeroData.Yzero, tangents->Yzero, 0);
+		return atan(Yzero / ctx->zeroData.DistFeet);
+	}
+
+	if(rifle->zeroAtm != NOT_HERE) {
+		return shotReal(throwAngle);
+	}
+
+	/* Zeroed in its own atmosphere: central differences of the zeroing itself */
+	const double G_f = ctx->setup.G_f;
+	shotReal angle(throwAngle);
+
+	struct Bullet bullet = *req->bullet;
+
+	bullet.V0 = req->bullet->V0 + 1;
+	const double faster = cachedZeroingAngle(ctx->zeroCache, G_f, rifle, &bullet, req->meteo, &ctx->dragInfo);
+	bullet.V0 = req->bullet->V0 - 1;
+	const double slower = cachedZeroingAngle(ctx->zeroCache, G_f, rifle, &bullet, req->meteo, &ctx->dragInfo);
+
+	angle.d[SENS_V0] = (faster - slower) / 2;
+
+	struct dragAndBCInfo dragInfo = ctx->dragInfo;
+
+	dragInfo.BCzero = ctx->dragInfo.BCzero * 1.01;
+	const double higher = cachedZeroingAngle(ctx->zeroCache, G_f, rifle, req->bullet, req->meteo, &dragInfo);
+	dragInfo.BCzero = ctx->dragInfo.BCzero * 0.99;
+	const double lower = cachedZeroingAngle(ctx->zeroCache, G_f, rifle, req->bullet, req->meteo, &dragInfo);
+
+	angle.d[SENS_BC] = (higher - lower) / 2;
+
+	return angle;
+}
+
+void prepareSensitivities(struct SolverContext* ctx, const struct SolverRequest* const req) {
+
+	/* The thermal correction is linear in V0 */
+	struct Bullet bullet = *req->bullet;
+	bullet.V0 += 1;
+
+	ctx->tangents.V0rate = V0dueToSensivity(req->meteo, &bullet, req->options) - ctx->setup.V0;
+}
+
+void finalizeSensitivities(struct SolverContext* ctx, const struct SolverRequest* const req, double throwAngle) {
+
+	const struct Meteo* const meteo = req->meteo;
+	const struct Bullet* const bullet = req->bullet;
+	const struct Rifle* const rifle = req->rifle;
+	const struct Scope* const scope = req->scope;
+	const struct Inputs* const inputs = req->inputs;
+	const struct Options* const options = req->options;
+	struct Sensitivities* sens = &req->results->sens;
+
+	memset(sens, 0, sizeof(struct Sensitivities));
+
+	const struct sensitivityTangents* const tangents = &ctx->tangents;
+	const struct solverInvariants* const setup = &ctx->setup;
+
+	if(!tangents->integrated) {
+		return;
+	}
+
+	/* The shot row once more as addSomeSolutionDataToSolverStruct() and fillResultStructWithSimpleSolution()
+	finalize it, the distance moves the state along with its rates */
+	const struct trajectoryState* const shot = &tangents->shot;
+	const double sm = convertToFeets(0.01);
+
+	shotReal dist(inputs->shotDistance);
+	dist.d[SENS_RANGE] = 1;
+
+	const shotReal Dst_f = dist * STEP_f;
+	const shotReal Yabs = shotValue(shot->H2 / sm, tangents->Yabs, (shot->Vy / shot->Vx) * STEP_f / sm);
+	shotReal W = shotValue(shot->W2 / sm, tangents->W, (shot->Vz / shot->Vx) * STEP_f / sm);
+	const shotReal Time = shotValue(shot->Time, tangents->Time, STEP_f / shot->Vx);
+	const shotReal Mach = shotValue(shot->M, tangents->Mach, tangents->MachRate);
+
+	/* Muzzle velocity terms: SG (Miller), derivation, aerojump and vertical Coriolis */
+	shotReal V0(setup->V0);
+	V0.d[SENS_V0] = tangents->V0rate;
+
+	const shotReal SG = setup->SG * pow(V0 / setup->V0, 0.33333);
+	const double twistSign = rifle->twistDir == LEFT_TWIST ? -1 : 1;
+	const shotReal Deriv = twistSign * InchInSm * 1.25 * (SG + 1.2) * pow(Time, 1.83);
+	const shotReal KoriolisVert = 1 + (setup->KoriolisVert - 1) * (V0 / setup->V0);
+
+	const shotReal angle = zeroingAngle(ctx, req, throwAngle);
+	const shotReal Yrz = fabs(Yabs - Dst_f * tan(angle)) * KoriolisVert;
+	shotReal Yrt = Yrz - fabs(Yabs * (1 - cos((Pi * inputs->terrainAndle) / 180.0)));
+
+	if(options->AeroJump == OPTION_YES) {
+
+		const double jumpSlope = aeroJmpCorrector(setup->SG + 1, bullet, rifle, meteo, options) - setup->YaeroJump;
+		const shotReal YaeroJump = chained(SG, setup->YaeroJump, jumpSlope);
+		const shotReal MOAatDist = (dist / 100.0) * MOA_;
+
+		shotReal windSpeed;
+
+		if(meteo->WindType == SIMPLE_CASE) {
+
+			windSpeed = shotReal(tangents->windSpeed);
+			windSpeed.d[SENS_WIND] = -1;
+			windSpeed = fabs(windSpeed);
+		}
+		else {
+
+			const uint8_t windIndex = complexWindIndex(meteo, inputs->shotDistance);
+
+			for(uint8_t i = 0; i <= windIndex; i++) {
+				windSpeed.v += (*meteo->windData)[i].windSpeed * sin(DegToRad * (*meteo->windData)[i].windDir);
+			}
+
+			windSpeed.v /= (windIndex + 1);
+			windSpeed.d[SENS_WIND] = 1;
+		}
+
+		Yrt = Yrt + YaeroJump * windSpeed * MOAatDist;
+	}
+
+	if(bullet->dragFunction != CDM) {
+
+		const double DSFslope = (linearInterpolationDSF(bullet, Mach.v + SENS_MACH_STEP) -
+			linearInterpolationDSF(bullet, Mach.v - SENS_MACH_STEP)) / (2 * SENS_MACH_STEP);
+
+		Yrt = Yrt * chained(Mach, linearInterpolationDSF(bullet, Mach.v), DSFslope);
+	}
+
+	if(options->Koriolis == OPTION_YES) {
+		W = W + EarthRotation * dist * dist * sin(DegToRad * inputs->latitude) / (dist / Time) * 100;
+	}
+
+	const double CorrectionFactor = CorrFactorAndMOAorMRAD(scope->angleUnits);
+	const shotReal sm2angle = (dist / 100.0) * CorrectionFactor;
+
+	const shotReal Yrel = Yrt + getVertDriftAngular(rifle, scope) * sm2angle;
+	const shotReal Wdrift = W + getHorizDriftAngular(rifle, scope) * sm2angle;
+
+	shotReal vert = Yrel / sm2angle;
+	shotReal horiz = Wdrift / sm2angle;
+	shotReal deriv = Deriv / sm2angle;
+
+	/* Rifle roll as finalizeSolverRows() applies it */
+	if(rifle->rollAngle == -90 || rifle->rollAngle == 90) {
+
+		if(inputs->shotDistance == rifle->zeroDistance) {
+
+			/* The corrections are the roll of the zeroing itself */
+			vert = shotReal(vert.v);
+			horiz = shotReal(horiz.v);
+		}
+		else {
+
+			const shotReal vertRolled = horiz;
+			horiz = rifle->rollAngle == 90 ? vert : scaled(vert, -1);
+			vert = vertRolled;
+		}
+	}
+	else if(rifle->rollAngle != 0) {
+
+		const double rollInRads = -(rifle->rollAngle * 0.017453);		/* see correctViaRollAngle() */
+		const shotReal X = horiz + deriv;
+		const shotReal Y = vert;
+
+		vert = scaled(X, -sin(rollInRads)) + scaled(Y, cos(rollInRads));
+		horiz = scaled(X, cos(rollInRads)) + scaled(Y, sin(rollInRads));
+		deriv = shotReal(0);
+	}
+
+	for(int k = 0; k < SENS_INPUTS; k++) {
+
+		sens->vertAngleUnits[k] = vert.d[k];
+		sens->horizAngleUnits[k] = horiz.d[k];
+		sens->derivAngleUnits[k] = deriv.d[k];
+		sens->flightTime[k] = Time.d[k];
+	}
+}
@@ -1,27 +1,29 @@
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
 #include "trajectory_solver.h"
+#include "trajectory_solver_adaptive.h"
+#include "zeroing_cache.h"
+#include "trajectory_trace.h"
+#include "trajectory_sensitivity.h"
 #include "roll_angle.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static solverUnit solver[BALLISTIC_TABLE_SIZE + 2]{};
-static struct calibrationDistances calibDists;
-static struct windPortion windComps;
-static struct dragAndBCInfo dragInfo;
-static struct zeroingInfo zeroData;
-static struct solveCompactData solveData;
-static struct terminalData terminalInfo;
-static struct rifleAngles anglesData;
 static const double dummy{0};
-static struct roolCorrectionData rifleRollData;
 
-static inline double calculateFullSpeedValue(double Vx, double Vy, double Vz) {
+template<typename Real>
+static inline Real calculateFullSpeedValue(const Real& Vx, const Real& Vy, const Real& Vz) {
 	
+	using std::sqrt;
 	return sqrt((Vx * Vx) + (Vy * Vy) + (Vz * Vz));               
 }
 
-static inline double calculateMach(double V, double A0_f) {
+template<typename Real>
+static inline Real calculateMach(const Real& V, const Real& A0_f) {
 
 	return V * A0_f;
 }
@@ -31,15 +33,70 @@ static inline double calculateScopeFeetOffset(const struct Rifle* const rifle) {
 	return -convertToFeets(rifle->scopeHight * 0.01);
 }
 
-static inline void setZeroingInputs(uint16_t dist, double Elevation, const struct Rifle* const rifle, struct zeroingInfo* zeroData) {
+static inline void setZeroingInputs(uint16_t dist, double Elevation, const struct Rifle* const rifle, 
+	const struct dragAndBCInfo* const dragInfo, struct zeroingInfo* zeroData) {
 
 	if (dist == rifle->zeroDistance) {
 
 		zeroData->DistFeet = convertToFeets(dist);
 		zeroData->Yzero = Elevation;
+		zeroData->BCzero = dragInfo->BCzero;
 	}
 }
 
+static uint16_t lastSolverDist(const struct Inputs* const inputs, const struct Rifle* const rifle, const struct Options* const options) {
+
+	const uint16_t range = solverRange(options);
+
+	if(options->EarlyExit != OPTION_YES) {
+		return range;
+	}
+
+	uint16_t lastDist = inputs->shotDistance > rifle->zeroDistance ? inputs->shotDistance : rifle->zeroDistance;
+
+	if(options->BallisticTable == OPTION_YES) {
+
+		uint16_t rangecardEnd = rangecardLastIndex(options) * rangecardStep(options);
+		lastDist = rangecardEnd > lastDist ? rangecardEnd : lastDist;
+	}
+
+	return lastDist > range ? range : lastDist;
+}
+
+static void prepareBuffers(struct SolverContext* ctx, const struct Options* const options, struct Results* OUT results) {
+
+	/* Buffers only grow, a context that once solved an ELR table keeps it for the next requests */
+	const size_t slots = ctx->setup.tableSize + 2;
+
+	if(ctx->solver.size() < slots) {
+		ctx->solver.resize(slots);
+	}
+
+	results->table.step = ctx->setup.tableStep;
+	results->table.size = ctx->setup.tableSize;
+
+	if(options->BallisticTable != OPTION_YES) {
+
+		results->table.Vert = results->table.Horiz = results->table.Deriv = NULL;
+		results->table.Time = NULL;
+		return;
+	}
+
+	/* Vert, Horiz, Deriv (2 units each) and Time per row */
+	const size_t rows = ctx->setup.tableSize + 1;
+
+	if(ctx->tableRows.size() < rows * 7) {
+		ctx->tableRows.resize(rows * 7);
+	}
+
+	double* storage = ctx->tableRows.data();
+
+	results->table.Vert = reinterpret_cast<double (*)[2]>(storage);
+	results->table.Horiz = reinterpret_cast<double (*)[2]>(storage + rows * 2);
+	results->table.Deriv = reinterpret_cast<double (*)[2]>(storage + rows * 4);
+	results->table.Time = storage + rows * 6;
+}
+
 static inline void setSolverOutput(const solveCompactData* const solveData, solverUnit* solver, uint64_t index) {
 
 	solver[index].Dist = solveData->dist;
@@ -52,43 +109,101 @@ static inline void setSolverOutput(const solveCompactData* const solveData, solv
 	solver[index].windSpeed = solveData->Wz;
 }
 
-static inline double calculateThrowingAngle(double G_f, const struct Rifle* const rifle, const struct Bullet* const bullet, 
+static bool replayTrace(struct SolverContext* ctx, const struct SolverRequest* const req, const std::string& key, struct trajectoryState* state) {
+
+	std::shared_ptr<const trajectoryTrace> trace;
+
+	if(!ctx->traceCache->find(key, trace)) {
+		return false;
+	}
+
+	struct windPortion winds[MAX_WIND_SEGMENTS];
+	traceWinds(&ctx->windTable, winds);
+
+	if(!traceWindsMatch(trace->winds, winds, ctx->windTable.count)) {
+		return false;
+	}
+
+	/* Vertical, time and Mach come from the trace, the lateral channel is integrated 
+	exactly like in trajectorySolver() with the traced drag factors */
+	for (uint16_t i = 0; i < trace->steps.size(); i++) {
+
+		const struct traceStep* const step = &trace->steps[i];
+
+		windTableAt(&ctx->windTable, i, &ctx->windComps);
+
+		double Vz1 = state->Vz;
+		double A3_ = step->C4 * (Vz1 - ctx->windComps.Wz);
+		double Vz2 = Vz1 + convertToFeets(A3_);
+		double A6_ = step->C5 * (Vz2 - ctx->windComps.Wz);
+		double Vz3 = Vz1 + convertToFeets(0.5 * (A3_ + A6_));
+
+		state->W2 = state->W2 + convertToFeets(((Vz1 + Vz3) / step->Vx13));
+		state->Vz = Vz3;
+		state->H2 = step->H2;
+		state->Time = step->Time;
+		state->M = step->M;
+
+		recordSolverStep(ctx, req, i, state, step->Vprev);
+	}
+
+	ctx->dragInfo = trace->dragInfo;
+	ctx->calibDists = trace->calibDists;
+	ctx->zeroData = trace->zeroData;
+
+	return true;
+}
+
+static void storeTrace(struct SolverContext* ctx, const struct SolverRequest* const req, const std::string& key, 
+	std::shared_ptr<trajectoryTrace>& trace) {
+
+	traceWinds(&ctx->windTable, trace->winds);
+	trace->dragInfo = ctx->dragInfo;
+	trace->calibDists = ctx->calibDists;
+	trace->zeroData = ctx->zeroData;
+
+	const auto bytes = key.size() + sizeof(trajectoryTrace) + trace->steps.capacity() * sizeof(traceStep);
+	ctx->traceCache->insert(key, trace, bytes);
+}
+
+static inline double calculateThrowingAngle(zeroingCache* cache, double G_f, const struct Rifle* const rifle, const struct Bullet* const bullet, 
 	const struct Meteo* const meteo, const struct zeroingInfo* const zeroData, const struct dragAndBCInfo* const dragInfo) {
 
 	if(rifle->zeroAtm == HERE) {
 		return throwAngleCalculation(zeroData->Yzero, zeroData->DistFeet);
 	}
 	else if (rifle->zeroAtm == NOT_HERE) {
-		return ZeroingAngleforNumeric(G_f, rifle, bullet, meteo, dragInfo);
+		return cachedZeroingAngle(cache, G_f, rifle, bullet, meteo, dragInfo);
 	}
 
 	return dummy;
 }
 
-static inline void fillRifleRollData(const struct Rifle* const rifle) {
+static inline void fillRifleRollData(const struct Rifle* const rifle, struct roolCorrectionData* rifleRollData) {
 
 	double MOAatDistance = MOA_ * (rifle->zeroDistance / 100.0);
 
-	rifleRollData.MOAcorrection = (rifle->scopeHight / MOAatDistance);
-	rifleRollData.MRADcorrection = rifleRollData.MOAcorrection * MOAToMRAD;
+	rifleRollData->MOAcorrection = (rifle->scopeHight / MOAatDistance);
+	rifleRollData->MRADcorrection = rifleRollData->MOAcorrection * MOAToMRAD;
 }
 
-static void calculateComplexRoll(const struct Rifle* const rifle, const struct Scope* const scope, struct Results* OUT results) {
+static void calculateComplexRoll(const struct Rifle* const rifle, const struct Scope* const scope, 
+	struct rifleAngles* anglesData, struct Results* OUT results) {
 
-	resetAngles(&anglesData);
-	anglesData = {results->vertAngleUnits, results->horizAngleUnits + results->derivAngleUnits};
-	correctViaRollAngle(&anglesData, rifle->rollAngle);
+	resetAngles(anglesData);
+	*anglesData = {results->vertAngleUnits, results->horizAngleUnits + results->derivAngleUnits};
+	correctViaRollAngle(anglesData, rifle->rollAngle);
 	
-	results->vertAngleUnits = anglesData.vertCorr;
-	results->horizAngleUnits = anglesData.horizCorr;
+	results->vertAngleUnits = anglesData->vertCorr;
+	results->horizAngleUnits = anglesData->horizCorr;
 	results->derivAngleUnits = 0;
 
-	resetAngles(&anglesData);
-	anglesData = {(double)results->vertSm, (double)results->horizSm + (double)results->derivSm};
-	correctViaRollAngle(&anglesData, rifle->rollAngle);
+	resetAngles(anglesData);
+	*anglesData = {(double)results->vertSm, (double)results->horizSm + (double)results->derivSm};
+	correctViaRollAngle(anglesData, rifle->rollAngle);
 	
-	results->vertSm = (int16_t)anglesData.vertCorr;
-	results->horizSm = (int16_t)anglesData.horizCorr;
+	results->vertSm = (int16_t)anglesData->vertCorr;
+	results->horizSm = (int16_t)anglesData->horizCorr;
 	results->derivSm = 0;
 
 	results->vertClicks = (int16_t)(results->vertAngleUnits / scope->clickVert);
@@ -96,14 +211,15 @@ static void calculateComplexRoll(const struct Rifle* const rifle, const struct S
 	results->derivClicks = 0;
 }
 
-static void calculateSimpleRollAtZeroing(const struct Rifle* const rifle, const struct Scope* const scope, const struct Inputs* const inputs, struct Results* OUT results) {
+static void calculateSimpleRollAtZeroing(const struct Rifle* const rifle, const struct Scope* const scope, const struct Inputs* const inputs, 
+	const struct roolCorrectionData* const rifleRollData, struct Results* OUT results) {
 
 	const double angleCorrectionFactor = scope->angleUnits == MOA_UNITS ? MOA_ : MRAD_;
 
 	double VertDriftAngular = getVertDriftAngular(rifle, scope);
 	double HorizDriftAngular = getHorizDriftAngular(rifle, scope);
 
-	double rawVertAngleCorrection = ((scope->angleUnits == MOA_UNITS) ? rifleRollData.MOAcorrection : rifleRollData.MRADcorrection) + VertDriftAngular;
+	double rawVertAngleCorrection = ((scope->angleUnits == MOA_UNITS) ? rifleRollData->MOAcorrection : rifleRollData->MRADcorrection) + VertDriftAngular;
 	double rawHorizAngleCorrection = HorizDriftAngular;
 
 	/* При повороте на -90 градусов (поворот против часовой стрелки), скручиваем поправки по вертикали и накручиваем их на 
@@ -134,14 +250,15 @@ static void calculateSimpleRollAtZeroing(const struct Rifle* const rifle, const
 	results->horizClicks = (int16_t)(results->horizAngleUnits / scope->clickHoriz);	
 }
 
-static void calculateSimpleRollAtFar(const struct Rifle* const rifle, const struct Scope* const scope, const struct Inputs* const inputs, struct Results* OUT results) {
+static void calculateSimpleRollAtFar(const struct Rifle* const rifle, const struct Scope* const scope, const struct Inputs* const inputs, 
+	const struct roolCorrectionData* const rifleRollData, struct Results* OUT results) {
 
 	const double angleCorrectionFactor = scope->angleUnits == MOA_UNITS ? MOA_ : MRAD_;
 
 	double VertDriftAngular = getVertDriftAngular(rifle, scope);
 	double HorizDriftAngular = getHorizDriftAngular(rifle, scope);
 
-	double rawVertAngleCorrection = ((scope->angleUnits == MOA_UNITS) ? rifleRollData.MOAcorrection : rifleRollData.MRADcorrection) + VertDriftAngular;
+	double rawVertAngleCorrection = ((scope->angleUnits == MOA_UNITS) ? rifleRollData->MOAcorrection : rifleRollData->MRADcorrection) + VertDriftAngular;
 	double rawHorizAngleCorrection = HorizDriftAngular;
 
 	/* При повороте на -90 градусов (поворот против часовой стрелки), скручиваем поправки по вертикали и накручиваем их на 
@@ -182,15 +299,15 @@ static void calculateSimpleRollAtFar(const struct Rifle* const rifle, const stru
 }
 
 
-void fillResultStructWithSimpleSolution(const struct Bullet* const bullet, const struct Rifle* const rifle,
-	const struct Scope* const scope, const struct Inputs* const inputs,
+void fillResultStructWithSimpleSolution(const solverUnit solver[], uint16_t shotIndex, const struct Bullet* const bullet, 
+	const struct Rifle* const rifle, const struct Scope* const scope, const struct Inputs* const inputs,
 	const struct terminalData* const terminalInfo, const struct calibrationDistances* const calibDists,
 	double SG, struct Results* OUT results) {
 
-	double Yrel = solver[BALLISTIC_TABLE_SIZE + 1].Yrt;
-	double Wdrift = solver[BALLISTIC_TABLE_SIZE + 1].W;
-	double time = solver[BALLISTIC_TABLE_SIZE + 1].Time;
-	double deriv = solver[BALLISTIC_TABLE_SIZE+1].Deriv;
+	double Yrel = solver[shotIndex].Yrt;
+	double Wdrift = solver[shotIndex].W;
+	double time = solver[shotIndex].Time;
+	double deriv = solver[shotIndex].Deriv;
 
 	double VertDriftAngular = getVertDriftAngular(rifle, scope);
 	double HorizDriftAngular = getHorizDriftAngular(rifle, scope);
@@ -211,140 +328,693 @@ void fillResultStructWithSimpleSolution(const struct Bullet* const bullet, const
 
 #include <iostream>
 
-void trajectorySolver (const struct Meteo* const meteo, const struct Bullet* const bullet, const struct Rifle* const rifle, 
-	const struct Scope* const scope, const struct Inputs* const inputs, const struct Options* const options, struct Results* OUT results) {
+void prepareSolver(struct SolverContext* ctx, const struct SolverRequest* const req, struct OUT trajectoryState* state) {
+
+	const struct Meteo* const meteo = req->meteo;
+	const struct Bullet* const bullet = req->bullet;
+	const struct Rifle* const rifle = req->rifle;
+	const struct Inputs* const inputs = req->inputs;
+	const struct Options* const options = req->options;
 
 	if(rifle->rollAngle != 0) {
 		
-		fillRifleRollData(rifle);	
-	}
-
-	calibDists = {
-		DIST_RANGE,
-		DIST_RANGE,
-		DIST_RANGE,
-		DIST_RANGE,
-		DIST_RANGE,
-		DIST_RANGE,
-		DIST_RANGE,
-		DIST_RANGE,
-		DIST_RANGE,
-		DIST_RANGE
+		fillRifleRollData(rifle, &ctx->rifleRollData);	
+	}
+
+	struct solverInvariants* setup = &ctx->setup;
+
+	setup->range = solverRange(options);
+	setup->tableStep = rangecardStep(options);
+	setup->tableSize = rangecardSize(options);
+
+	ctx->calibDists = {
+		setup->range,
+		setup->range,
+		setup->range,
+		setup->range,
+		setup->range,
+		setup->range,
+		setup->range,
+		setup->range,
+		setup->range,
+		setup->range
 	};
 
-	double V0 = V0dueToSensivity(meteo, bullet, options);
-	double KoriolisVert = VerticalCoriolis(V0, inputs, options);
-	double CCF = ConditionCorrectionFactor(meteo);
-	double A0_f = speedOfSoundFeetRatio(meteo);
-	double SG = MillersFGS(V0, meteo, bullet, rifle);
-	double YaeroJump = aeroJmpCorrector(SG, bullet, rifle, meteo, options);	
-	double G_f = gravityAccelerFeets(inputs);
+	setup->V0 = V0dueToSensivity(meteo, bullet, options);
+	setup->KoriolisVert = VerticalCoriolis(setup->V0, inputs, options);
+	setup->CCF = ConditionCorrectionFactor(meteo);
+	setup->A0_f = speedOfSoundFeetRatio(meteo);
+	setup->SG = MillersFGS(setup->V0, meteo, bullet, rifle);
+	setup->YaeroJump = aeroJmpCorrector(setup->SG, bullet, rifle, meteo, options);	
+	setup->G_f = gravityAccelerFeets(inputs);
+	setup->lastDist = lastSolverDist(inputs, rifle, options);
 
-	initStartWindComponents(meteo, &windComps);
+	prepareBuffers(ctx, options, req->results);
 
-	double Time = 0;
+	prepareWindTable(meteo, options, &ctx->windTable);
+	windTableAt(&ctx->windTable, 0, &ctx->windComps);
 
-	double Vx1 = convertToFeets(V0);
-	double Vy1, Vz1, W2;
-	Vy1 = Vz1 = W2 = 0;
+	ctx->tangents.integrated = false;
+	ctx->nextExtraShot = 0;
 
-	double V_1 = calculateFullSpeedValue(Vx1, Vy1, Vz1);
-	double M = calculateMach(V_1, A0_f);
-	double H2 = calculateScopeFeetOffset(rifle);
+	state->Time = 0;
 
-	/******************** main ballistic calculation (START) ********************/
-	for (uint16_t i = 0; i <= DIST_RANGE; i++) {
+	state->Vx = convertToFeets(setup->V0);
+	state->Vy = state->Vz = state->W2 = 0;
 
-		defineDragInfoForCDM(i, M, CCF, bullet, rifle, &dragInfo, &calibDists);
-		windComponentsForComplexCase(meteo, &windComps, i);
-		
-		double C4 = (dragInfo.CD * dragInfo.C3 * V_1) / Vx1;
-		double A1_ = C4 * (Vx1 - windComps.Wx);
-		double A2_ = (C4 * (Vy1 - windComps.Wy)) - (G_f / Vx1);
-		double A3_ = C4 * (Vz1 - windComps.Wz);
+	state->V = calculateFullSpeedValue(state->Vx, state->Vy, state->Vz);
+	state->M = calculateMach(state->V, setup->A0_f);
+	state->H2 = calculateScopeFeetOffset(rifle);
+}
 
-		double Vx2 = Vx1 + convertToFeets(A1_);
-		double Vy2 = Vy1 + convertToFeets(A2_);
-		double Vz2 = Vz1 + convertToFeets(A3_);
-		double V_2 = calculateFullSpeedValue(Vx2, Vy2, Vz2);
+void prepareSolverStep(struct SolverContext* ctx, const struct SolverRequest* const req, uint16_t dist, double Mach) {
 
-		//std::cout << i << " CD:" << dragInfo.CD << " C3:" << dragInfo.C3 << " C4:" << C4 << " A1_:" << A1_ 
-		//<< " A2_:" << A2_ << " A3_:" << A3_ << " Vx2:" << Vx2 << " Vy2:" << Vy2 << " Vz2:" << Vz2 << " V_2:" << V_2 <<  std::endl; 
+	defineDragInfoForCDM(dist, Mach, ctx->setup.CCF, req->bullet, req->rifle, &ctx->dragInfo, &ctx->calibDists);
+	windTableAt(&ctx->windTable, dist, &ctx->windComps);
+}
 
+static inline void shotSolution(const struct SolverContext* const ctx, const struct SolverRequest* const req, uint16_t dist, 
+	const struct trajectoryState* const state, double Vprev, struct solveCompactData* OUT solveData, struct terminalData* OUT terminalInfo) {
 
+	double Y = state->H2 / convertToFeets(0.01);				/* elevation in sm (absolute) */
+	double W = state->W2 / convertToFeets(0.01);				/* wind drift in sm */
 
-		M = calculateMach(V_2, A0_f);
+	*solveData = {dist, Y, W, state->Time, DerivationCalculation(ctx->setup.SG, state->Time, req->rifle->twistDir), state->M, 
+		convertFromFeets(ctx->windComps.Wz)};
 
-		double C5 = (dragInfo.CD * dragInfo.C3 * V_2) / Vx2;
-		double A4_ = C5 * (Vx2 - windComps.Wx);
-		double A5_ = (C5 * (Vy2 - windComps.Wy)) - (G_f / Vx2);
-		double A6_ = C5 * (Vz2 - windComps.Wz);
+	double VxDist = convertFromFeets(Vprev);
+	*terminalInfo = {VxDist, state->M, CineticEnergy(VxDist, req->bullet->mass)};
+}
 
-		double Vx3 = Vx1 + convertToFeets(0.5 * (A1_ + A4_));
-		double Vy3 = Vy1 + convertToFeets(0.5 * (A2_ + A5_));
-		double Vz3 = Vz1 + convertToFeets(0.5 * (A3_ + A6_));
-		double V_3 = calculateFullSpeedValue(Vx3, Vy3, Vz3);
-		M = calculateMach(V_3, A0_f);
+static inline void recordShotStep(struct SolverContext* ctx, const struct SolverRequest* const req, uint16_t dist, 
+	const struct trajectoryState* const state, double Vprev) {
 
-		H2 = H2 + convertToFeets((Vy1 + Vy3) / (Vx1 + Vx3));	/* elevation in feets (absolute) */
-		double Y = H2 / convertToFeets(0.01);					/* elevation in sm (absolute) */
-		W2 = W2 + convertToFeets(((Vz1 + Vz3) / (Vx1 + Vx3)));	/* wind drift in feets */
-		double W = W2 / convertToFeets(0.01);					/* wind drift in sm */
-		Time = Time + (convertToFeets(2) / (Vx2 + Vx3));		/* flight time */
+	const struct Rifle* const rifle = req->rifle;
 
-		setZeroingInputs(i, Y, rifle, &zeroData);
+	if (dist == rifle->zeroDistance) {
 
-		if (i == inputs->shotDistance) {
+		double Y = state->H2 / convertToFeets(0.01);				/* elevation in sm (absolute) */
+		setZeroingInputs(dist, Y, rifle, &ctx->dragInfo, &ctx->zeroData);
+	}
 
-			solveData = {i, Y, W, Time, DerivationCalculation(SG, Time, rifle->twistDir), M, convertFromFeets(windComps.Wz)};
-			setSolverOutput(&solveData, solver, BALLISTIC_TABLE_SIZE + 1);
+	if (dist == req->inputs->shotDistance) {
 
-			double VxDist = convertFromFeets(V_1);
-			terminalInfo = {VxDist, M, CineticEnergy(VxDist, bullet->mass)};
+		shotSolution(ctx, req, dist, state, Vprev, &ctx->solveData, &ctx->terminalInfo);
+		setSolverOutput(&ctx->solveData, ctx->solver.data(), ctx->setup.tableSize + 1);
 
-			//Added for barsuk
-			results->vertSmABS = calculateAbsDrop(Y);
-			results->A0 = SpeedOfSoundRaw(meteo);
-		}
+		//Added for barsuk
+		req->results->vertSmABS = calculateAbsDrop(ctx->solveData.Yabs);
+		req->results->A0 = SpeedOfSoundRaw(req->meteo);
+	}
 
-		if(options->BallisticTable == OPTION_YES) {
+	if (dist == pendingExtraShot(ctx)) {
 
-			if (i % TABLE_STEP == 0) {
-				
-				solveData = {i, Y, W, Time, DerivationCalculation(SG, Time, rifle->twistDir), M, convertFromFeets(windComps.Wz)};
-				setSolverOutput(&solveData, solver, i/TABLE_STEP);
-			}	
-		}
+		struct shotCapture* capture = &ctx->extraCaptures[ctx->nextExtraShot++];
+		shotSolution(ctx, req, dist, state, Vprev, &capture->solveData, &capture->terminalInfo);
+	}
+}
 
-		V_1 = V_3; Vx1 = Vx3; Vy1 = Vy3; Vz1 = Vz3;
-		
-	} /******************** main ballistic calculation (END) ********************/
+static inline void recordTableStep(struct SolverContext* ctx, const struct SolverRequest* const req, uint16_t dist, 
+	const struct trajectoryState* const state) {
+
+	double Y = state->H2 / convertToFeets(0.01);					/* elevation in sm (absolute) */
+	double W = state->W2 / convertToFeets(0.01);					/* wind drift in sm */
+
+	ctx->solveData = {dist, Y, W, state->Time, DerivationCalculation(ctx->setup.SG, state->Time, req->rifle->twistDir), state->M, 
+		convertFromFeets(ctx->windComps.Wz)};
+	setSolverOutput(&ctx->solveData, ctx->solver.data(), dist/ctx->setup.tableStep);
+}
 
-	double throwAngle = calculateThrowingAngle(G_f, rifle, bullet, meteo, &zeroData, &dragInfo);
-	addSomeSolutionDataToSolverStruct(KoriolisVert, YaeroJump, throwAngle, inputs, options, bullet, solver, BALLISTIC_TABLE_SIZE + 1, meteo);
-	fillResultStructWithSimpleSolution(bullet, rifle, scope, inputs, &terminalInfo, &calibDists, SG, OUT results);
+void recordSolverStep(struct SolverContext* ctx, const struct SolverRequest* const req, uint16_t dist, 
+	const struct trajectoryState* const state, double Vprev) {
+
+	const uint16_t tableStep = ctx->setup.tableStep;
+
+	recordShotStep(ctx, req, dist, state, Vprev);
+
+	if(req->options->BallisticTable == OPTION_YES) {
+
+		if (dist % tableStep == 0 && dist / tableStep >= rangecardFirstIndex(req->options) && 
+			dist / tableStep <= rangecardLastIndex(req->options)) {
+			
+			recordTableStep(ctx, req, dist, state);
+		}	
+	}
+}
+
+bool solverReachedEnd(const struct SolverContext* const ctx, const struct SolverRequest* const req, uint16_t dist, double Mach) {
+
+	if(dist < ctx->setup.lastDist) {
+		return false;
+	}
+
+	if(req->options->EarlyExit == OPTION_YES && req->options->MachDistances == OPTION_YES) {
+
+		/* Below the lowest threshold no calibration distance changes as long as the speed keeps falling 
+		(a stalled low-speed projectile falling back may speed up again, full-range mode still catches that) */
+		return (uint16_t)(Mach * 100) < deepSubsonicMach07Mach_ || dist >= ctx->setup.range;
+	}
+
+	return true;
+}
+
+static void finalizeSolverRows(struct SolverContext* ctx, const struct SolverRequest* const req, double throwAngle) {
+
+	const struct Meteo* const meteo = req->meteo;
+	const struct Bullet* const bullet = req->bullet;
+	const struct Rifle* const rifle = req->rifle;
+	const struct Scope* const scope = req->scope;
+	const struct Inputs* const inputs = req->inputs;
+	const struct Options* const options = req->options;
+	struct Results* results = req->results;
+
+	const struct solverInvariants* const setup = &ctx->setup;
+	solverUnit* solver = ctx->solver.data();
+	const uint16_t shotIndex = setup->tableSize + 1;
+
+	ctx->throwAngle = throwAngle;
+	addSomeSolutionDataToSolverStruct(setup->KoriolisVert, setup->YaeroJump, throwAngle, inputs, options, bullet, solver, shotIndex, meteo);
+	fillResultStructWithSimpleSolution(solver, shotIndex, bullet, rifle, scope, inputs, &ctx->terminalInfo, &ctx->calibDists, setup->SG, OUT results);
 
 	if(options->BallisticTable == OPTION_YES) {
 		
-		for (uint16_t i = 0; i <= BALLISTIC_TABLE_SIZE; i++) {
+		const uint16_t firstIndex = rangecardFirstIndex(options);
+		const uint16_t lastIndex = rangecardLastIndex(options);
+
+		for (uint16_t i = firstIndex; i <= lastIndex; i++) {
 			
-			addSomeSolutionDataToSolverStruct(KoriolisVert, YaeroJump, throwAngle, inputs, options, bullet, solver, i, meteo);
+			addSomeSolutionDataToSolverStruct(setup->KoriolisVert, setup->YaeroJump, throwAngle, inputs, options, bullet, solver, i, meteo);
 		}
-		fullfillBallisticTable(meteo, bullet, rifle, solver, scope, results);
+		fullfillBallisticTable(meteo, bullet, rifle, solver, scope, firstIndex, lastIndex, results);
 	}
 
 	if(rifle->rollAngle != 0) {
 		if(rifle->rollAngle == -90 || rifle->rollAngle == 90) { 
 
 			if(inputs->shotDistance == rifle->zeroDistance) {
-				calculateSimpleRollAtZeroing(rifle, scope, inputs, results);
+				calculateSimpleRollAtZeroing(rifle, scope, inputs, &ctx->rifleRollData, results);
 			}
 			else {
-				calculateSimpleRollAtFar(rifle, scope, inputs, results);
+				calculateSimpleRollAtFar(rifle, scope, inputs, &ctx->rifleRollData, results);
 			}
 		}
 		else {
-			calculateComplexRoll(rifle, scope, results);
+			calculateComplexRoll(rifle, scope, &ctx->anglesData, results);
+		}
+	}
+}
+
+void finalizeSolver(struct SolverContext* ctx, const struct SolverRequest* const req) {
+
+	const uint16_t shotIndex = ctx->setup.tableSize + 1;
+
+	if(ctx->keepRawRows) {
+		ctx->rawRows.assign(ctx->solver.begin(), ctx->solver.begin() + shotIndex + 1);
+	}
+
+	/* Full-range solves keep BCzero of the last step (matters for multiBC), early exit 
+	takes it at zero distance so it does not depend on where the integration stopped */
+	if(req->options->EarlyExit == OPTION_YES) {
+		ctx->dragInfo.BCzero = ctx->zeroData.BCzero;
+	}
+
+	double throwAngle = calculateThrowingAngle(ctx->zeroCache, ctx->setup.G_f, req->rifle, req->bullet, req->meteo, &ctx->zeroData, &ctx->dragInfo);
+	finalizeSolverRows(ctx, req, throwAngle);
+
+	if(req->options->Sensitivities == OPTION_YES) {
+		finalizeSensitivities(ctx, req, throwAngle);
+	}
+}
+
+void refinalizeSolver(struct SolverContext* ctx, const struct SolverContext* const solved, const struct SolverRequest* const req) {
+
+	/* Everything finalizeSolverRows() reads, the zeroing angle does not depend on Inputs either */
+	ctx->setup = solved->setup;
+	ctx->calibDists = solved->calibDists;
+	ctx->dragInfo = solved->dragInfo;
+	ctx->zeroData = solved->zeroData;
+	ctx->terminalInfo = solved->terminalInfo;
+	ctx->rifleRollData = solved->rifleRollData;
+
+	ctx->setup.KoriolisVert = VerticalCoriolis(ctx->setup.V0, req->inputs, req->options);
+
+	prepareBuffers(ctx, req->options, req->results);
+	std::copy(solved->rawRows.begin(), solved->rawRows.end(), ctx->solver.begin());
+
+	finalizeSolverRows(ctx, req, solved->throwAngle);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Fixed-step hot loop, specialized per precision, drag model, wind type, range card and tracing. The dispatch 
+is done once per request, the loop body has no invariant branches left (aerojump and Coriolis are 
+applied in finalizeSolver() only and do not touch the loop). With PRECISION_FLOAT the trajectory state 
+and the step arithmetic are float, drag lookups and the recorded outputs stay double. The step is a chain 
+of dependent adds and multiplies of the same latency in float and double, so the float loop only pays 
+off where double is emulated in software */
+
+enum dragKind {
+
+	PLAIN_DRAG = 0,		/* G1, G7, Gs */
+	CDM_DRAG = 1,		/* custom drag function on top of G7 */
+	MBC_DRAG = 2,		/* multiBC on top of G1 or G7 */
+};
+
+struct fixedStepSetup { /* per request values of the loop */
+
+	int kind;
+	const double* table;		/* drag table, NULL - DragCoefficient() */
+	uint8_t tableFunction;
+	double caliberInInch;		/* CDM */
+	double C3;					/* plain G */
+	uint32_t firstRow;			/* range-card distances, meters */
+	uint32_t lastRow;
+};
+
+typedef void (*fixedStepLoop)(struct SolverContext*, const struct SolverRequest* const, const struct fixedStepSetup* const, 
+	struct trajectoryState*, struct trajectoryTrace*);
+
+static struct fixedStepSetup prepareFixedStep(struct SolverContext* ctx, const struct SolverRequest* const req) {
+
+	const struct Bullet* const bullet = req->bullet;
+	struct fixedStepSetup fs;
+
+	if(bullet->dragFunction == CDM) {
+
+		fs.kind = CDM_DRAG;
+		fs.tableFunction = G7;
+	}
+	else if(bullet->dragFunction == MBCG1 || bullet->dragFunction == MBCG7) {
+
+		fs.kind = MBC_DRAG;
+		fs.tableFunction = bullet->dragFunction == MBCG1 ? G1 : G7;
+	}
+	else {
+
+		fs.kind = PLAIN_DRAG;
+		fs.tableFunction = bullet->dragFunction;
+	}
+
+	fs.table = dragTableFor(fs.tableFunction);
+	fs.caliberInInch = bullet->caliber * mmToInch;
+	fs.C3 = calculateC3(ctx->setup.CCF, bullet->BC);
+	fs.firstRow = rangecardFirstIndex(req->options) * ctx->setup.tableStep;
+	fs.lastRow = rangecardLastIndex(req->options) * ctx->setup.tableStep;
+
+	if(fs.kind == PLAIN_DRAG) {
+
+		ctx->dragInfo.C3 = fs.C3;
+		ctx->dragInfo.BCzero = bullet->BC;
+	}
+
+	return fs;
+}
+
+/* defineDragInfo() for one kind */
+template<int Kind>
+static inline __attribute__((always_inline)) void stepDragInfo(const struct fixedStepSetup* const fs, uint16_t dist, double Mach, double CCF, 
+	const struct Bullet* const bullet, const struct Rifle* const rifle, struct dragAndBCInfo* dragInfo) {
+
+	dragInfo->CD = DragCoefficientFromTable(fs->table, fs->tableFunction, Mach);
+
+	if constexpr (Kind == CDM_DRAG) {
+
+		double i_7 = DragCoefficientForCDM(bullet, Mach) / dragInfo->CD;
+		double fakeBC = calculateFakeG7BC(bullet->mass, fs->caliberInInch, i_7);
+		dragInfo->C3 = calculateC3(CCF, fakeBC);
+
+		if(dist == rifle->zeroDistance) {
+			dragInfo->BCzero = fakeBC;
 		}
 	}
+	else if constexpr (Kind == MBC_DRAG) {
+
+		double BC = BCforMBCCase(bullet, Mach);
+
+		dragInfo->C3 = calculateC3(CCF, BC);
+		dragInfo->BCzero = BC;
+	}
+}
+
+/* Drag factor of the step with its derivatives: the slope by Mach is a central difference of stepDragInfo() 
+(exact between table points), every BC scaled by 1% scales the drag by 1 / 1.01 */
+template<int Kind>
+static inline sensitiveReal sensitiveDrag(const struct fixedStepSetup* const fs, uint16_t dist, const sensitiveReal& Mach, double CCF, 
+	const struct Bullet* const bullet, const struct Rifle* const rifle, const struct dragAndBCInfo* const dragInfo) {
+
+	struct dragAndBCInfo probe = *dragInfo;
+
+	stepDragInfo<Kind>(fs, dist, Mach.v + SENS_MACH_STEP, CCF, bullet, rifle, &probe);
+	const double above = probe.CD * probe.C3;
+
+	stepDragInfo<Kind>(fs, dist, Mach.v - SENS_MACH_STEP, CCF, bullet, rifle, &probe);
+	const double below = probe.CD * probe.C3;
+
+	sensitiveReal K = chained(Mach, dragInfo->CD * dragInfo->C3, (above - below) / (2 * SENS_MACH_STEP));
+	K.d[SENS_BC] -= 0.01 * K.v;
+
+	return K;
+}
+
+static void recordTangents(struct SolverContext* ctx, const struct SolverRequest* const req, uint16_t dist, 
+	const sensitiveReal& H2, const sensitiveReal& W2, const sensitiveReal& Time, const sensitiveReal& M, double Mprev, 
+	const struct trajectoryState* const state) {
+
+	struct sensitivityTangents* tangents = &ctx->tangents;
+	const double sm = convertToFeets(0.01);
+
+	if(dist == req->rifle->zeroDistance) {
+
+		for(int k = 0; k < SENS_RANGE; k++) {
+			tangents->Yzero[k] = H2.d[k] / sm;
+		}
+	}
+
+	if(dist == req->inputs->shotDistance || dist == pendingExtraShot(ctx)) {
+
+		/* Called before recordShotStep(), the extra shot is still pending */
+		if(dist != req->inputs->shotDistance) {
+			tangents = &ctx->extraCaptures[ctx->nextExtraShot].tangents;
+		}
+
+		for(int k = 0; k < SENS_RANGE; k++) {
+
+			tangents->Yabs[k] = H2.d[k] / sm;
+			tangents->W[k] = W2.d[k] / sm;
+			tangents->Time[k] = Time.d[k];
+			tangents->Mach[k] = M.d[k];
+		}
+
+		tangents->MachRate = M.v - Mprev;
+
+		tangents->shot = *state;
+		tangents->windSpeed = convertFromFeets(ctx->windComps.Wz);
+		tangents->integrated = true;
+	}
+}
+
+template<typename Real, int Kind, int8_t Wind, bool Rangecard, bool Traced>
+static void integrateFixedStep(struct SolverContext* ctx, const struct SolverRequest* const req, const struct fixedStepSetup* const fs, 
+	struct trajectoryState* state, struct trajectoryTrace* trace) {
+
+	static_assert(!Traced || std::is_same<Real, double>::value, "traces are replayed in double");
+
+	constexpr bool Sensitive = std::is_same<Real, sensitiveReal>::value;
+
+	const Real G_f = ctx->setup.G_f;
+	const Real A0_f = ctx->setup.A0_f;
+	const Real STEP = STEP_f;
+	const Real HALF = 0.5;
+	const double CCF = ctx->setup.CCF;
+	const uint16_t lastDist = ctx->setup.lastDist;
+	const uint16_t zeroDistance = req->rifle->zeroDistance;
+	const uint16_t shotDistance = req->inputs->shotDistance;
+	uint16_t nextShot = pendingExtraShot(ctx);
+	uint32_t nextRow = fs->firstRow;
+
+	Real Vx = state->Vx, Vy = state->Vy, Vz = state->Vz, V = state->V;
+	Real M = state->M, H2 = state->H2, W2 = state->W2, Time = state->Time;
+
+	if constexpr (Sensitive) {
+
+		/* V0 is the only input seeded in the state, BC and wind come in with the drag and the wind of every step */
+		Vx.d[SENS_V0] = convertToFeets(ctx->tangents.V0rate);
+		V = calculateFullSpeedValue(Vx, Vy, Vz);
+		M = calculateMach(V, A0_f);
+	}
+
+	/******************** main ballistic calculation (START) ********************/
+	for (uint16_t i = 0; i <= ctx->setup.range; i++) {
+
+		stepDragInfo<Kind>(fs, i, realValue(M), CCF, req->bullet, req->rifle, &ctx->dragInfo);
+		markCalibrationDistances(i, realValue(M), &ctx->calibDists);
+
+		if constexpr (Wind == COMPLEX_CASE) {
+			windTableAt(&ctx->windTable, i, &ctx->windComps);
+		}
+
+		Real K = ctx->dragInfo.CD * ctx->dragInfo.C3;
+		const Real Wx = ctx->windComps.Wx;
+		const Real Wy = ctx->windComps.Wy;
+		Real Wz = ctx->windComps.Wz;
+
+		if constexpr (Sensitive) {
+
+			K = sensitiveDrag<Kind>(fs, i, M, CCF, req->bullet, req->rifle, &ctx->dragInfo);
+			Wz.d[SENS_WIND] = -STEP_f;		/* see windSegmentComponents() */
+		}
+
+		Real V_1 = V; 
+		Real Vx1 = Vx; 
+		Real Vy1 = Vy; 
+		Real Vz1 = Vz;
+		
+		Real C4 = (K * V_1) / Vx1;
+		Real A1_ = C4 * (Vx1 - Wx);
+		Real A2_ = (C4 * (Vy1 - Wy)) - (G_f / Vx1);
+		Real A3_ = C4 * (Vz1 - Wz);
+
+		Real Vx2 = Vx1 + A1_ * STEP;
+		Real Vy2 = Vy1 + A2_ * STEP;
+		Real Vz2 = Vz1 + A3_ * STEP;
+		Real V_2 = calculateFullSpeedValue(Vx2, Vy2, Vz2);
+
+		Real C5 = (K * V_2) / Vx2;
+		Real A4_ = C5 * (Vx2 - Wx);
+		Real A5_ = (C5 * (Vy2 - Wy)) - (G_f / Vx2);
+		Real A6_ = C5 * (Vz2 - Wz);
+
+		Real Vx3 = Vx1 + (HALF * (A1_ + A4_)) * STEP;
+		Real Vy3 = Vy1 + (HALF * (A2_ + A5_)) * STEP;
+		Real Vz3 = Vz1 + (HALF * (A3_ + A6_)) * STEP;
+		Real V_3 = calculateFullSpeedValue(Vx3, Vy3, Vz3);
+		M = calculateMach(V_3, A0_f);
+
+		H2 = H2 + ((Vy1 + Vy3) / (Vx1 + Vx3)) * STEP;		/* elevation in feets (absolute) */
+		W2 = W2 + ((Vz1 + Vz3) / (Vx1 + Vx3)) * STEP;		/* wind drift in feets */
+		Time = Time + ((2 * STEP) / (Vx2 + Vx3));			/* flight time */
+
+		V = V_3; Vx = Vx3; Vy = Vy3; Vz = Vz3;
+
+		if constexpr (Traced) {
+			trace->steps.push_back({H2, Time, M, V_1, C4, C5, Vx1 + Vx3});
+		}
+
+		const bool shotRow = (i == zeroDistance || i == shotDistance || i == nextShot);
+		bool tableRow = false;
+
+		if constexpr (Rangecard) {
+			tableRow = (i == nextRow && nextRow <= fs->lastRow);
+		}
+
+		if(shotRow || tableRow) {
+
+			const struct trajectoryState step = {realValue(Vx), realValue(Vy), realValue(Vz), realValue(V), realValue(M), 
+				realValue(H2), realValue(W2), realValue(Time)};
+
+			if(shotRow) {
+
+				if constexpr (Sensitive) {
+					recordTangents(ctx, req, i, H2, W2, Time, M, realValue(V_1 / A0_f), &step);
+				}
+
+				recordShotStep(ctx, req, i, &step, realValue(V_1));
+				nextShot = pendingExtraShot(ctx);
+			}
+
+			if(tableRow) {
+
+				recordTableStep(ctx, req, i, &step);
+				nextRow += ctx->setup.tableStep;
+			}
+		}
+
+		if(i >= lastDist && solverReachedEnd(ctx, req, i, realValue(M))) {
+			break;
+		}
+		
+	} /******************** main ballistic calculation (END) ********************/
+
+	*state = {realValue(Vx), realValue(Vy), realValue(Vz), realValue(V), realValue(M), realValue(H2), realValue(W2), realValue(Time)};
+}
+
+template<typename Real, int Kind, int8_t Wind, bool Rangecard>
+static fixedStepLoop pickTraced(bool traced) {
+
+	if constexpr (std::is_same<Real, double>::value) {
+		return traced ? integrateFixedStep<Real, Kind, Wind, Rangecard, true> : integrateFixedStep<Real, Kind, Wind, Rangecard, false>;
+	}
+	else {
+		return integrateFixedStep<Real, Kind, Wind, Rangecard, false>;
+	}
+}
+
+template<typename Real, int Kind, int8_t Wind>
+static fixedStepLoop pickRangecard(bool rangecard, bool traced) {
+
+	return rangecard ? pickTraced<Real, Kind, Wind, true>(traced) : pickTraced<Real, Kind, Wind, false>(traced);
+}
+
+template<typename Real, int Kind>
+static fixedStepLoop pickWind(int8_t wind, bool rangecard, bool traced) {
+
+	return wind == COMPLEX_CASE ? pickRangecard<Real, Kind, COMPLEX_CASE>(rangecard, traced) : 
+		pickRangecard<Real, Kind, SIMPLE_CASE>(rangecard, traced);
+}
+
+template<typename Real>
+static fixedStepLoop pickKind(int kind, int8_t wind, bool rangecard, bool traced) {
+
+	switch(kind) {
+
+		case CDM_DRAG: return pickWind<Real, CDM_DRAG>(wind, rangecard, traced);
+		case MBC_DRAG: return pickWind<Real, MBC_DRAG>(wind, rangecard, traced);
+		default: return pickWind<Real, PLAIN_DRAG>(wind, rangecard, traced);
+	}
+}
+
+static fixedStepLoop pickFixedStepLoop(uint8_t precision, int kind, int8_t wind, bool rangecard, bool traced, bool sensitive) {
+
+	if(sensitive) {
+		return pickKind<sensitiveReal>(kind, wind, rangecard, false);
+	}
+
+	return precision == PRECISION_FLOAT ? pickKind<float>(kind, wind, rangecard, traced) : pickKind<double>(kind, wind, rangecard, traced);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void trajectorySolver (struct SolverContext* ctx, const struct Meteo* const meteo, const struct Bullet* const bullet, 
+	const struct Rifle* const rifle, const struct Scope* const scope, const struct Inputs* const inputs, 
+	const struct Options* const options, struct Results* OUT results) {
+
+	const struct SolverRequest req {meteo, bullet, rifle, scope, inputs, options, results};
+	const bool sensitive = options->Sensitivities == OPTION_YES;
+
+	if(options->Integrator == ADAPTIVE_STEP && !sensitive) {
+
+		trajectorySolverAdaptive(ctx, &req);
+		return;
+	}
+
+	struct trajectoryState state;
+
+	prepareSolver(ctx, &req, &state);
+
+	/* Same profile and atmosphere as a traced shot -> only the lateral channel is re-integrated */
+	std::string traceKey;
+	std::shared_ptr<trajectoryTrace> trace;
+
+	if(ctx->traceCache && options->Precision != PRECISION_FLOAT && !sensitive) {
+
+		traceKey = trajectoryTraceCache::makeKey(meteo, bullet, rifle, options, inputs->latitude, ctx->setup.lastDist, ctx->setup.range);
+
+		if(replayTrace(ctx, &req, traceKey, &state)) {
+
+			finalizeSolver(ctx, &req);
+			return;
+		}
+
+		trace = std::make_shared<trajectoryTrace>();
+		trace->steps.reserve(ctx->setup.lastDist + 1);
+	}
+
+	const struct fixedStepSetup fs = prepareFixedStep(ctx, &req);
+	const fixedStepLoop loop = pickFixedStepLoop(options->Precision, fs.kind, meteo->WindType, options->BallisticTable == OPTION_YES, trace != nullptr, 
+		sensitive);
+
+	if(sensitive) {
+		prepareSensitivities(ctx, &req);
+	}
+
+	loop(ctx, &req, &fs, &state, trace.get());
+
+	if(trace) {
+		storeTrace(ctx, &req, traceKey, trace);
+	}
+
+	finalizeSolver(ctx, &req);
+}
+
+static void finalizeExtraShot(struct SolverContext* ctx, const struct SolverRequest* const req, const struct shotCapture* const capture) {
+
+	prepareBuffers(ctx, req->options, req->results);
+
+	ctx->solveData = capture->solveData;
+	ctx->terminalInfo = capture->terminalInfo;
+	setSolverOutput(&ctx->solveData, ctx->solver.data(), ctx->setup.tableSize + 1);
+
+	req->results->vertSmABS = calculateAbsDrop(ctx->solveData.Yabs);
+	req->results->A0 = SpeedOfSoundRaw(req->meteo);
+
+	/* Zeroing and calibration distances are of the whole integration */
+	finalizeSolverRows(ctx, req, ctx->throwAngle);
+
+	if(req->options->Sensitivities == OPTION_YES) {
+
+		/* Seeds and the zeroing are of the whole integration */
+		struct sensitivityTangents tangents = capture->tangents;
+		tangents.V0rate = ctx->tangents.V0rate;
+		std::copy(ctx->tangents.Yzero, ctx->tangents.Yzero + SENS_RANGE, tangents.Yzero);
+
+		ctx->tangents = tangents;
+		finalizeSensitivities(ctx, req, ctx->throwAngle);
+	}
+}
+
+void trajectorySolverAt(struct SolverContext* ctx, const struct Meteo* const meteo, const struct Bullet* const bullet, 
+	const struct Rifle* const rifle, const struct Scope* const scope, const struct Inputs* const inputs, 
+	const struct Options* const options, const uint16_t dists[], size_t count, struct Results* OUT results) {
+
+	if(count == 0) {
+		return;
+	}
+
+	/* The farthest distance is the shot of the integration, the others are captured on the way */
+	const size_t farthest = std::max_element(dists, dists + count) - dists;
+
+	ctx->extraShots.clear();
+
+	for(size_t k = 0; k < count; k++) {
+
+		if(dists[k] != dists[farthest]) {
+			ctx->extraShots.push_back(dists[k]);
+		}
+	}
+
+	std::sort(ctx->extraShots.begin(), ctx->extraShots.end());
+	ctx->extraShots.erase(std::unique(ctx->extraShots.begin(), ctx->extraShots.end()), ctx->extraShots.end());
+	ctx->extraCaptures.assign(ctx->extraShots.size(), shotCapture{});
+
+	struct Inputs shotInputs = *inputs;
+	shotInputs.shotDistance = dists[farthest];
+
+	trajectorySolver(ctx, meteo, bullet, rifle, scope, &shotInputs, options, OUT &results[farthest]);
+
+	struct Options extraOptions = *options;
+	extraOptions.BallisticTable = OPTION_NO;
+
+	for(size_t k = 0; k < count; k++) {
+
+		if(dists[k] == dists[farthest]) {
+
+			results[k] = results[farthest];
+			continue;
+		}
+
+		const size_t extra = std::lower_bound(ctx->extraShots.begin(), ctx->extraShots.end(), dists[k]) - ctx->extraShots.begin();
+
+		shotInputs.shotDistance = dists[k];
+		const struct SolverRequest req {meteo, bullet, rifle, scope, &shotInputs, &extraOptions, &results[k]};
+
+		finalizeExtraShot(ctx, &req, &ctx->extraCaptures[extra]);
+	}
+
+	ctx->extraShots.clear();
+}
+
+void trajectorySolver (const struct Meteo* const meteo, const struct Bullet* const bullet, const struct Rifle* const rifle, 
+	const struct Scope* const scope, const struct Inputs* const inputs, const struct Options* const options, struct Results* OUT results) {
+
+	static thread_local struct SolverContext ctx;
+	trajectorySolver(&ctx, meteo, bullet, rifle, scope, inputs, options, OUT results);
 }
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "trajectory_solver_adaptive.h"
+
+#define ADAPTIVE_DIM 6
+
+enum adaptiveComponents {
+
+	AD_VX = 0,
+	AD_VY,
+	AD_VZ,
+	AD_H2,
+	AD_W2,
+	AD_TIME,
+};
+
+static const double adaptiveAtol[ADAPTIVE_DIM] = {
+	
+	ADAPTIVE_ATOL_SPEED, ADAPTIVE_ATOL_SPEED, ADAPTIVE_ATOL_SPEED, 
+	ADAPTIVE_ATOL_DIST, ADAPTIVE_ATOL_DIST, ADAPTIVE_ATOL_TIME
+};
+
+/* Derivatives over distance (per meter) at the given Mach drag and wind, 
+same equations as the fixed-step loop in trajectorySolver() */
+static void trajectoryDerivatives(const struct SolverContext* const ctx, const struct SolverRequest* const req, 
+	uint16_t dist, const struct windPortion* const wind, const double y[], double OUT dy[]) {
+
+	const double Vx = y[AD_VX];
+	const double Vy = y[AD_VY];
+	const double Vz = y[AD_VZ];
+	const double V = sqrt((Vx * Vx) + (Vy * Vy) + (Vz * Vz));
+
+	struct dragAndBCInfo dragInfo = ctx->dragInfo;
+	defineDragInfo(dist, V * ctx->setup.A0_f, ctx->setup.CCF, req->bullet, req->rifle, &dragInfo);
+
+	const double C = (dragInfo.CD * dragInfo.C3 * V) / Vx;
+
+	dy[AD_VX] = convertToFeets(C * (Vx - wind->Wx));
+	dy[AD_VY] = convertToFeets((C * (Vy - wind->Wy)) - (ctx->setup.G_f / Vx));
+	dy[AD_VZ] = convertToFeets(C * (Vz - wind->Wz));
+	dy[AD_H2] = convertToFeets(Vy / Vx);
+	dy[AD_W2] = convertToFeets(Vz / Vx);
+	dy[AD_TIME] = convertToFeets(1.0 / Vx);
+}
+
+/* Cubic Hermite interpolation over the accepted step [x0, x0 + h] */
+static void denseOutput(double x0, double h, const double y0[], const double y1[], const double k1[], const double k4[], 
+	double x, double A0_f, struct OUT trajectoryState* state) {
+
+	const double t = (x - x0) / h;
+	const double t2 = t * t;
+	const double t3 = t2 * t;
+
+	const double h00 = 2 * t3 - 3 * t2 + 1;
+	const double h10 = t3 - 2 * t2 + t;
+	const double h01 = -2 * t3 + 3 * t2;
+	const double h11 = t3 - t2;
+
+	double y[ADAPTIVE_DIM];
+
+	for (int c = 0; c < ADAPTIVE_DIM; c++) {
+		y[c] = h00 * y0[c] + h10 * h * k1[c] + h01 * y1[c] + h11 * h * k4[c];
+	}
+
+	state->Vx = y[AD_VX];
+	state->Vy = y[AD_VY];
+	state->Vz = y[AD_VZ];
+	state->V = sqrt((state->Vx * state->Vx) + (state->Vy * state->Vy) + (state->Vz * state->Vz));
+	state->M = state->V * A0_f;
+	state->H2 = y[AD_H2];
+	state->W2 = y[AD_W2];
+	state->Time = y[AD_TIME];
+}
+
+/* Next distance where complex wind changes, the step must not cross it */
+static double nextWindBoundary(const struct windTable* const table, double x, double xEnd) {
+
+	double boundary = xEnd;
+
+	for (int i = 1; i < table->count; i++) {
+		
+		double windDist = table->segments[i].from;
+
+		if(windDist > x && windDist < boundary) {
+			boundary = windDist;
+		}
+	}
+
+	return boundary;
+}
+
+/* Fixed-step bookkeeping for metre marks in (x0, x1]: state at mark m is recorded 
+under distance m - 1, calibration distances use Mach at m (as trajectorySolver() does). 
+Returns true once solverReachedEnd() */
+static bool recordMarks(struct SolverContext* ctx, const struct SolverRequest* const req, double x0, double h, 
+	const double y0[], const double y1[], const double k1[], const double k4[], uint16_t* nextMark, double* Vprev) {
+
+	const uint16_t zeroDistance = req->rifle->zeroDistance;
+	const uint16_t shotDistance = req->inputs->shotDistance;
+	const uint16_t range = ctx->setup.range;
+
+	while (*nextMark <= range + 1 && *nextMark <= x0 + h) {
+
+		const uint16_t m = *nextMark;
+		const uint16_t dist = m - 1;
+
+		struct trajectoryState state;
+		denseOutput(x0, h, y0, y1, k1, k4, m, ctx->setup.A0_f, &state);
+
+		if(m <= range) {
+
+			markCalibrationDistances(m, state.M, &ctx->calibDists);
+
+			if(m == zeroDistance || m == range) {
+				defineDragInfo(m, state.M, ctx->setup.CCF, req->bullet, req->rifle, &ctx->dragInfo);
+			}
+		}
+
+		if(dist == shotDistance || dist == pendingExtraShot(ctx) || dist % ctx->setup.tableStep == 0) {
+			windTableAt(&ctx->windTable, dist, &ctx->windComps);
+		}
+
+		recordSolverStep(ctx, req, dist, &state, *Vprev);
+
+		*Vprev = state.V;
+		(*nextMark)++;
+
+		if(solverReachedEnd(ctx, req, dist, state.M)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void trajectorySolverAdaptive(struct SolverContext* ctx, const struct SolverRequest* const req) {
+
+	struct trajectoryState state;
+	prepareSolver(ctx, req, &state);
+
+	/* Mark 0 is the muzzle, as in the fixed-step loop */
+	markCalibrationDistances(0, state.M, &ctx->calibDists);
+	
+	if(req->rifle->zeroDistance == 0) {
+		defineDragInfo(0, state.M, ctx->setup.CCF, req->bullet, req->rifle, &ctx->dragInfo);
+	}
+
+	double y[ADAPTIVE_DIM] = {state.Vx, state.Vy, state.Vz, state.H2, state.W2, state.Time};
+	double y1[ADAPTIVE_DIM], yt[ADAPTIVE_DIM];
+	double k1[ADAPTIVE_DIM], k2[ADAPTIVE_DIM], k3[ADAPTIVE_DIM], k4[ADAPTIVE_DIM];
+
+	const struct Options* const options = req->options;
+	const bool machLimited = (options->EarlyExit == OPTION_YES && options->MachDistances == OPTION_YES);
+	const double xEnd = machLimited ? ctx->setup.range + 1 : ctx->setup.lastDist + 1;
+	bool reachedEnd = false;
+
+	double x = 0;
+	double h = ADAPTIVE_FIRST_STEP;
+	double Vprev = state.V;
+	uint16_t nextMark = 1;
+
+	struct windPortion wind = ctx->windComps;
+	uint16_t windDist = 0;
+
+	/* Interpolated wind changes inside a step, it is taken at every stage then */
+	const bool windRamps = (req->meteo->WindType == COMPLEX_CASE && options->WindInterpolation == OPTION_YES);
+	struct windPortion stageWinds[3];
+	const struct windPortion* w2 = &wind;
+	const struct windPortion* w3 = &wind;
+	const struct windPortion* w4 = &wind;
+
+	trajectoryDerivatives(ctx, req, 0, &wind, y, k1);
+
+	while (x < xEnd && !reachedEnd) {
+
+		/* stepwise wind is taken at the step start and kept over the step */
+		const uint16_t dist = (uint16_t)x;
+		
+		if(dist != windDist && req->meteo->WindType == COMPLEX_CASE && !windRamps) {
+
+			struct windPortion newWind;
+			windTableAt(&ctx->windTable, dist, &newWind);
+
+			if(newWind.Wx != wind.Wx || newWind.Wy != wind.Wy || newWind.Wz != wind.Wz) {
+
+				wind = newWind;
+				trajectoryDerivatives(ctx, req, dist, &wind, y, k1);
+			}
+			windDist = dist;
+		}
+
+		const double boundary = nextWindBoundary(&ctx->windTable, x, xEnd);
+
+		if(x + h > boundary) {
+			h = boundary - x;
+		}
+
+		if(windRamps) {
+
+			windTableAt(&ctx->windTable, (uint16_t)(x + 0.5 * h), &stageWinds[0]);
+			windTableAt(&ctx->windTable, (uint16_t)(x + 0.75 * h), &stageWinds[1]);
+			windTableAt(&ctx->windTable, (uint16_t)(x + h), &stageWinds[2]);
+
+			w2 = &stageWinds[0];
+			w3 = &stageWinds[1];
+			w4 = &stageWinds[2];
+		}
+
+		for (int c = 0; c < ADAPTIVE_DIM; c++) yt[c] = y[c] + 0.5 * h * k1[c];
+		trajectoryDerivatives(ctx, req, dist, w2, yt, k2);
+
+		for (int c = 0; c < ADAPTIVE_DIM; c++) yt[c] = y[c] + 0.75 * h * k2[c];
+		trajectoryDerivatives(ctx, req, dist, w3, yt, k3);
+
+		for (int c = 0; c < ADAPTIVE_DIM; c++) y1[c] = y[c] + h * ((2.0 / 9.0) * k1[c] + (1.0 / 3.0) * k2[c] + (4.0 / 9.0) * k3[c]);
+		trajectoryDerivatives(ctx, req, dist, w4, y1, k4);
+
+		double err = 0;
+
+		for (int c = 0; c < ADAPTIVE_DIM; c++) {
+
+			double e = h * ((-5.0 / 72.0) * k1[c] + (1.0 / 12.0) * k2[c] + (1.0 / 9.0) * k3[c] - (1.0 / 8.0) * k4[c]);
+			double sc = adaptiveAtol[c] + ADAPTIVE_RTOL * fmax(fabs(y[c]), fabs(y1[c]));
+			err = fmax(err, fabs(e) / sc);
+		}
+
+		/* fmax/fmin drop NaN, so a broken step shrinks down to ADAPTIVE_MIN_STEP */
+		const double factor = fmin(5.0, fmax(0.2, 0.9 * pow(err, -1.0 / 3.0)));
+
+		if(err <= 1.0 || h <= ADAPTIVE_MIN_STEP) {
+
+			reachedEnd = recordMarks(ctx, req, x, h, y, y1, k1, k4, &nextMark, &Vprev);
+
+			x += h;
+			memcpy(y, y1, sizeof(y));
+			memcpy(k1, k4, sizeof(k1));		/* FSAL */
+		}
+
+		h = fmin(ADAPTIVE_MAX_STEP, fmax(ADAPTIVE_MIN_STEP, h * factor));
+	}
+
+	finalizeSolver(ctx, req);
+}
@@ -0,0 +1,224 @@
+#include "trajectory_solver_lockstep.h"
+
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON) || defined(__aarch64__))
+#define LOCKSTEP_SIMD
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LOCKSTEP_AVX2_DISPATCH
+#endif
+
+#if defined LOCKSTEP_SIMD
+
+typedef double lanes4_t __attribute__((vector_size(4 * sizeof(double))));
+typedef double lanes8_t __attribute__((vector_size(8 * sizeof(double))));
+
+template<typename lanes_t>
+static inline __attribute__((always_inline)) void fullSpeedLanes(const lanes_t& Vx, const lanes_t& Vy, const lanes_t& Vz, 
+	lanes_t& OUT V) {
+
+	const int LANES = sizeof(lanes_t) / sizeof(double);
+
+	V = (Vx * Vx) + (Vy * Vy) + (Vz * Vz);
+
+	for (int l = 0; l < LANES; l++) {
+		V[l] = sqrt(V[l]);	/* no errno here (see CMakeLists.txt), so it maps to vector sqrt */
+	}
+}
+
+template<typename lanes_t>
+static inline __attribute__((always_inline)) void integrateLanes(struct SolverContext* const ctxs[],
+	const struct SolverRequest requests[], int count) {
+
+	const int LANES = sizeof(lanes_t) / sizeof(double);
+
+	struct trajectoryState state[LANES];
+	bool reachedEnd[LANES] = {};
+	int lanesLeft = count;
+	lanes_t Vx, Vy, Vz, V, H2, W2, Time;
+	lanes_t K, Wx, Wy, Wz, G_f, A0_f;
+
+	for (int l = 0; l < count; l++) {
+
+		prepareSolver(ctxs[l], &requests[l], &state[l]);
+	}
+
+	/* Spare lanes repeat lane 0, their results are dropped */
+	for (int l = 0; l < LANES; l++) {
+
+		const int src = l < count ? l : 0;
+
+		Vx[l] = state[src].Vx;
+		Vy[l] = state[src].Vy;
+		Vz[l] = state[src].Vz;
+		V[l] = state[src].V;
+		H2[l] = state[src].H2;
+		W2[l] = state[src].W2;
+		Time[l] = state[src].Time;
+		G_f[l] = ctxs[src]->setup.G_f;
+		A0_f[l] = ctxs[src]->setup.A0_f;
+		K[l] = Wx[l] = Wy[l] = Wz[l] = 0;
+	}
+
+	/* Every lane stops at its own range (solverReachedEnd()) */
+	uint16_t range = 0;
+
+	for (int l = 0; l < count; l++) {
+		range = ctxs[l]->setup.range > range ? ctxs[l]->setup.range : range;
+	}
+
+	/******************** main ballistic calculation (START) ********************/
+	for (uint16_t i = 0; i <= range; i++) {
+
+		for (int l = 0; l < count; l++) {
+
+			if(reachedEnd[l]) {
+				continue;
+			}
+
+			prepareSolverStep(ctxs[l], &requests[l], i, state[l].M);
+
+			K[l] = ctxs[l]->dragInfo.CD * ctxs[l]->dragInfo.C3;
+			Wx[l] = ctxs[l]->windComps.Wx;
+			Wy[l] = ctxs[l]->windComps.Wy;
+			Wz[l] = ctxs[l]->windComps.Wz;
+		}
+
+		const lanes_t Vx1 = Vx, Vy1 = Vy, Vz1 = Vz, V_1 = V;
+
+		lanes_t C4 = (K * V_1) / Vx1;
+		lanes_t A1_ = C4 * (Vx1 - Wx);
+		lanes_t A2_ = (C4 * (Vy1 - Wy)) - (G_f / Vx1);
+		lanes_t A3_ = C4 * (Vz1 - Wz);
+
+		lanes_t Vx2 = Vx1 + A1_ * STEP_f;
+		lanes_t Vy2 = Vy1 + A2_ * STEP_f;
+		lanes_t Vz2 = Vz1 + A3_ * STEP_f;
+		lanes_t V_2;
+		fullSpeedLanes(Vx2, Vy2, Vz2, V_2);
+
+		lanes_t C5 = (K * V_2) / Vx2;
+		lanes_t A4_ = C5 * (Vx2 - Wx);
+		lanes_t A5_ = (C5 * (Vy2 - Wy)) - (G_f / Vx2);
+		lanes_t A6_ = C5 * (Vz2 - Wz);
+
+		Vx = Vx1 + (0.5 * (A1_ + A4_)) * STEP_f;
+		Vy = Vy1 + (0.5 * (A2_ + A5_)) * STEP_f;
+		Vz = Vz1 + (0.5 * (A3_ + A6_)) * STEP_f;
+		fullSpeedLanes(Vx, Vy, Vz, V);
+
+		H2 = H2 + ((Vy1 + Vy) / (Vx1 + Vx)) * STEP_f;		/* elevation in feets (absolute) */
+		W2 = W2 + ((Vz1 + Vz) / (Vx1 + Vx)) * STEP_f;		/* wind drift in feets */
+		Time = Time + ((2 * STEP_f) / (Vx2 + Vx));			/* flight time */
+
+		lanes_t M = V * A0_f;
+
+		for (int l = 0; l < count; l++) {
+
+			if(reachedEnd[l]) {
+				continue;
+			}
+
+			state[l] = {Vx[l], Vy[l], Vz[l], V[l], M[l], H2[l], W2[l], Time[l]};
+			recordSolverStep(ctxs[l], &requests[l], i, &state[l], V_1[l]);
+
+			if(solverReachedEnd(ctxs[l], &requests[l], i, state[l].M)) {
+
+				reachedEnd[l] = true;
+				lanesLeft--;
+			}
+		}
+
+		if(lanesLeft == 0) {
+			break;
+		}
+
+	} /******************** main ballistic calculation (END) ********************/
+
+	for (int l = 0; l < count; l++) {
+
+		finalizeSolver(ctxs[l], &requests[l]);
+	}
+}
+
+static void integrateLanes4(struct SolverContext* const ctxs[], const struct SolverRequest requests[], int count) {
+
+	integrateLanes<lanes4_t>(ctxs, requests, count);
+}
+
+#if defined LOCKSTEP_AVX2_DISPATCH
+__attribute__((target("avx2")))
+static void integrateLanes8(struct SolverContext* const ctxs[], const struct SolverRequest requests[], int count) {
+
+	integrateLanes<lanes8_t>(ctxs, requests, count);
+}
+#endif
+
+#endif /* LOCKSTEP_SIMD */
+
+int lockstepLanes(void) {
+
+#if defined LOCKSTEP_SIMD
+#if defined LOCKSTEP_AVX2_DISPATCH
+	static const int lanes = __builtin_cpu_supports("avx2") ? 8 : 4;
+	return lanes;
+#else
+	return 4;
+#endif
+#else
+	return 1;
+#endif
+}
+
+void trajectorySolverLockstep(struct SolverContext* const ctxs[], const struct SolverRequest requests[], size_t count) {
+
+	const size_t lanes = lockstepLanes();
+
+	for (size_t first = 0; first < count; first += lanes) {
+
+		const size_t end = (count - first) < lanes ? count : first + lanes;
+
+		/* Adaptive, float and sensitivity requests take their own loops and are solved one by one */
+		struct SolverContext* groupCtxs[LOCKSTEP_MAX_LANES];
+		struct SolverRequest groupRequests[LOCKSTEP_MAX_LANES];
+		int group = 0;
+
+		for (size_t i = first; i < end; i++) {
+
+			const struct SolverRequest* req = &requests[i];
+
+			if(req->options->Integrator == ADAPTIVE_STEP || req->options->Precision == PRECISION_FLOAT || 
+				req->options->Sensitivities == OPTION_YES) {
+
+				trajectorySolver(ctxs[i], req->meteo, req->bullet, req->rifle, req->scope, req->inputs, req->options, req->results);
+				continue;
+			}
+
+			groupCtxs[group] = ctxs[i];
+			groupRequests[group] = *req;
+			group++;
+		}
+
+		if(group == 0) {
+			continue;
+		}
+
+		if(group == 1) { /* nothing to pair with */
+
+			const struct SolverRequest* req = &groupRequests[0];
+			trajectorySolver(groupCtxs[0], req->meteo, req->bullet, req->rifle, req->scope, req->inputs, req->options, req->results);
+			continue;
+		}
+
+#if defined LOCKSTEP_SIMD
+#if defined LOCKSTEP_AVX2_DISPATCH
+		if(lanes == 8) {
+
+			integrateLanes8(groupCtxs, groupRequests, group);
+			continue;
+		}
+#endif
+		integrateLanes4(groupCtxs, groupRequests, group);
+#endif
+	}
+}
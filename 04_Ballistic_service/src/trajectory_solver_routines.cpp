@@ -1,7 +1,5 @@
 #include "trajectory_solver_routines.h"
 
-#define WIND_GRANULARITY_FOR_COMPLEX 5
-
 const char* libInfo (void) {return LIB_VERSION;}
 const char* devInfo (void) {return LIB_TYPE;}
 
@@ -111,7 +109,7 @@ double ZeroingAngleforNumeric(double G_f, const struct Rifle* const rifle,
 	for (uint16_t i = 0; i <= rifle->zeroDistance; ++i) {
 
 		Dst_f = i*STEP_f;
-		CD = DragCoefficient (DragFunction, M);
+		CD = DragCoefficientTabled (DragFunction, M);
 		C4 = (CD*C3*V_1)/Vx1;
 		A1_ = C4*(Vx1);
 		A2_ = (C4*Vy1)-(G_f/Vx1);
@@ -146,6 +144,23 @@ double ZeroingAngleforNumeric(double G_f, const struct Rifle* const rifle,
 	return throwAngleCalculation(Y, Dst_f);
 }
 
+void fillZeroingKey(double G_f, const struct Rifle* const rifle, const struct Bullet* const bullet, 
+	const struct dragAndBCInfo* const dragInfo, struct OUT zeroingKey* key) {
+
+	memset(key, 0, sizeof(struct zeroingKey));
+
+	key->G_f = G_f;
+	key->BCzero = dragInfo->BCzero;
+	key->scopeHight = rifle->scopeHight;
+	key->V0 = bullet->V0;
+	key->thermalSens = bullet->thermalSens;
+	key->zeroDistance = rifle->zeroDistance;
+	key->zeroPress = rifle->zeroPress;
+	key->zeroTemp = rifle->zeroTemp;
+	key->V0temp = bullet->V0temp;
+	key->dragFunction = (bullet->dragFunction == CDM) ? G7 : bullet->dragFunction;
+}
+
 double throwAngleCalculation (double Y, double Dst_f) {
 	return atan(Y / Dst_f);
 }
@@ -472,8 +487,46 @@ bool machAtDeepTranssonic22(const double MachNum) {
 }
 
 
+uint16_t solverRange(const struct Options* const options) {
+
+	if(options->Range == 0) {
+		return DIST_RANGE;
+	}
+
+	return options->Range > MAX_DIST_RANGE ? MAX_DIST_RANGE : options->Range;
+}
+
+uint16_t rangecardStep(const struct Options* const options) {
+
+	return options->TableStep == 0 ? TABLE_STEP : options->TableStep;
+}
+
+uint16_t rangecardSize(const struct Options* const options) {
+
+	return solverRange(options) / rangecardStep(options);
+}
+
+uint16_t rangecardFirstIndex(const struct Options* const options) {
+
+	const uint16_t step = rangecardStep(options);
+	const uint16_t size = rangecardSize(options);
+
+	uint16_t first = (options->RangecardFrom + step - 1) / step;
+	return first > size ? size : first;
+}
+
+uint16_t rangecardLastIndex(const struct Options* const options) {
+
+	if(options->RangecardTo == 0 || options->RangecardTo > solverRange(options)) {
+		return rangecardSize(options);
+	}
+
+	return options->RangecardTo / rangecardStep(options);
+}
+
 void fullfillBallisticTable(const struct Meteo* meteo, const struct Bullet* bullet, const struct Rifle* rifle,
-                            const solverUnit solver[], const struct Scope* const scope, struct Results* OUT results) {
+                            const solverUnit solver[], const struct Scope* const scope, uint16_t firstIndex, uint16_t lastIndex, 
+                            struct Results* OUT results) {
 
 #ifndef PORTABLE_DEVICE
 		results->table.meteo = *meteo;
@@ -483,7 +536,7 @@ void fullfillBallisticTable(const struct Meteo* meteo, const struct Bullet* bull
         double VertDriftAngular = getVertDriftAngular(rifle, scope);
         double HorizDriftAngular = getHorizDriftAngular(rifle, scope);
 
-		for(uint16_t i = 0; i < BALLISTIC_TABLE_SIZE + 1; ++i) {
+		for(uint16_t i = firstIndex; i <= lastIndex; ++i) {
 
             if(scope->angleUnits == MOA_UNITS) {
 
@@ -530,39 +583,29 @@ double aeroJmpCorrector(double MillersFGS, const struct Bullet* bullet, const st
     return 0.0;
 }
 
-//TODO: refactor it!
-void getWindComponents(const struct Meteo* meteo, const uint16_t dist, struct OUT windPortion* wind) {
-
-	int index = 0;
+uint8_t complexWindSegments(const struct Meteo* const meteo) {
 
-	if(dist >= (*(*(meteo)).windData)[0].currentDistance && dist < (*(*(meteo)).windData)[1].currentDistance) {     
-		goto end;
-	}
-	else if(dist >= (*(*(meteo)).windData)[1].currentDistance && dist < (*(*(meteo)).windData)[2].currentDistance) {
-		
-		index = 1;
-		goto end;
-	}
-	else if(dist >= (*(*(meteo)).windData)[2].currentDistance && dist < (*(*(meteo)).windData)[3].currentDistance) {
-		
-		index = 2;
-		goto end;
-	}
-	else if(dist >= (*(*(meteo)).windData)[3].currentDistance && dist < (*(*(meteo)).windData)[4].currentDistance) {
-		
-		index = 3;
-		goto end;
+	if(meteo->windSegments == 0) {
+		return WIND_GRANULARITY;
 	}
-	else if(dist >= (*(*(meteo)).windData)[4].currentDistance) {
-		
-		index = 4;
-		goto end;
+
+	return meteo->windSegments < MAX_WIND_SEGMENTS ? meteo->windSegments : MAX_WIND_SEGMENTS;
+}
+
+uint8_t complexWindIndex(const struct Meteo* const meteo, const uint16_t dist) {
+
+	/* Last segment started at or before dist, the first one before it starts */
+	const uint8_t count = complexWindSegments(meteo);
+	uint8_t index = 0;
+
+	while(index + 1 < count && (*meteo->windData)[index + 1].currentDistance <= dist) {
+		index++;
 	}
 
-end:
-	double windSpeed = (*(*(meteo)).windData)[index].windSpeed;
-	double windDir = (*(*(meteo)).windData)[index].windDir;
-	double terrainDir = (*(*(meteo)).windData)[index].terrainDir;
+	return index;
+}
+
+static void windSegmentComponents(double windSpeed, double windDir, double terrainDir, struct OUT windPortion* wind) {
 
 	wind->Wx = -windSpeed*STEP_f*cos(windDir*DegToRad);
 
@@ -572,6 +615,12 @@ end:
 	wind->Wy = crossWindSpeed*sin(terrainDir*DegToRad);
 }
 
+void getWindComponents(const struct Meteo* meteo, const uint16_t dist, struct OUT windPortion* wind) {
+
+	const struct ComplexWind* segment = &(*meteo->windData)[complexWindIndex(meteo, dist)];
+	windSegmentComponents(segment->windSpeed, segment->windDir, segment->terrainDir, OUT wind);
+}
+
 void initStartWindComponents(const struct Meteo* const meteo, struct windPortion* windComps) {
 
 	if(meteo->WindType == COMPLEX_CASE) {
@@ -579,26 +628,68 @@ void initStartWindComponents(const struct Meteo* const meteo, struct windPortion
 		getWindComponents(meteo, 0, OUT windComps);
 	}
 	else {
-		windComps->Wx = -meteo->windSpeed * STEP_f * cos(meteo->windDir * DegToRad);
-		double crossWindSpeed = -meteo->windSpeed * STEP_f * sin(meteo->windDir * DegToRad);
-		windComps->Wz = crossWindSpeed * cos(meteo->terrainDir * DegToRad);
-		windComps->Wy = crossWindSpeed * sin(meteo->terrainDir * DegToRad);
+		windSegmentComponents(meteo->windSpeed, meteo->windDir, meteo->terrainDir, OUT windComps);
 	}	
 }
 
-void windComponentsForComplexCase(const struct Meteo* const meteo, struct windPortion* windComps, uint16_t currentDist) {
-	
-	if(meteo->WindType == COMPLEX_CASE) {
-		getWindComponents(meteo, currentDist, windComps);
+void prepareWindTable(const struct Meteo* const meteo, const struct Options* const options, struct OUT windTable* table) {
+
+	/* Components are computed once per request, the integration only looks them up (see windTableAt()) */
+	table->cursor = 0;
+
+	if(meteo->WindType != COMPLEX_CASE) {
+
+		table->count = 1;
+		table->segments[0].from = 0;
+		table->segments[0].slope = {0, 0, 0};
+		initStartWindComponents(meteo, &table->segments[0].wind);
+		return;
+	}
+
+	table->count = complexWindSegments(meteo);
+
+	for(uint8_t i = 0; i < table->count; i++) {
+
+		const struct ComplexWind* segment = &(*meteo->windData)[i];
+
+		table->segments[i].from = segment->currentDistance;
+		table->segments[i].slope = {0, 0, 0};
+		windSegmentComponents(segment->windSpeed, segment->windDir, segment->terrainDir, OUT &table->segments[i].wind);
+	}
+
+	if(options->WindInterpolation != OPTION_YES) {
+		return;
+	}
+
+	for(uint8_t i = 0; i + 1 < table->count; i++) {
+
+		struct windSegment* segment = &table->segments[i];
+		const struct windSegment* next = &table->segments[i + 1];
+
+		if(next->from > segment->from) {
+
+			const double span = next->from - segment->from;
+
+			segment->slope.Wx = (next->wind.Wx - segment->wind.Wx) / span;
+			segment->slope.Wy = (next->wind.Wy - segment->wind.Wy) / span;
+			segment->slope.Wz = (next->wind.Wz - segment->wind.Wz) / span;
+		}
 	}
 }
 
 void defineDragInfoForCDM(uint16_t dist, double Mach, double CCF, const struct Bullet* const bullet, 
 	const struct Rifle* const rifle, struct dragAndBCInfo* dragInfo, struct calibrationDistances* calibDists) {
 
+	defineDragInfo(dist, Mach, CCF, bullet, rifle, dragInfo);
+	markCalibrationDistances(dist, Mach, calibDists);
+}
+
+void defineDragInfo(uint16_t dist, double Mach, double CCF, const struct Bullet* const bullet, 
+	const struct Rifle* const rifle, struct dragAndBCInfo* dragInfo) {
+
 	if(bullet->dragFunction == CDM) {
 
-		dragInfo->CD = DragCoefficient (G7, Mach);
+		dragInfo->CD = DragCoefficientTabled (G7, Mach);
 		double i_7 = DragCoefficientForCDM(bullet, Mach) / dragInfo->CD;
 		
 		const double caliberInInch = bullet->caliber * mmToInch;
@@ -613,7 +704,7 @@ void defineDragInfoForCDM(uint16_t dist, double Mach, double CCF, const struct B
 
 		double BC = BCforMBCCase(bullet, Mach);
 
-		dragInfo->CD = DragCoefficient(G1, Mach);
+		dragInfo->CD = DragCoefficientTabled (G1, Mach);
 		dragInfo->C3 = calculateC3(CCF, BC);
 		dragInfo->BCzero = BC;
 	}
@@ -621,47 +712,37 @@ void defineDragInfoForCDM(uint16_t dist, double Mach, double CCF, const struct B
 
 		double BC = BCforMBCCase(bullet, Mach);
 
-		dragInfo->CD = DragCoefficient(G7, Mach);
+		dragInfo->CD = DragCoefficientTabled (G7, Mach);
 		dragInfo->C3 = calculateC3(CCF, BC);
 		dragInfo->BCzero = BC;
 	}
 	else {
 
-		dragInfo->CD = DragCoefficient (bullet->dragFunction, Mach);
+		dragInfo->CD = DragCoefficientTabled (bullet->dragFunction, Mach);
 		dragInfo->C3 = calculateC3(CCF, bullet->BC);
 		dragInfo->BCzero = bullet->BC;
 	}
+}
 
-	if(machAtDeepTranssonic22(Mach)) {
-		calibDists->DistTrans22M = dist;
-	}
-	else if(machAtDeepTranssonic20(Mach)) {
-		calibDists->DistTrans20M = dist;
-	}
-	else if(machAtDeepTranssonic18(Mach)) {
-		calibDists->DistTrans18M = dist;
-	}
-	else if(machAtDeepTranssonic16(Mach)) {
-		calibDists->DistTrans16M = dist;
-	}
-	else if(machAtDeepTranssonic14(Mach)) {
-		calibDists->DistTrans14M = dist;
-	}
-	else if(machAtDeepTranssonic12(Mach)) {
-		calibDists->DistTrans12M = dist;
-	}
-	else if(machAtTranssonic(Mach)) {
-		calibDists->DistTrans = dist;
-	}
-	else if(machAtSubsonic(Mach)) {
-		calibDists->DistSubsonic = dist;
-	}
-	else if(machAtDeepSubsonic(Mach)) {
-		calibDists->DistDeepSubsonic = dist;
+void markCalibrationDistances(uint16_t dist, double Mach, struct calibrationDistances* calibDists) {
+
+	/* Same thresholds as machAt*(), one conversion and one jump instead of ten calls per step */
+	const uint16_t MachNum_ = Mach*100;
+
+	switch(MachNum_) {
+
+		case deeptranssonic22Mach_: calibDists->DistTrans22M = dist; break;
+		case deeptranssonic20Mach_: calibDists->DistTrans20M = dist; break;
+		case deeptranssonic18Mach_: calibDists->DistTrans18M = dist; break;
+		case deeptranssonic16Mach_: calibDists->DistTrans16M = dist; break;
+		case deeptranssonic14Mach_: calibDists->DistTrans14M = dist; break;
+		case deeptranssonic12Mach_: calibDists->DistTrans12M = dist; break;
+		case transsonicMach_: calibDists->DistTrans = dist; break;
+		case subsonicMach_: calibDists->DistSubsonic = dist; break;
+		case deepSubsonicMach_: calibDists->DistDeepSubsonic = dist; break;
+		case deepSubsonicMach07Mach_: calibDists->DistDeepSubsonic07M = dist; break;
+		default: break;
 	}
-    else if(machAtDeepSubsonic07(Mach)) {
-        calibDists->DistDeepSubsonic07M = dist;
-    }
 }
 
 /* Look up table for MultiBC */
@@ -724,29 +805,13 @@ void addSomeSolutionDataToSolverStruct(double KoriolisVert, double YaeroJump, do
 		}
 		else {
 
-			int complexWindIndex = 0;
-
-			if(inputs->shotDistance >= (*(*(meteo)).windData)[0].currentDistance && inputs->shotDistance < (*(*(meteo)).windData)[1].currentDistance) {     
-				complexWindIndex = 0;
-			}
-			else if(inputs->shotDistance >= (*(*(meteo)).windData)[1].currentDistance && inputs->shotDistance < (*(*(meteo)).windData)[2].currentDistance) {
-				complexWindIndex = 1;
-			}
-			else if(inputs->shotDistance >= (*(*(meteo)).windData)[2].currentDistance && inputs->shotDistance < (*(*(meteo)).windData)[3].currentDistance) {
-				complexWindIndex = 2;
-			}
-			else if(inputs->shotDistance >= (*(*(meteo)).windData)[3].currentDistance && inputs->shotDistance < (*(*(meteo)).windData)[4].currentDistance) {
-				complexWindIndex = 3;
-			}
-			else if(inputs->shotDistance >= (*(*(meteo)).windData)[4].currentDistance) {
-				complexWindIndex = 4;
-			}
+			const uint8_t windIndex = complexWindIndex(meteo, inputs->shotDistance);
 
 			double averageWindSpeed = 0;
 			double windSpeed = 0;
 			uint16_t windDir = 0;
 
-			for(uint8_t i = 0; i <= complexWindIndex; i++) {
+			for(uint8_t i = 0; i <= windIndex; i++) {
 				
 				windSpeed = (*(*(meteo)).windData)[i].windSpeed;
 				windDir = (*(*(meteo)).windData)[i].windDir;
@@ -754,7 +819,7 @@ void addSomeSolutionDataToSolverStruct(double KoriolisVert, double YaeroJump, do
 				averageWindSpeed += windSpeed * sin(DegToRad*windDir);	
 			}
 
-			averageWindSpeed /= (complexWindIndex + 1);
+			averageWindSpeed /= (windIndex + 1);
 
 			double aeroJumpCorr = (YaeroJump * averageWindSpeed * MOAatDist);
 			
@@ -0,0 +1,346 @@
+#include "trajectory_spline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+static const char* const channelNames[s2::SPLINE_CHANNELS] = {"vert.", "drop", "horiz.", "deriv.", "time", "Mach"};
+static const double channelTolerances[s2::SPLINE_CHANNELS] = {SPLINE_TOL_ANGLE, SPLINE_TOL_DROP, SPLINE_TOL_ANGLE, SPLINE_TOL_ANGLE,
+	SPLINE_TOL_TIME, SPLINE_TOL_MACH};
+
+static inline double hermite(double p0, double m0, double p1, double m1, double h, double t) {
+
+	const double t2 = t * t;
+	const double t3 = t2 * t;
+
+	return p0 * (2 * t3 - 3 * t2 + 1) + m0 * h * (t3 - 2 * t2 + t) + p1 * (-2 * t3 + 3 * t2) + m1 * h * (t3 - t2);
+}
+
+bool s2::trajectorySpline::evaluate(double dist, double OUT result[SPLINE_CHANNELS]) const {
+
+	if(dist < from || dist > to) {
+		return false;
+	}
+
+	const size_t span = spanOf[(size_t)(dist - from)];
+	const double a = knots[span];
+	const double h = knots[span + 1] - a;
+	const double t = (dist - a) / h;
+
+	for(int c = 0; c < SPLINE_CHANNELS; c++) {
+		result[c] = hermite(values[c][span], slopes[c][2 * span], values[c][span + 1], slopes[c][2 * span + 1], h, t);
+	}
+
+	return true;
+}
+
+size_t s2::trajectorySpline::bytes() const {
+
+	return sizeof(trajectorySpline) + (knots.capacity() + spanOf.capacity()) * sizeof(uint16_t) +
+		knots.size() * SPLINE_CHANNELS * 3 * sizeof(double);
+}
+
+std::string s2::splineCache::makeKey(const nlohmann::json& bodyJson) {
+
+	/* Objects are dumped with sorted keys, equal states give equal keys */
+	nlohmann::json keyJson = bodyJson;
+	keyJson.erase("Token");
+
+	if(keyJson.contains("Inputs") && keyJson["Inputs"].is_object()) {
+		keyJson["Inputs"].erase("dist.");
+	}
+
+	const auto& splineJson = bodyJson["Spline"];
+	keyJson["Spline"] = {{"from", splineJson.value("from", 0)}, {"to", splineJson.value("to", 0)}};
+
+	return keyJson.dump();
+}
+
+bool s2::isSplineRequest(const nlohmann::json& bodyJson) {
+
+	return bodyJson.is_object() && bodyJson.contains("Spline") && bodyJson["Spline"].is_object();
+}
+
+std::shared_ptr<const s2::trajectorySpline> s2::fitSpline(const nlohmann::json& bodyJson, SolverContext& ctx) {
+
+	datapreparator dp;
+
+	const Bullet bullet = dp.parseForBulletData(bodyJson);
+	const Rifle rifle = dp.parseForRifleData(bodyJson);
+	const Scope scope = dp.parseForScopeData(bodyJson);
+	const Meteo meteo = dp.parseForMeteoData(bodyJson);
+	Options options = dp.parseForOptions(bodyJson);
+	Inputs inputs = dp.parseForInputs(bodyJson);
+
+	const auto& splineJson = bodyJson["Spline"];
+	const uint16_t range = solverRange(&options);
+
+	auto spline = std::make_shared<trajectorySpline>();
+	spline->from = splineJson.value("from", (uint16_t)SPLINE_FROM);
+	spline->to = std::min(splineJson.value("to", range), range);
+
+	if(spline->from < 1 || spline->from + SPLINE_MIN_SPAN > spline->to) {
+		throw std::out_of_range("wrong spline range");
+	}
+
+	/* 1 m rows with one more on each side for the slopes */
+	const uint16_t first = std::max(1, spline->from - 1);
+	uint16_t last = std::min<uint16_t>(range, spline->to + 1);
+
+	options.BallisticTable = OPTION_YES;
+	options.TableStep = 1;
+	options.RangecardFrom = first;
+	options.RangecardTo = last;
+	options.EarlyExit = OPTION_YES;
+	options.MachDistances = OPTION_NO;
+	inputs.shotDistance = last;
+
+	Results results;
+	trajectorySolver(&ctx, &meteo, &bullet, &rifle, &scope, &inputs, &options, OUT &results);
+
+	const int units = scope.angleUnits == MRAD_UNITS ? 1 : 0;
+	const double tanThrow = tan(ctx.throwAngle);
+
+	std::vector<double> rows[SPLINE_CHANNELS];
+
+	for(int c = 0; c < SPLINE_CHANNELS; c++) {
+		rows[c].assign(last + 1, 0.0);
+	}
+
+	std::vector<bool> kink(last + 1, false);
+
+	for(uint16_t i = first; i <= last; i++) {
+
+		const solverUnit& row = ctx.solver[i];
+
+		/* Signed height over the line of sight, Yrz is its magnitude (see absoluteDropToZeroing()) */
+		const double height = (row.Yabs - row.Dst_f * tanThrow) * ctx.setup.KoriolisVert;
+
+		rows[SPLINE_VERT][i] = results.table.Vert[i][units];
+		rows[SPLINE_DROP][i] = -height;
+		rows[SPLINE_HORIZ][i] = results.table.Horiz[i][units];
+		rows[SPLINE_DERIV][i] = results.table.Deriv[i][units];
+		rows[SPLINE_TIME][i] = results.table.Time[i];
+		rows[SPLINE_MACH][i] = row.MachNumber;
+
+		/* Corrections are magnitudes and break where the bullet crosses the line of sight, 
+		both rows around a crossing become knots with one-sided slopes */
+		if(i > first && (rows[SPLINE_DROP][i] > 0) != (rows[SPLINE_DROP][i - 1] > 0)) {
+			kink[i - 1] = kink[i] = true;
+		}
+	}
+
+	/* A stalled bullet falls back and its rows stop making sense, the spline ends before the time stops growing */
+	for(uint16_t i = first + 1; i <= last; i++) {
+
+		if(!std::isfinite(rows[SPLINE_TIME][i]) || rows[SPLINE_TIME][i] <= rows[SPLINE_TIME][i - 1]) {
+
+			last = i - 1;
+			spline->to = std::min(spline->to, last);
+			break;
+		}
+	}
+
+	if(spline->from + SPLINE_MIN_SPAN > spline->to) {
+		throw std::out_of_range("the bullet stalls before the spline range");
+	}
+
+	/* The speed grows again once the bullet falls back */
+	uint16_t stall = last + 1;
+
+	for(uint16_t i = first + 1; i <= last; i++) {
+
+		if(rows[SPLINE_MACH][i] > rows[SPLINE_MACH][i - 1]) {
+
+			stall = i;
+			break;
+		}
+	}
+
+	auto slopeAt = [&rows, &kink, first, last](int c, uint16_t x, bool spanStart) {
+
+		if(x > first && x < last && !kink[x]) {
+			return (rows[c][x + 1] - rows[c][x - 1]) / 2;
+		}
+
+		return (spanStart && x < last) || x == first ? rows[c][x + 1] - rows[c][x] : rows[c][x] - rows[c][x - 1];
+	};
+
+	/* Largest miss of a span relative to the channel tolerance, > 1 - the span is split */
+	auto spanMiss = [&rows, &slopeAt](uint16_t a, uint16_t b, double OUT errors[SPLINE_CHANNELS]) {
+
+		double worst = 0;
+
+		for(int c = 0; c < SPLINE_CHANNELS; c++) {
+
+			const double m0 = slopeAt(c, a, true);
+			const double m1 = slopeAt(c, b, false);
+
+			errors[c] = 0;
+
+			for(uint16_t x = a + 1; x < b; x++) {
+
+				const double fit = hermite(rows[c][a], m0, rows[c][b], m1, b - a, (double)(x - a) / (b - a));
+				errors[c] = std::max(errors[c], fabs(fit - rows[c][x]));
+			}
+
+			worst = std::max(worst, errors[c] / channelTolerances[c]);
+		}
+
+		return worst;
+	};
+
+	std::fill(spline->error, spline->error + SPLINE_CHANNELS, 0.0);
+
+	/* First knots: SPLINE_MAX_SPAN apart and at the crossings */
+	std::vector<uint16_t> firstKnots;
+
+	for(uint32_t x = spline->from; x < spline->to; x += SPLINE_MAX_SPAN) {
+		firstKnots.push_back((uint16_t)x);
+	}
+
+	for(uint16_t x = spline->from; x <= spline->to; x++) {
+		if(kink[x]) {
+			firstKnots.push_back(x);
+		}
+	}
+
+	firstKnots.push_back(spline->to);
+	std::sort(firstKnots.begin(), firstKnots.end());
+	firstKnots.erase(std::unique(firstKnots.begin(), firstKnots.end()), firstKnots.end());
+
+	/* Spans left to right, a span that misses is halved and its halves go first */
+	std::vector<std::pair<uint16_t, uint16_t>> pending;
+
+	for(size_t k = firstKnots.size() - 1; k > 0; k--) {
+		pending.push_back({firstKnots[k - 1], firstKnots[k]});
+	}
+
+	spline->knots.push_back(spline->from);
+
+	while(!pending.empty()) {
+
+		const auto span = pending.back();
+		pending.pop_back();
+
+		double errors[SPLINE_CHANNELS];
+
+		if(spanMiss(span.first, span.second, errors) > 1) {
+
+			if(span.second - span.first > SPLINE_MIN_SPAN) {
+
+				const uint16_t middle = (span.first + span.second) / 2;
+
+				pending.push_back({middle, span.second});
+				pending.push_back({span.first, middle});
+				continue;
+			}
+
+			/* Rows change too fast even for the shortest span: past the stall the spline ends here, 
+			close to the muzzle the miss is left in err. */
+			if(span.first >= stall && span.first > spline->from) {
+
+				spline->to = span.first;
+				break;
+			}
+		}
+
+		for(int c = 0; c < SPLINE_CHANNELS; c++) {
+
+			spline->error[c] = std::max(spline->error[c], errors[c]);
+			spline->values[c].push_back(rows[c][span.first]);
+			spline->slopes[c].push_back(slopeAt(c, span.first, true));
+			spline->slopes[c].push_back(slopeAt(c, span.second, false));
+		}
+
+		for(uint16_t x = span.first; x < span.second; x++) {
+			spline->spanOf.push_back((uint16_t)(spline->knots.size() - 1));
+		}
+
+		spline->knots.push_back(span.second);
+	}
+
+	/* "to" itself belongs to the last span */
+	spline->spanOf.push_back((uint16_t)(spline->knots.size() - 2));
+
+	for(int c = 0; c < SPLINE_CHANNELS; c++) {
+		spline->values[c].push_back(rows[c][spline->to]);
+	}
+
+	return spline;
+}
+
+void s2::serializeSpline(const nlohmann::json& bodyJson, const trajectorySpline& spline, std::string& workBuffer) {
+
+	datapreparator dp;
+	dp.getToken(bodyJson);
+
+	const auto& splineJson = bodyJson["Spline"];
+
+	nlohmann::json resultJson;
+	resultJson["from"] = spline.from;
+	resultJson["to"] = spline.to;
+
+	if(splineJson.contains("dist.")) {
+
+		nlohmann::json answersJson = nlohmann::json::array();
+
+		for(const auto& distJson : splineJson["dist."]) {
+
+			nlohmann::json answerJson;
+			answerJson["dist."] = distJson;
+
+			double values[SPLINE_CHANNELS];
+
+			if(spline.evaluate(distJson.get<double>(), values)) {
+
+				for(int c = 0; c < SPLINE_CHANNELS; c++) {
+					answerJson[channelNames[c]] = values[c];
+				}
+			}
+
+			answersJson.push_back(answerJson);
+		}
+
+		resultJson["answers"] = answersJson;
+	}
+
+	nlohmann::json errorJson;
+
+	for(int c = 0; c < SPLINE_CHANNELS; c++) {
+		errorJson[channelNames[c]] = spline.error[c];
+	}
+
+	resultJson["err."] = errorJson;
+
+	if(splineJson.value("knots", !splineJson.contains("dist."))) {
+
+		nlohmann::json knotsJson;
+		knotsJson["dist."] = spline.knots;
+
+		for(int c = 0; c < SPLINE_CHANNELS; c++) {
+
+			nlohmann::json slopesJson = nlohmann::json::array();
+
+			for(size_t span = 0; span + 1 < spline.knots.size(); span++) {
+				slopesJson.push_back({spline.slopes[c][2 * span], spline.slopes[c][2 * span + 1]});
+			}
+
+			nlohmann::json channelJson;
+			channelJson["values"] = spline.values[c];
+			channelJson["slopes"] = slopesJson;
+
+			knotsJson[channelNames[c]] = channelJson;
+		}
+
+		resultJson["knots"] = knotsJson;
+	}
+
+	nlohmann::json responceJson;
+	responceJson["Version"] = dp.getVersion();
+	responceJson["Token"] = dp.token();
+	responceJson["Spline"] = resultJson;
+
+	workBuffer.reserve(BALLISTIX_WORKING_BUFFER_SIZE);
+	workBuffer = responceJson.dump(4);
+}
@@ -0,0 +1,92 @@
+#include "trajectory_trace.h"
+#include "trajectory_solver_routines.h"
+
+#include <math.h>
+
+std::string trajectoryTraceCache::makeKey(const struct Meteo* const meteo, const struct Bullet* const bullet, const struct Rifle* const rifle, 
+	const struct Options* const options, double latitude, uint16_t lastDist, uint16_t range) {
+
+	/* Everything the vertical and time solution depends on. Wind speeds are compared 
+	separately (with tolerance), only the segment layout goes to the key */
+
+	std::string key;
+	key.reserve(1024);
+
+	appendKeyBytes(key, meteo->T);
+	appendKeyBytes(key, meteo->P);
+	appendKeyBytes(key, meteo->H);
+	appendKeyBytes(key, meteo->WindType);
+
+	if(meteo->WindType == COMPLEX_CASE) {
+
+		const uint8_t segments = complexWindSegments(meteo);
+		appendKeyBytes(key, segments);
+
+		for(int i = 0; i < segments; i++) {
+			appendKeyBytes(key, (*meteo->windData)[i].currentDistance);
+		}
+
+		appendKeyBytes(key, options->WindInterpolation);
+	}
+
+	appendKeyBytes(key, bullet->dragFunction);
+	appendKeyBytes(key, bullet->BC);
+	appendKeyBytes(key, bullet->DSF_0_9);
+	appendKeyBytes(key, bullet->DSF_1_0);
+	appendKeyBytes(key, bullet->DSF_1_1);
+	appendKeyBytes(key, bullet->V0);
+	appendKeyBytes(key, bullet->length);
+	appendKeyBytes(key, bullet->mass);
+	appendKeyBytes(key, bullet->caliber);
+	appendKeyBytes(key, bullet->V0temp);
+	appendKeyBytes(key, bullet->thermalSens);
+
+	if(bullet->dragFunction == CDM) {
+
+		for(int i = 0; i < CMD_GRANULARITY; i++) {
+
+			appendKeyBytes(key, (*bullet->cdmData)[i].MachNumber);
+			appendKeyBytes(key, (*bullet->cdmData)[i].CD);
+		}
+	}
+	else if(bullet->dragFunction == MBCG1 || bullet->dragFunction == MBCG7) {
+
+		for(int i = 0; i < MBC_GRANULARITY; i++) {
+
+			appendKeyBytes(key, (*bullet->mbcData)[i].MachNumber);
+			appendKeyBytes(key, (*bullet->mbcData)[i].BC);
+		}
+	}
+
+	appendKeyBytes(key, rifle->zeroDistance);
+	appendKeyBytes(key, rifle->scopeHight);
+
+	appendKeyBytes(key, options->ThermalCorrection);
+	appendKeyBytes(key, options->EarlyExit);
+	appendKeyBytes(key, options->MachDistances);
+
+	appendKeyBytes(key, latitude);
+	appendKeyBytes(key, lastDist);
+	appendKeyBytes(key, range);
+
+	return key;
+}
+
+void traceWinds(const struct windTable* const table, struct windPortion OUT winds[MAX_WIND_SEGMENTS]) {
+
+	for(int i = 0; i < table->count; i++) {
+		winds[i] = table->segments[i].wind;
+	}
+}
+
+bool traceWindsMatch(const struct windPortion traced[MAX_WIND_SEGMENTS], const struct windPortion current[MAX_WIND_SEGMENTS], uint8_t count) {
+
+	for(int i = 0; i < count; i++) {
+
+		if(fabs(traced[i].Wx - current[i].Wx) > TRACE_WIND_TOLERANCE || fabs(traced[i].Wy - current[i].Wy) > TRACE_WIND_TOLERANCE) {
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,429 @@
+#include "truing_solver.h"
+#include "trajectory_solver_lockstep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+bool s2::isTruingRequest(const nlohmann::json& bodyJson) {
+
+	return bodyJson.is_object() && bodyJson.contains("Truing") && bodyJson["Truing"].is_object();
+}
+
+s2::truingsolver::truingsolver(const nlohmann::json& bodyJson) {
+
+	m_dp.getToken(bodyJson);
+
+	m_bullet = m_dp.parseForBulletData(bodyJson);
+	m_rifle = m_dp.parseForRifleData(bodyJson);
+	m_scope = m_dp.parseForScopeData(bodyJson);
+	m_meteo = m_dp.parseForMeteoData(bodyJson);
+	m_options = m_dp.parseForOptions(bodyJson);
+	m_inputs = m_dp.parseForInputs(bodyJson);
+
+	m_bulletJson = bodyJson["Bullet"];
+
+	const auto& truingJson = bodyJson["Truing"];
+	const uint16_t range = solverRange(&m_options);
+
+	for(const auto& observedJson : truingJson.at("observed")) {
+
+		if(m_dists.size() == TRUING_MAX_OBSERVED) {
+			break;
+		}
+
+		auto dist = observedJson["dist."].get<uint16_t>();
+
+		if(dist == 0 || dist > range) {
+			throw std::out_of_range("observed distance is out of range");
+		}
+
+		m_dists.push_back(dist);
+		m_observed.push_back(observedJson["vert."].get<double>());
+	}
+
+	if(m_dists.empty()) {
+		throw std::invalid_argument("nothing observed");
+	}
+
+	const auto fit = truingJson.value("fit", std::string("V0+BC"));
+	const bool mbc = (fit == "MBC");
+
+	if(fit != "V0" && fit != "BC" && fit != "V0+BC" && !mbc) {
+		throw std::invalid_argument("fit is V0, BC, V0+BC or MBC");
+	}
+
+	m_fitV0 = (fit == "V0" || fit == "V0+BC");
+
+	if(mbc && m_bullet.dragFunction != G1 && m_bullet.dragFunction != G7 &&
+		m_bullet.dragFunction != MBCG1 && m_bullet.dragFunction != MBCG7) {
+
+		throw std::invalid_argument("multi-BC needs a G1/G7 bullet");
+	}
+
+	if(m_fitV0) {
+
+		m_point.push_back(m_bullet.V0);
+		m_steps.push_back(TRUING_V0_STEP);
+	}
+
+	if(fit != "V0") {
+
+		/* Knots are placed by solveNominal(), one until then */
+		m_knots.push_back(1.0);
+		m_point.push_back(1.0);
+		m_steps.push_back(TRUING_FACTOR_STEP);
+
+		if(mbc) {
+			m_knots.resize(std::min<size_t>(m_dists.size(), TRUING_MAX_KNOTS), 1.0);
+		}
+	}
+}
+
+size_t s2::truingsolver::batchSize() const {
+
+	return m_batch.size();
+}
+
+Options s2::truingsolver::solveOptions() const {
+
+	/* Range-card rows at the observed distances only: the step is their greatest common divisor */
+
+	Options options = m_options;
+
+	uint16_t step = 0;
+
+	for(auto dist : m_dists) {
+		step = std::gcd(step, dist);
+	}
+
+	options.BallisticTable = OPTION_YES;
+	options.TableStep = step;
+	options.RangecardFrom = *std::min_element(m_dists.begin(), m_dists.end());
+	options.RangecardTo = *std::max_element(m_dists.begin(), m_dists.end());
+	options.EarlyExit = OPTION_YES;
+	options.MachDistances = OPTION_NO;
+
+	return options;
+}
+
+double s2::truingsolver::factorAt(const std::vector<double>& point, double Mach) const {
+
+	const double* factors = point.data() + (m_fitV0 ? 1 : 0);
+	const size_t knots = m_knots.size();
+
+	if(knots == 1 || Mach <= m_knots.front()) {
+		return factors[0];
+	}
+
+	if(Mach >= m_knots.back()) {
+		return factors[knots - 1];
+	}
+
+	size_t i = 0;
+
+	while(m_knots[i + 1] < Mach) {
+		i++;
+	}
+
+	return factors[i] + (factors[i + 1] - factors[i]) * (Mach - m_knots[i]) / (m_knots[i + 1] - m_knots[i]);
+}
+
+void s2::truingsolver::applyPoint(candidate& OUT c) const {
+
+	c.bullet = m_bullet;
+
+	if(m_fitV0) {
+		c.bullet.V0 = (uint16_t)lround(c.point[0]);
+	}
+
+	if(m_knots.empty()) {
+		return;
+	}
+
+	if(m_knots.size() > 1) {
+
+		/* Multi-BC curve: BC of the profile at every point times the fitted factor there */
+		const bool profileMBC = (m_bullet.dragFunction == MBCG1 || m_bullet.dragFunction == MBCG7);
+
+		for(int i = 0; i < MBC_GRANULARITY; i++) {
+
+			const double Mach = profileMBC ? (*m_bullet.mbcData)[i].MachNumber : 0.5 + i * 0.1;
+			const double BC = profileMBC ? (*m_bullet.mbcData)[i].BC : m_bullet.BC;
+
+			c.mbc[i] = {Mach, BC * factorAt(c.point, Mach)};
+		}
+
+		c.bullet.dragFunction = (m_bullet.dragFunction == G1 || m_bullet.dragFunction == MBCG1) ? MBCG1 : MBCG7;
+		c.bullet.mbcData = &c.mbc;
+		return;
+	}
+
+	const double factor = factorAt(c.point, 1.0);
+
+	c.bullet.BC = m_bullet.BC * factor;
+
+	if(m_bullet.cdmData) {
+
+		memcpy(c.cdm, *m_bullet.cdmData, sizeof(CDMDataArray));
+
+		for(int i = 0; i < CMD_GRANULARITY; i++) {
+			c.cdm[i].CD /= factor;
+		}
+		c.bullet.cdmData = &c.cdm;
+	}
+
+	if(m_bullet.mbcData) {
+
+		memcpy(c.mbc, *m_bullet.mbcData, sizeof(MBCDataArray));
+
+		for(int i = 0; i < MBC_GRANULARITY; i++) {
+			c.mbc[i].BC *= factor;
+		}
+		c.bullet.mbcData = &c.mbc;
+	}
+}
+
+void s2::truingsolver::readPredicted(candidate& OUT c) const {
+
+	const int units = m_scope.angleUnits == MRAD_UNITS ? 1 : 0;
+
+	c.predicted.resize(m_dists.size());
+	c.cost = 0;
+
+	for(size_t i = 0; i < m_dists.size(); i++) {
+
+		c.predicted[i] = c.results.table.Vert[m_dists[i] / c.results.table.step][units];
+		c.cost += (c.predicted[i] - m_observed[i]) * (c.predicted[i] - m_observed[i]);
+	}
+}
+
+void s2::truingsolver::solveNominal(SolverContext& ctx) {
+
+	const Options options = solveOptions();
+	const Inputs inputs {options.RangecardTo, m_inputs.terrainAndle, m_inputs.targetSpeedInMILs, m_inputs.targetAzimuth, m_inputs.latitude,
+		m_inputs.magneticIncl};
+
+	candidate nominal;
+	nominal.point.assign(m_point.size(), 1.0);
+
+	if(m_fitV0) {
+		nominal.point[0] = m_bullet.V0;
+	}
+
+	nominal.bullet = m_bullet;
+
+	trajectorySolver(&ctx, &m_meteo, &nominal.bullet, &m_rifle, &m_scope, &inputs, &options, OUT &nominal.results);
+	readPredicted(nominal);
+
+	m_cost = m_costBefore = nominal.cost;
+	m_fitted = nominal.predicted;
+	m_solves = 1;
+
+	if(m_knots.size() > 1) {
+
+		/* Knots spread evenly over the Mach numbers the bullet has at the observed distances */
+		double MachFar = 10, MachNear = 0;
+
+		for(auto dist : m_dists) {
+
+			const double Mach = ctx.solver[dist / options.TableStep].MachNumber;
+
+			MachFar = std::min(MachFar, Mach);
+			MachNear = std::max(MachNear, Mach);
+		}
+
+		for(size_t k = 0; k < m_knots.size(); k++) {
+			m_knots[k] = MachFar + (MachNear - MachFar) * k / (m_knots.size() - 1);
+		}
+
+		m_point.resize((m_fitV0 ? 1 : 0) + m_knots.size(), 1.0);
+		m_steps.resize(m_point.size(), TRUING_FACTOR_STEP);
+	}
+}
+
+bool s2::truingsolver::prepareBatch() {
+
+	const size_t params = m_point.size();
+	const bool converged = (!m_fitV0 || m_steps[0] <= 1) && (m_knots.empty() || m_steps.back() < TRUING_FACTOR_TOLERANCE);
+
+	if(converged || m_iterations >= TRUING_MAX_ITERATIONS || m_cost == 0) {
+		return false;
+	}
+
+	m_batch.clear();
+
+	auto addCandidate = [this](const std::vector<double>& point) {
+
+		/* V0 must stay a positive integer, BC factors within reason */
+		for(size_t p = 0; p < point.size(); p++) {
+
+			const bool V0 = (m_fitV0 && p == 0);
+
+			if((V0 && point[p] < 1) || (!V0 && (point[p] < 0.2 || point[p] > 5.0))) {
+				return;
+			}
+		}
+
+		m_batch.emplace_back();
+		m_batch.back().point = point;
+	};
+
+	size_t combinations = 1;
+
+	for(size_t p = 0; p < params; p++) {
+		combinations *= 3;
+	}
+
+	if(combinations - 1 <= LOCKSTEP_MAX_LANES) {
+
+		/* Every combination of -step, 0, +step */
+		for(size_t code = 1; code < combinations; code++) {
+
+			std::vector<double> point = m_point;
+			size_t c = code;
+
+			for(size_t p = 0; p < params; p++, c /= 3) {
+				point[p] += ((int)(c % 3) - (c % 3 == 2 ? 3 : 0)) * m_steps[p];
+			}
+			addCandidate(point);
+		}
+	}
+	else {
+
+		for(size_t p = 0; p < params; p++) {
+			for(double sign : {-1.0, 1.0}) {
+
+				std::vector<double> point = m_point;
+				point[p] += sign * m_steps[p];
+				addCandidate(point);
+			}
+		}
+	}
+
+	for(auto& c : m_batch) {
+		applyPoint(c);
+	}
+
+	return !m_batch.empty();
+}
+
+void s2::truingsolver::solveBatch(size_t first, size_t count, SolverContext* const ctxs[]) {
+
+	SolverRequest requests[LOCKSTEP_MAX_LANES]{};
+
+	const Options options = solveOptions();
+	const Inputs inputs {options.RangecardTo, m_inputs.terrainAndle, m_inputs.targetSpeedInMILs, m_inputs.targetAzimuth, m_inputs.latitude,
+		m_inputs.magneticIncl};
+
+	for(size_t l = 0; l < count; l++) {
+
+		candidate& c = m_batch[first + l];
+		requests[l] = {&m_meteo, &c.bullet, &m_rifle, &m_scope, &inputs, &options, &c.results};
+	}
+
+	trajectorySolverLockstep(ctxs, requests, count);
+
+	for(size_t l = 0; l < count; l++) {
+		readPredicted(m_batch[first + l]);
+	}
+}
+
+void s2::truingsolver::acceptBatch() {
+
+	m_iterations++;
+	m_solves += m_batch.size();
+
+	auto best = std::min_element(m_batch.begin(), m_batch.end(), [](const candidate& a, const candidate& b) { return a.cost < b.cost; });
+
+	if(best != m_batch.end() && best->cost < m_cost) {
+
+		m_point = best->point;
+		m_cost = best->cost;
+		m_fitted = best->predicted;
+		return;
+	}
+
+	for(size_t p = 0; p < m_steps.size(); p++) {
+		m_steps[p] = (m_fitV0 && p == 0) ? std::max(1.0, floor(m_steps[p] / 2)) : m_steps[p] / 2;
+	}
+}
+
+nlohmann::json s2::truingsolver::fittedBullet() const {
+
+	candidate c;
+	c.point = m_point;
+	applyPoint(c);
+
+	nlohmann::json bulletJson = m_bulletJson;
+	bulletJson["V0"] = c.bullet.V0;
+	bulletJson["BC"] = c.bullet.BC;
+
+	if(m_knots.size() > 1) {
+
+		std::vector<double> curve;
+
+		for(int i = 0; i < MBC_GRANULARITY; i++) {
+			curve.push_back(c.mbc[i].BC);
+		}
+
+		bulletJson["DF"] = c.bullet.dragFunction == MBCG1 ? "MBCG1" : "MBCG7";
+		bulletJson["MBC"] = curve;
+	}
+	else if(c.bullet.cdmData && !m_knots.empty()) {
+
+		std::vector<double> curve;
+
+		for(int i = 0; i < CMD_GRANULARITY; i++) {
+			curve.push_back(c.cdm[i].CD);
+		}
+
+		bulletJson["CDM"] = curve;
+	}
+	else if(c.bullet.mbcData && !m_knots.empty()) {
+
+		std::vector<double> curve;
+
+		for(int i = 0; i < MBC_GRANULARITY; i++) {
+			curve.push_back(c.mbc[i].BC);
+		}
+
+		bulletJson["MBC"] = curve;
+	}
+
+	return bulletJson;
+}
+
+void s2::truingsolver::serializeResults(std::string& workBuffer) const {
+
+	const double n = m_dists.size();
+
+	nlohmann::json truingJson;
+	truingJson["Bullet"] = fittedBullet();
+	truingJson["rms"] = sqrt(m_cost / n);
+	truingJson["rms.before"] = sqrt(m_costBefore / n);
+	truingJson["iterations"] = m_iterations;
+	truingJson["solves"] = m_solves;
+
+	if(m_knots.size() > 1) {
+		truingJson["knots"] = m_knots;
+	}
+
+	nlohmann::json residualsJson = nlohmann::json::array();
+
+	for(size_t i = 0; i < m_dists.size(); i++) {
+		residualsJson.push_back({{"dist.", m_dists[i]}, {"vert.", m_observed[i]}, {"fit", m_fitted[i]}});
+	}
+
+	truingJson["residuals"] = residualsJson;
+
+	nlohmann::json responceJson;
+	responceJson["Version"] = m_dp.getVersion();
+	responceJson["Token"] = m_dp.token();
+	responceJson["Truing"] = truingJson;
+
+	workBuffer.reserve(BALLISTIX_WORKING_BUFFER_SIZE);
+	workBuffer = responceJson.dump(4);
+}
@@ -0,0 +1,383 @@
+#include "wind_estimator.h"
+#include "trajectory_solver_lockstep.h"
+#include "solver_structs_and_consts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+bool s2::isWindEstimateRequest(const nlohmann::json& bodyJson) {
+
+	return bodyJson.is_object() && bodyJson.contains("WindEstimate") && bodyJson["WindEstimate"].is_object();
+}
+
+s2::windestimator::windestimator(const nlohmann::json& bodyJson) {
+
+	m_dp.getToken(bodyJson);
+
+	m_bullet = m_dp.parseForBulletData(bodyJson);
+	m_rifle = m_dp.parseForRifleData(bodyJson);
+	m_scope = m_dp.parseForScopeData(bodyJson);
+	m_meteo = m_dp.parseForMeteoData(bodyJson);
+	m_options = m_dp.parseForOptions(bodyJson);
+	m_inputs = m_dp.parseForInputs(bodyJson);
+
+	const auto& estimateJson = bodyJson["WindEstimate"];
+	const uint16_t range = solverRange(&m_options);
+
+	for(const auto& observedJson : estimateJson.at("observed")) {
+
+		if(m_dists.size() == WIND_ESTIMATE_MAX_OBSERVED) {
+			break;
+		}
+
+		auto dist = observedJson["dist."].get<uint16_t>();
+
+		if(dist == 0 || dist > range) {
+			throw std::out_of_range("observed distance is out of range");
+		}
+
+		m_dists.push_back(dist);
+		m_observed.push_back(observedJson["horiz."].get<double>());
+	}
+
+	if(m_dists.empty()) {
+		throw std::invalid_argument("nothing observed");
+	}
+
+	if(estimateJson.contains("segments")) {
+
+		for(const auto& segmentJson : estimateJson["segments"]) {
+			m_segments.push_back(segmentJson.get<uint16_t>());
+		}
+	}
+	else {
+
+		/* Wind between the observed distances */
+		m_segments = m_dists;
+		m_segments.push_back(0);
+		std::sort(m_segments.begin(), m_segments.end());
+		m_segments.pop_back();
+	}
+
+	std::sort(m_segments.begin(), m_segments.end());
+	m_segments.erase(std::unique(m_segments.begin(), m_segments.end()), m_segments.end());
+
+	if(m_segments.empty() || m_segments.size() > MAX_WIND_SEGMENTS) {
+		throw std::out_of_range("wrong number of wind segments");
+	}
+
+	/* The first segment covers the muzzle anyway (see complexWindIndex()) */
+	m_segments.front() = 0;
+
+	if(estimateJson.contains("dir.")) {
+
+		m_dir = estimateJson["dir."].get<uint16_t>() % 360;
+		m_dirKnown = true;
+
+		if(fabs(sin(m_dir * DegToRad)) < 0.1) {
+			throw std::invalid_argument("the wind direction has no crosswind");
+		}
+	}
+
+	m_terrainDir = m_meteo.WindType == COMPLEX_CASE ? (*m_meteo.windData)[0].terrainDir : m_meteo.terrainDir;
+	m_cross.assign(m_segments.size(), 0.0);
+}
+
+size_t s2::windestimator::batchSize() const {
+
+	return m_batch.size();
+}
+
+Options s2::windestimator::solveOptions() const {
+
+	/* Range-card rows at the observed distances only, as truing does */
+
+	Options options = m_options;
+
+	uint16_t step = 0;
+
+	for(auto dist : m_dists) {
+		step = std::gcd(step, dist);
+	}
+
+	options.BallisticTable = OPTION_YES;
+	options.TableStep = step;
+	options.RangecardFrom = *std::min_element(m_dists.begin(), m_dists.end());
+	options.RangecardTo = *std::max_element(m_dists.begin(), m_dists.end());
+	options.EarlyExit = OPTION_YES;
+	options.MachDistances = OPTION_NO;
+
+	return options;
+}
+
+double s2::windestimator::speedOf(double cross) const {
+
+	return m_dirKnown ? cross / sin(m_dir * DegToRad) : fabs(cross);
+}
+
+uint16_t s2::windestimator::dirOf(double cross) const {
+
+	if(m_dirKnown) {
+		return speedOf(cross) < 0 ? (m_dir + 180) % 360 : m_dir;
+	}
+
+	return cross < 0 ? 270 : 90;
+}
+
+void s2::windestimator::applyWinds(const std::vector<double>& cross, candidate& OUT c) const {
+
+	/* Signed speed along the direction, the solver takes it as is */
+	const uint16_t dir = m_dirKnown ? m_dir : 90;
+
+	for(size_t k = 0; k < m_segments.size(); k++) {
+		c.winds[k] = {m_segments[k], m_dirKnown ? speedOf(cross[k]) : cross[k], dir, m_terrainDir};
+	}
+
+	c.meteo = m_meteo;
+	c.meteo.WindType = COMPLEX_CASE;
+	c.meteo.windData = &c.winds;
+	c.meteo.windSegments = (uint8_t)m_segments.size();
+}
+
+void s2::windestimator::readPredicted(candidate& OUT c) const {
+
+	const int units = m_scope.angleUnits == MRAD_UNITS ? 1 : 0;
+
+	c.predicted.resize(m_dists.size());
+	c.cost = 0;
+
+	for(size_t i = 0; i < m_dists.size(); i++) {
+
+		const uint16_t row = m_dists[i] / c.results.table.step;
+
+		c.predicted[i] = c.results.table.Horiz[row][units] + c.results.table.Deriv[row][units];
+		c.cost += (c.predicted[i] - m_observed[i]) * (c.predicted[i] - m_observed[i]);
+	}
+}
+
+void s2::windestimator::solveNominal(SolverContext& ctx) {
+
+	const Options options = solveOptions();
+	const Inputs inputs {options.RangecardTo, m_inputs.terrainAndle, m_inputs.targetSpeedInMILs, m_inputs.targetAzimuth, m_inputs.latitude,
+		m_inputs.magneticIncl};
+
+	candidate nominal;
+
+	trajectorySolver(&ctx, &m_meteo, &m_bullet, &m_rifle, &m_scope, &inputs, &options, OUT &nominal.results);
+	readPredicted(nominal);
+
+	m_cost = m_costBefore = nominal.cost;
+	m_fitted = nominal.predicted;
+	m_solves = 1;
+}
+
+bool s2::windestimator::prepareBatch() {
+
+	if(m_converged) {
+		return false;
+	}
+
+	/* The current winds first, then one per segment changed by WIND_ESTIMATE_DELTA */
+	m_batch.assign(m_final ? 1 : m_segments.size() + 1, candidate{});
+
+	applyWinds(m_cross, m_batch[0]);
+
+	for(size_t k = 1; k < m_batch.size(); k++) {
+
+		std::vector<double> cross = m_cross;
+		cross[k - 1] += WIND_ESTIMATE_DELTA;
+		applyWinds(cross, m_batch[k]);
+	}
+
+	return true;
+}
+
+void s2::windestimator::solveBatch(size_t first, size_t count, SolverContext* const ctxs[]) {
+
+	SolverRequest requests[LOCKSTEP_MAX_LANES]{};
+
+	const Options options = solveOptions();
+	const Inputs inputs {options.RangecardTo, m_inputs.terrainAndle, m_inputs.targetSpeedInMILs, m_inputs.targetAzimuth, m_inputs.latitude,
+		m_inputs.magneticIncl};
+
+	for(size_t l = 0; l < count; l++) {
+
+		candidate& c = m_batch[first + l];
+		requests[l] = {&c.meteo, &m_bullet, &m_rifle, &m_scope, &inputs, &options, &c.results};
+	}
+
+	trajectorySolverLockstep(ctxs, requests, count);
+
+	for(size_t l = 0; l < count; l++) {
+		readPredicted(m_batch[first + l]);
+	}
+}
+
+void s2::windestimator::acceptBatch() {
+
+	m_iterations++;
+	m_solves += m_batch.size();
+
+	const candidate& base = m_batch[0];
+
+	m_cost = base.cost;
+	m_fitted = base.predicted;
+
+	if(m_final) {
+
+		m_converged = true;
+		return;
+	}
+
+	/* Normal equations of the linearised least squares plus the neighbour tie:
+	(J'J + lambda D'D) step = J'r - lambda D'D cross */
+
+	const size_t n = m_dists.size();
+	const size_t K = m_segments.size();
+
+	std::vector<double> A(K * K, 0.0);
+	std::vector<double> b(K, 0.0);
+
+	for(size_t i = 0; i < n; i++) {
+
+		const double r = m_observed[i] - base.predicted[i];
+
+		for(size_t k = 0; k < K; k++) {
+
+			const double Jk = (m_batch[k + 1].predicted[i] - base.predicted[i]) / WIND_ESTIMATE_DELTA;
+
+			b[k] += Jk * r;
+
+			for(size_t j = 0; j < K; j++) {
+				A[k * K + j] += Jk * (m_batch[j + 1].predicted[i] - base.predicted[i]) / WIND_ESTIMATE_DELTA;
+			}
+		}
+	}
+
+	double trace = 0;
+
+	for(size_t k = 0; k < K; k++) {
+		trace += A[k * K + k];
+	}
+
+	const double lambda = WIND_ESTIMATE_SMOOTHING * trace / K;
+
+	for(size_t k = 0; k + 1 < K; k++) {
+
+		const double difference = m_cross[k + 1] - m_cross[k];
+
+		A[k * K + k] += lambda;
+		A[(k + 1) * K + k + 1] += lambda;
+		A[k * K + k + 1] -= lambda;
+		A[(k + 1) * K + k] -= lambda;
+
+		b[k] += lambda * difference;
+		b[k + 1] -= lambda * difference;
+	}
+
+	for(size_t k = 0; k < K; k++) {
+		A[k * K + k] += 1e-12 * (trace + 1);
+	}
+
+	/* Gaussian elimination with partial pivoting, K is small */
+	for(size_t col = 0; col < K; col++) {
+
+		size_t pivot = col;
+
+		for(size_t row = col + 1; row < K; row++) {
+			if(fabs(A[row * K + col]) > fabs(A[pivot * K + col])) {
+				pivot = row;
+			}
+		}
+
+		if(pivot != col) {
+
+			for(size_t j = 0; j < K; j++) {
+				std::swap(A[col * K + j], A[pivot * K + j]);
+			}
+			std::swap(b[col], b[pivot]);
+		}
+
+		for(size_t row = col + 1; row < K; row++) {
+
+			const double f = A[row * K + col] / A[col * K + col];
+
+			for(size_t j = col; j < K; j++) {
+				A[row * K + j] -= f * A[col * K + j];
+			}
+			b[row] -= f * b[col];
+		}
+	}
+
+	std::vector<double> step(K, 0.0);
+	double largest = 0;
+
+	for(size_t k = K; k-- > 0;) {
+
+		double sum = b[k];
+
+		for(size_t j = k + 1; j < K; j++) {
+			sum -= A[k * K + j] * step[j];
+		}
+
+		step[k] = sum / A[k * K + k];
+		largest = std::max(largest, fabs(step[k]));
+	}
+
+	/* The winds just solved are within the tolerance of the answer */
+	if(largest < WIND_ESTIMATE_TOLERANCE) {
+
+		m_converged = true;
+		return;
+	}
+
+	for(size_t k = 0; k < K; k++) {
+		m_cross[k] += step[k];
+	}
+
+	m_final = (m_iterations + 1 >= WIND_ESTIMATE_MAX_ITERATIONS);
+}
+
+nlohmann::json s2::windestimator::windage() const {
+
+	nlohmann::json windageJson = nlohmann::json::array();
+
+	for(size_t k = 0; k < m_segments.size(); k++) {
+
+		windageJson.push_back({{"dist.", m_segments[k]}, {"speed", fabs(speedOf(m_cross[k]))}, {"dir.", dirOf(m_cross[k])},
+			{"incl.", m_terrainDir}});
+	}
+
+	return windageJson;
+}
+
+void s2::windestimator::serializeResults(std::string& workBuffer) const {
+
+	const double n = m_dists.size();
+
+	nlohmann::json estimateJson;
+	estimateJson["Meteo"] = {{"wind", "complex"}, {"windage", windage()}};
+	estimateJson["cross"] = m_cross;
+	estimateJson["rms"] = sqrt(m_cost / n);
+	estimateJson["rms.before"] = sqrt(m_costBefore / n);
+	estimateJson["iterations"] = m_iterations;
+	estimateJson["solves"] = m_solves;
+
+	nlohmann::json residualsJson = nlohmann::json::array();
+
+	for(size_t i = 0; i < m_dists.size(); i++) {
+		residualsJson.push_back({{"dist.", m_dists[i]}, {"horiz.", m_observed[i]}, {"fit", m_fitted[i]}});
+	}
+
+	estimateJson["residuals"] = residualsJson;
+
+	nlohmann::json responceJson;
+	responceJson["Version"] = m_dp.getVersion();
+	responceJson["Token"] = m_dp.token();
+	responceJson["WindEstimate"] = estimateJson;
+
+	workBuffer.reserve(BALLISTIX_WORKING_BUFFER_SIZE);
+	workBuffer = responceJson.dump(4);
+}
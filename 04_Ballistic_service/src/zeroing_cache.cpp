@@ -0,0 +1,35 @@
+#include "zeroing_cache.h"
+#include "trajectory_solver_routines.h"
+
+#include <cstring>
+
+size_t zeroingKeyHash::operator()(const zeroingKey& key) const {
+
+	return fnv1aHash(&key, sizeof(zeroingKey));
+}
+
+bool zeroingKeyEqual::operator()(const zeroingKey& lhs, const zeroingKey& rhs) const {
+
+	return memcmp(&lhs, &rhs, sizeof(zeroingKey)) == 0;
+}
+
+double cachedZeroingAngle(zeroingCache* cache, double G_f, const struct Rifle* const rifle, const struct Bullet* const bullet, 
+	const struct Meteo* const meteo, const struct dragAndBCInfo* const dragInfo) {
+
+	if(!cache) {
+		return ZeroingAngleforNumeric(G_f, rifle, bullet, meteo, dragInfo);
+	}
+
+	struct zeroingKey key;
+	fillZeroingKey(G_f, rifle, bullet, dragInfo, &key);
+
+	double angle;
+
+	if(!cache->find(key, angle)) {
+
+		angle = ZeroingAngleforNumeric(G_f, rifle, bullet, meteo, dragInfo);
+		cache->insert(key, angle);
+	}
+
+	return angle;
+}